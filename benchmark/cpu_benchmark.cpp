@@ -0,0 +1,75 @@
+// CPU_run throughput with eager and lazy flags.
+//
+// Usage: embedded_sim_cpu_benchmark [repetitions]
+// Runs a counting loop whose body has a given number of ALU instructions before the cmp and
+// jlt closing it, and reports the best of the repetitions in ns per executed instruction.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+extern "C" {
+#include <proc/Alu.h>
+#include <proc/Cpu.h>
+}
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+auto nanosecondsPerInstruction(unsigned bodyLength, bool lazyFlags, unsigned repetitions) -> double {
+  Register overflow = 0;
+  auto cpu = CPU_ctor();
+  auto alu = ALU_ctor(CPU_getFlagRegisterAddress(cpu), &overflow);
+  CPU_setALU(cpu, alu);
+  ALU_setLazyFlags(alu, lazyFlags);
+
+  auto regs = CPU_getDataRegisters(cpu);
+  Register one = 1;
+  Register limit = 60000;
+  Register loop = 0;
+  std::vector<Instruction> program;
+  program.push_back(Instruction_ctor3(ALU_ADD, &regs[0], &one));
+  for (unsigned i = 1; i < bodyLength; ++i) {
+    InstructionType const types[] {ALU_XOR, ALU_SUB, ALU_OR, ALU_ADD};
+    program.push_back(Instruction_ctor3(types[i % 4], &regs[1 + i % 3], &regs[0]));
+  }
+  program.push_back(Instruction_ctor3(ALU_CMP, &regs[0], &limit));
+  program.push_back(Instruction_ctor2(IPU_JLT, &loop));
+  CPU_loadProgram(cpu, program.data(), program.size());
+
+  auto best = 0.0;
+  for (unsigned i = 0; i < repetitions; ++i) {
+    CPU_reset(cpu);
+    CpuRunStats stats;
+    auto const begin = Clock::now();
+    CPU_run(cpu, CPU_RUN_NO_STEP_LIMIT, &stats);
+    auto const seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    auto const perInstruction = seconds / stats.executedInstructionCount * 1e9;
+    best = i == 0 ? perInstruction : std::min(best, perInstruction);
+  }
+
+  for (auto instr : program) {
+    Instruction_dtor(instr);
+  }
+  CPU_dtor(cpu);
+  ALU_dtor(alu);
+  return best;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  auto const repetitions = argc > 1 ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10)) : 20u;
+  if (repetitions == 0) {
+    std::fprintf(stderr, "usage: %s [repetitions]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::printf("%12s %12s %12s\n", "ALU ops", "eager ns", "lazy ns");
+  for (auto const bodyLength : {1u, 4u, 16u}) {
+    std::printf("%12u %12.2f %12.2f\n", bodyLength, nanosecondsPerInstruction(bodyLength, false, repetitions),
+                nanosecondsPerInstruction(bodyLength, true, repetitions));
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,123 @@
+// Parse and link time of generated programs past the U16 instruction-count limit.
+//
+// Usage: embedded_sim_large_program_benchmark [maximum line count in millions]
+// Doubles the line count from one million up to the maximum (10 by default) and reports the
+// createParser() and getParserInstructionSet2() times, in total and per line, so linear
+// scaling shows as a flat per-line column, and the peak resident set size of the process so far.
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <parser/parser.h>
+
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// Blocks of eight lines: a label, five data instructions and two branches, one of them to the
+// start of the program, so labels resolve across the whole index range.
+auto generateProgram(size_t lineCount) -> std::string {
+  std::string source;
+  source.reserve(lineCount * 16);
+  for (size_t line = 0; line < lineCount; line += 8) {
+    auto const label = "block_" + std::to_string(line / 8);
+    source += label + ":\n";
+    source += "mov r0 0x1f;\n";
+    source += "add r0 r1;\n";
+    source += "sub r2 12;\n";
+    source += "xor r3 0b1010;\n";
+    source += "cmp r0 r2;\n";
+    source += "jlt " + label + ";\n";
+    source += "jgt block_0;\n";
+  }
+  return source;
+}
+
+auto seconds(Clock::time_point begin) -> double {
+  return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+auto peakResidentMebibytes() -> double {
+#ifdef __unix__
+  rusage usage {};
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<double>(usage.ru_maxrss) / 1024.0; // Kilobytes on Linux.
+#else
+  return 0.0;
+#endif
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  auto const maxMillions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10ul;
+  if (maxMillions == 0) {
+    std::fprintf(stderr, "usage: %s [maximum line count in millions]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::array<Register, 4> registers {};
+  std::array<char const*, 4> const names {"r0", "r1", "r2", "r3"};
+  std::vector<ParserMappedRegister> map;
+  for (size_t i = 0; i < registers.size(); ++i) {
+    map.push_back({.registerNameLength = 2, .pRegisterName = names[i], .pRegister = &registers[i]});
+  }
+  ParserGetInstructionSetInfo2 const getInfo {
+      .structureType = STRUCTURE_TYPE_PARSER_GET_INSTRUCTION_SET_INFO_2,
+      .pNext = nullptr,
+      .mappedRegisterCount = static_cast<U32>(map.size()),
+      .pMappedRegisters = map.data()
+  };
+
+  std::vector<size_t> steps;
+  for (size_t millions = 1; millions < maxMillions; millions *= 2) {
+    steps.push_back(millions);
+  }
+  steps.push_back(maxMillions);
+
+  std::printf("%10s %10s %10s %12s %12s %10s\n", "lines", "parse s", "link s", "parse ns/ln", "link ns/ln", "peak MiB");
+  for (auto const millions : steps) {
+    auto const lineCount = millions * 1'000'000;
+    auto const source = generateProgram(lineCount);
+    ParserCreateInfo const createInfo {
+        .structureType = STRUCTURE_TYPE_PARSER_CREATE_INFO,
+        .pNext = nullptr,
+        .inputType = PARSER_INPUT_TYPE_CODE,
+        .dataLength = static_cast<U32>(source.length()),
+        .pData = source.data()
+    };
+
+    auto const parseBegin = Clock::now();
+    Parser parser;
+    if (auto const error = createParser(&createInfo, &parser); error != PARSER_ERROR_NONE) {
+      std::fprintf(stderr, "createParser failed: %d\n", static_cast<int>(error));
+      return EXIT_FAILURE;
+    }
+    auto const parseSeconds = seconds(parseBegin);
+
+    auto const linkBegin = Clock::now();
+    U32 count = 0;
+    auto error = getParserInstructionSet2(parser, &getInfo, &count, nullptr);
+    std::vector<Instruction> instructions(count);
+    if (error == PARSER_ERROR_NONE) {
+      error = getParserInstructionSet2(parser, &getInfo, &count, instructions.data());
+    }
+    auto const linkSeconds = seconds(linkBegin);
+    destroyParser(parser);
+    if (error != PARSER_ERROR_NONE) {
+      std::fprintf(stderr, "getParserInstructionSet2 failed: %d\n", static_cast<int>(error));
+      return EXIT_FAILURE;
+    }
+
+    auto const perLine = [lineCount](double total) { return total / static_cast<double>(lineCount) * 1e9; };
+    std::printf("%10zu %10.3f %10.3f %12.1f %12.1f %10.1f\n", lineCount, parseSeconds, linkSeconds,
+                perLine(parseSeconds), perLine(linkSeconds), peakResidentMebibytes());
+  }
+  return EXIT_SUCCESS;
+}
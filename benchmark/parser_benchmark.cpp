@@ -0,0 +1,154 @@
+// Parser throughput on a generated program.
+//
+// Usage: embedded_sim_parser_benchmark [source size in MiB] [repetitions]
+// Reports the best of the repetitions, in MB/s of source, for tokenizing with each supported
+// scan kernel, for a full createParser() call, which uses the widest kernel, for one tokenizing
+// on every hardware thread and for one served by the program cache.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+#include <parser/lexer.hpp>
+#include <parser/parser.h>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+auto generateProgram(size_t length) -> std::string {
+  std::string source;
+  source.reserve(length + 128);
+  for (unsigned block = 0; source.length() < length; ++block) {
+    auto const label = "loop_" + std::to_string(block);
+    source += label + ":\n";
+    source += "  mov r0, 0x1f;\n";
+    source += "  add r0, r1;\n";
+    source += "\tsub r2,\t12;\n";
+    source += "  cmp r0, r2; // compare against the bound\n";
+    source += "  jlt " + label + "\n";
+    source += "  xor r3, 0b1010;\n";
+    source += "\n";
+  }
+  return source;
+}
+
+template <typename Body> auto bestSeconds(unsigned repetitions, Body&& body) -> double {
+  auto best = 0.0;
+  for (unsigned i = 0; i < repetitions; ++i) {
+    auto const begin = Clock::now();
+    body();
+    auto const seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    best = i == 0 ? seconds : std::min(best, seconds);
+  }
+  return best;
+}
+
+auto report(char const* name, size_t bytes, double seconds) {
+  std::printf("%-10s %10.1f MB/s\n", name, static_cast<double>(bytes) / seconds / 1e6);
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  auto const mebibytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16ul;
+  auto const repetitions = argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10)) : 5u;
+  if (mebibytes == 0 || repetitions == 0) {
+    std::fprintf(stderr, "usage: %s [source size in MiB] [repetitions]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  auto const source = generateProgram(mebibytes << 20u);
+  std::printf("source     %10zu bytes\n", source.length());
+
+  struct {
+    char const* name;
+    parser::ScanKernel kernel;
+  } const kernels[] {
+      {"scalar", parser::ScanKernel::Scalar},
+      {"sse2", parser::ScanKernel::Sse2},
+      {"avx2", parser::ScanKernel::Avx2},
+  };
+  for (auto const& [name, kernel] : kernels) {
+    if (!parser::isScanKernelSupported(kernel)) {
+      std::printf("%-10s unsupported\n", name);
+      continue;
+    }
+    size_t tokenBytes = 0;
+    auto const seconds = bestSeconds(repetitions, [&] {
+      tokenBytes = 0;
+      parser::Lexer lexer{source, kernel};
+      while (auto token = lexer.next()) {
+        tokenBytes += token->text.length();
+      }
+    });
+    if (tokenBytes == 0) {
+      return EXIT_FAILURE;
+    }
+    report(name, source.length(), seconds);
+  }
+
+  ParserCreateInfo const createInfo {
+      .structureType = STRUCTURE_TYPE_PARSER_CREATE_INFO,
+      .pNext = nullptr,
+      .inputType = PARSER_INPUT_TYPE_CODE,
+      .dataLength = static_cast<U32>(source.length()),
+      .pData = source.data()
+  };
+  auto error = PARSER_ERROR_NONE;
+  auto const seconds = bestSeconds(repetitions, [&] {
+    Parser parser;
+    if (error = createParser(&createInfo, &parser); error == PARSER_ERROR_NONE) {
+      destroyParser(parser);
+    }
+  });
+  if (error != PARSER_ERROR_NONE) {
+    std::fprintf(stderr, "createParser failed: %d\n", static_cast<int>(error));
+    return EXIT_FAILURE;
+  }
+  report("parser", source.length(), seconds);
+
+  ParserParallelParseInfo parallelInfo {
+      .structureType = STRUCTURE_TYPE_PARSER_PARALLEL_PARSE_INFO,
+      .pNext = nullptr,
+      .threadCount = 0,
+      .chunkLength = 0
+  };
+  auto parallelCreateInfo = createInfo;
+  parallelCreateInfo.pNext = &parallelInfo;
+  auto const parallelSeconds = bestSeconds(repetitions, [&] {
+    Parser parser;
+    if (error = createParser(&parallelCreateInfo, &parser); error == PARSER_ERROR_NONE) {
+      destroyParser(parser);
+    }
+  });
+  if (error != PARSER_ERROR_NONE) {
+    std::fprintf(stderr, "parallel createParser failed: %d\n", static_cast<int>(error));
+    return EXIT_FAILURE;
+  }
+  report("parallel", source.length(), parallelSeconds);
+
+  auto const cacheDirectory = (std::filesystem::temp_directory_path() / "embedded_sim_parser_benchmark").string();
+  ParserProgramCacheInfo cacheInfo {
+      .structureType = STRUCTURE_TYPE_PARSER_PROGRAM_CACHE_INFO,
+      .pNext = nullptr,
+      .directoryPathLength = static_cast<U32>(cacheDirectory.length()),
+      .pDirectoryPath = cacheDirectory.data()
+  };
+  auto cachedCreateInfo = createInfo;
+  cachedCreateInfo.pNext = &cacheInfo;
+  auto const cachedSeconds = bestSeconds(repetitions + 1, [&] {
+    Parser parser;
+    if (error = createParser(&cachedCreateInfo, &parser); error == PARSER_ERROR_NONE) {
+      destroyParser(parser);
+    }
+  });
+  std::filesystem::remove_all(cacheDirectory);
+  if (error != PARSER_ERROR_NONE) {
+    std::fprintf(stderr, "cached createParser failed: %d\n", static_cast<int>(error));
+    return EXIT_FAILURE;
+  }
+  report("cached", source.length(), cachedSeconds);
+  return EXIT_SUCCESS;
+}
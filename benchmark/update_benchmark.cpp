@@ -0,0 +1,177 @@
+// Latency of one-line edits through updateParser() on a generated program.
+//
+// Usage: embedded_sim_update_benchmark [line count in thousands] [edits per kind]
+// Edits lines at random points of a program (100k lines by default) whose instruction set is
+// linked, and reports the mean and worst updateParser() time and the time of the
+// getParserInstructionSet2() call relinking after it, next to a full parse and link.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <parser/parser.h>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+auto blockLabel(size_t block) -> std::string {
+  return "block_" + std::to_string(block) + ":\n";
+}
+
+auto generateProgram(size_t blockCount) -> std::string {
+  std::string source;
+  source.reserve(blockCount * 128);
+  for (size_t block = 0; block < blockCount; ++block) {
+    auto const label = "block_" + std::to_string(block);
+    source += label + ":\n";
+    source += "mov r0 0x1f;\n";
+    source += "add r0 r1;\n";
+    source += "sub r2 12;\n";
+    source += "xor r3 0b1010;\n";
+    source += "cmp r0 r2;\n";
+    source += "jlt " + label + ";\n";
+    source += "jgt block_0;\n";
+  }
+  return source;
+}
+
+auto microseconds(Clock::time_point begin, Clock::time_point end) -> double {
+  return std::chrono::duration<double, std::micro>(end - begin).count();
+}
+
+struct Timing {
+  double total = 0;
+  double worst = 0;
+  unsigned count = 0;
+
+  auto add(double value) {
+    total += value;
+    worst = std::max(worst, value);
+    ++count;
+  }
+};
+} // namespace
+
+int main(int argc, char** argv) {
+  auto const thousands = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100ul;
+  auto const editCount = argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10)) : 200u;
+  if (thousands == 0 || editCount == 0) {
+    std::fprintf(stderr, "usage: %s [line count in thousands] [edits per kind]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::array<Register, 4> registers {};
+  std::array<char const*, 4> const names {"r0", "r1", "r2", "r3"};
+  std::vector<ParserMappedRegister> map;
+  for (size_t i = 0; i < registers.size(); ++i) {
+    map.push_back({.registerNameLength = 2, .pRegisterName = names[i], .pRegister = &registers[i]});
+  }
+  ParserGetInstructionSetInfo2 const getInfo {
+      .structureType = STRUCTURE_TYPE_PARSER_GET_INSTRUCTION_SET_INFO_2,
+      .pNext = nullptr,
+      .mappedRegisterCount = static_cast<U32>(map.size()),
+      .pMappedRegisters = map.data()
+  };
+  std::vector<Instruction> instructions;
+  auto link = [&](Parser parser) {
+    U32 count = 0;
+    auto error = getParserInstructionSet2(parser, &getInfo, &count, nullptr);
+    instructions.resize(count);
+    if (error == PARSER_ERROR_NONE) {
+      error = getParserInstructionSet2(parser, &getInfo, &count, instructions.data());
+    }
+    return error;
+  };
+
+  auto const blockCount = thousands * 1000 / 8;
+  auto source = generateProgram(blockCount);
+  ParserEditableSourceInfo editableInfo {
+      .structureType = STRUCTURE_TYPE_PARSER_EDITABLE_SOURCE_INFO,
+      .pNext = nullptr
+  };
+  ParserCreateInfo const createInfo {
+      .structureType = STRUCTURE_TYPE_PARSER_CREATE_INFO,
+      .pNext = &editableInfo,
+      .inputType = PARSER_INPUT_TYPE_CODE,
+      .dataLength = static_cast<U32>(source.length()),
+      .pData = source.data()
+  };
+  auto const parseBegin = Clock::now();
+  Parser parser;
+  if (auto const error = createParser(&createInfo, &parser); error != PARSER_ERROR_NONE) {
+    std::fprintf(stderr, "createParser failed: %d\n", static_cast<int>(error));
+    return EXIT_FAILURE;
+  }
+  auto const linkBegin = Clock::now();
+  if (auto const error = link(parser); error != PARSER_ERROR_NONE) {
+    std::fprintf(stderr, "getParserInstructionSet2 failed: %d\n", static_cast<int>(error));
+    return EXIT_FAILURE;
+  }
+  auto const linkEnd = Clock::now();
+  std::printf("lines %zu, parse %.0f us, link %.0f us\n",
+              blockCount * 8, microseconds(parseBegin, linkBegin), microseconds(linkBegin, linkEnd));
+
+  // Each kind of edit is undone by the next, so the program keeps its size.
+  struct Edit {
+    char const* name;
+    size_t shift;
+    size_t removedLength;
+    char const* text;
+  };
+  std::array const edits {
+      Edit {"operand", 7, 4, "0x2e"},
+      Edit {"operand", 7, 4, "0x1f"},
+      Edit {"insert", 0, 0, "add r1 r0;\n"},
+      Edit {"delete", 0, 11, ""},
+  };
+  std::array<Timing, edits.size()> updateTimes;
+  std::array<Timing, edits.size()> relinkTimes;
+
+  std::mt19937 random{42};
+  std::uniform_int_distribution<size_t> blocks{1, blockCount - 1};
+  for (unsigned i = 0; i < editCount; ++i) {
+    auto const block = blocks(random);
+    auto const lineOffset = source.find(blockLabel(block)) + blockLabel(block).length();
+    for (size_t kind = 0; kind < edits.size(); ++kind) {
+      auto const& edit = edits[kind];
+      std::string const text = edit.text;
+      ParserUpdateInfo const updateInfo {
+          .structureType = STRUCTURE_TYPE_PARSER_UPDATE_INFO,
+          .pNext = nullptr,
+          .offset = static_cast<U32>(lineOffset + edit.shift),
+          .removedLength = static_cast<U32>(edit.removedLength),
+          .textLength = static_cast<U32>(text.length()),
+          .pText = text.data()
+      };
+      auto const begin = Clock::now();
+      auto error = updateParser(parser, &updateInfo);
+      auto const updated = Clock::now();
+      if (error == PARSER_ERROR_NONE) {
+        error = link(parser);
+      }
+      auto const relinked = Clock::now();
+      if (error != PARSER_ERROR_NONE) {
+        std::fprintf(stderr, "%s edit failed: %d\n", edit.name, static_cast<int>(error));
+        return EXIT_FAILURE;
+      }
+      source.replace(updateInfo.offset, edit.removedLength, text);
+      updateTimes[kind].add(microseconds(begin, updated));
+      relinkTimes[kind].add(microseconds(updated, relinked));
+    }
+  }
+  destroyParser(parser);
+
+  std::printf("%-8s %12s %12s %12s %12s\n", "edit", "update us", "worst us", "relink us", "worst us");
+  for (size_t kind = 0; kind < edits.size(); ++kind) {
+    auto const& update = updateTimes[kind];
+    auto const& relink = relinkTimes[kind];
+    std::printf("%-8s %12.2f %12.2f %12.2f %12.2f\n", edits[kind].name, update.total / update.count, update.worst,
+                relink.total / relink.count, relink.worst);
+  }
+  return EXIT_SUCCESS;
+}
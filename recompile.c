@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <parser/recompiler.h>
+
+// Usage: embedded_sim_recompile <program.asm> <kernel.c> <kernel name>
+// Registers r0..r7 are mapped onto the CPU's data registers.
+int main(int argc, char ** argv)
+{
+  if (argc != 4) {
+    fprintf(stderr, "usage: %s <program.asm> <kernel.c> <kernel name>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  char tokenBuffer[128];
+  ParserInvalidTokenOutputInfo invalidTokenInfo = {
+      .structureType = STRUCTURE_TYPE_PARSER_INVALID_TOKEN_OUTPUT_INFO,
+      .pNext = NULL,
+      .line = 0,
+      .column = 0,
+      .tokenLength = sizeof(tokenBuffer),
+      .pToken = tokenBuffer,
+  };
+  ParserCreateInfo createInfo = {
+      .structureType = STRUCTURE_TYPE_PARSER_CREATE_INFO,
+      .pNext = &invalidTokenInfo,
+      .inputType = PARSER_INPUT_TYPE_FILE_PATH,
+      .dataLength = 0,
+      .pData = argv[1],
+  };
+
+  Parser parser = NULL;
+  ParserError error = createParser(&createInfo, &parser);
+  if (error == PARSER_ERROR_INVALID_TOKEN) {
+    fprintf(stderr, "%s:%u:%u: invalid token '%s'\n", argv[1], invalidTokenInfo.line, invalidTokenInfo.column,
+            tokenBuffer);
+    return EXIT_FAILURE;
+  }
+  if (error != PARSER_ERROR_NONE) {
+    fprintf(stderr, "%s: cannot parse program (error %d)\n", argv[1], error);
+    return EXIT_FAILURE;
+  }
+
+  static char const * const registerNames[CPU_DATA_REGISTRY_LIST_SIZE] = {"r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7"};
+  Register registerFile[CPU_DATA_REGISTRY_LIST_SIZE] = {0};
+  ParserMappedRegister mappedRegisters[CPU_DATA_REGISTRY_LIST_SIZE];
+  for (U32 i = 0; i < CPU_DATA_REGISTRY_LIST_SIZE; i++) {
+    mappedRegisters[i].registerNameLength = strlen(registerNames[i]);
+    mappedRegisters[i].pRegisterName = registerNames[i];
+    mappedRegisters[i].pRegister = &registerFile[i];
+  }
+
+  ParserUndefinedReferenceOutputInfo undefinedReferenceInfo = {
+      .structureType = STRUCTURE_TYPE_PARSER_UNDEFINED_REFERENCE_OUTPUT_INFO,
+      .pNext = NULL,
+      .referencingInstructionIndex = 0,
+      .tokenLength = sizeof(tokenBuffer),
+      .pToken = tokenBuffer,
+  };
+  ParserTranslateInfo translateInfo = {
+      .structureType = STRUCTURE_TYPE_PARSER_TRANSLATE_INFO,
+      .pNext = &undefinedReferenceInfo,
+      .mappedRegisterCount = CPU_DATA_REGISTRY_LIST_SIZE,
+      .pMappedRegisters = mappedRegisters,
+      .pRegisterFile = registerFile,
+      .kernelNameLength = 0,
+      .pKernelName = argv[3],
+  };
+
+  U32 sourceLength = 0;
+  char * source = NULL;
+  error = translateParserProgram(parser, &translateInfo, &sourceLength, NULL);
+  if (error == PARSER_ERROR_NONE) {
+    source = (char *) malloc(sourceLength);
+    error = translateParserProgram(parser, &translateInfo, &sourceLength, source);
+  }
+  destroyParser(parser);
+
+  if (error == PARSER_ERROR_UNDEFINED_REFERENCE) {
+    fprintf(stderr, "%s: undefined reference '%s' in instruction %u\n", argv[1], tokenBuffer,
+            undefinedReferenceInfo.referencingInstructionIndex);
+  } else if (error != PARSER_ERROR_NONE) {
+    fprintf(stderr, "%s: cannot translate program (error %d)\n", argv[1], error);
+  }
+  if (error != PARSER_ERROR_NONE) {
+    free(source);
+    return EXIT_FAILURE;
+  }
+
+  FILE * output = fopen(argv[2], "w");
+  if (output == NULL || fputs(source, output) == EOF || fclose(output) != 0) {
+    fprintf(stderr, "%s: cannot write kernel\n", argv[2]);
+    free(source);
+    return EXIT_FAILURE;
+  }
+  free(source);
+  return EXIT_SUCCESS;
+}
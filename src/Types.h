@@ -28,16 +28,26 @@
 #define FR_BITMASK (FR_OVERFLOW_FLAG | FR_ZERO_FLAG | FR_DIV_ZERO_FLAG | FR_EQUAL_FLAG \
                     | FR_LESS_FLAG | FR_ILLEGAL_FLAG | FR_SEG_FLAG | FR_MULTISTATE_FLAG)
 
+#define FR_FAULT_MASK (FR_ILLEGAL_FLAG | FR_SEG_FLAG | FR_MULTISTATE_FLAG)
+
 
 typedef unsigned char U8;
 typedef unsigned short int U16;
 typedef unsigned int U32;
+typedef unsigned long long U64;
 
 typedef enum {
   STRUCTURE_TYPE_PARSER_CREATE_INFO,
   STRUCTURE_TYPE_PARSER_GET_INSTRUCTION_SET_INFO,
   STRUCTURE_TYPE_PARSER_INVALID_TOKEN_OUTPUT_INFO,
   STRUCTURE_TYPE_PARSER_UNDEFINED_REFERENCE_OUTPUT_INFO,
+  STRUCTURE_TYPE_PARSER_TRANSLATE_INFO,
+  STRUCTURE_TYPE_PARSER_GET_PACKED_PROGRAM_INFO,
+  STRUCTURE_TYPE_PARSER_PROGRAM_CACHE_INFO,
+  STRUCTURE_TYPE_PARSER_GET_INSTRUCTION_SET_INFO_2,
+  STRUCTURE_TYPE_PARSER_PARALLEL_PARSE_INFO,
+  STRUCTURE_TYPE_PARSER_UPDATE_INFO,
+  STRUCTURE_TYPE_PARSER_EDITABLE_SOURCE_INFO,
 } StructureType;
 
 typedef struct {
@@ -0,0 +1,95 @@
+//
+// Header-only counterpart of proc/alu_private.c. Every opcode is a type whose operator and
+// overflow policy are known at compile time, so execute<type>() inlines to the operation
+// itself instead of going through BinaryOperator / OverflowConsumer pointers.
+//
+
+#pragma once
+
+#include <Types.h>
+#include <model/InstructionType.h>
+#include <model/Register.h>
+
+namespace cxx::detail {
+enum class OverflowPolicy {
+  Ignore,
+  Accept,
+};
+
+template <InstructionType type> struct AluOperation;
+
+#define DEFINE_ALU_OPERATION(_type, _policy, _expression)                                                              \
+  template <> struct AluOperation<_type> {                                                                             \
+    static constexpr auto overflowPolicy = OverflowPolicy::_policy;                                                    \
+    [[nodiscard]] static constexpr auto apply(U16 lhs, U16 rhs) noexcept -> U32 {                                      \
+      static_cast<void>(rhs);                                                                                          \
+      return _expression;                                                                                              \
+    }                                                                                                                  \
+  };
+
+DEFINE_ALU_OPERATION(ALU_ADD, Ignore, static_cast<U32>(lhs) + static_cast<U32>(rhs))
+DEFINE_ALU_OPERATION(ALU_SUB, Accept, static_cast<U32>(lhs) - static_cast<U32>(rhs))
+DEFINE_ALU_OPERATION(ALU_MUL, Ignore, static_cast<U32>(lhs) * static_cast<U32>(rhs))
+DEFINE_ALU_OPERATION(ALU_DIV, Accept, static_cast<U32>(lhs % rhs) << 16 | static_cast<U32>(lhs / rhs))
+DEFINE_ALU_OPERATION(ALU_OR, Ignore, static_cast<U32>(lhs) | static_cast<U32>(rhs))
+DEFINE_ALU_OPERATION(ALU_AND, Ignore, static_cast<U32>(lhs) & static_cast<U32>(rhs))
+DEFINE_ALU_OPERATION(ALU_XOR, Ignore, static_cast<U32>(lhs) ^ static_cast<U32>(rhs))
+DEFINE_ALU_OPERATION(ALU_SHL, Ignore, static_cast<U32>(lhs) << static_cast<U32>(rhs))
+DEFINE_ALU_OPERATION(ALU_SHR, Ignore, static_cast<U32>(lhs) >> static_cast<U32>(rhs))
+DEFINE_ALU_OPERATION(ALU_NOT, Ignore, static_cast<U32>(static_cast<U16>(~lhs)))
+
+#undef DEFINE_ALU_OPERATION
+
+// Same contract as ALU_executeOperation in eager mode: flags are OR-ed into `flags`.
+template <InstructionType type>
+constexpr auto aluExecute(Register& lhs, Register rhs, Register& overflow, Register& flags) noexcept -> void {
+  if constexpr (type == ALU_CMP) {
+    if (lhs == rhs) {
+      flags |= FR_EQUAL_FLAG;
+    } else if (lhs < rhs) {
+      flags |= FR_LESS_FLAG;
+    }
+  } else {
+    if constexpr (type == ALU_DIV) {
+      if (rhs == 0) {
+        flags |= FR_DIV_ZERO_FLAG;
+        return;
+      }
+    }
+
+    using Operation = AluOperation<type>;
+    auto const compound = Operation::apply(lhs, rhs);
+    lhs = static_cast<Register>(compound & 0xFFFFu);
+    if constexpr (Operation::overflowPolicy == OverflowPolicy::Accept) {
+      overflow = static_cast<Register>(compound >> 16 & 0xFFFFu);
+    }
+  }
+}
+
+// Run-time opcode dispatch; every case is an inlined aluExecute instantiation.
+constexpr auto aluExecute(InstructionType type, Register& lhs, Register rhs, Register& overflow,
+                          Register& flags) noexcept -> bool {
+  switch (type) {
+#define ALU_EXECUTE_CASE(_type)                                                                                        \
+    case _type: aluExecute<_type>(lhs, rhs, overflow, flags); return true;
+    ALU_EXECUTE_CASE(ALU_ADD)
+    ALU_EXECUTE_CASE(ALU_SUB)
+    ALU_EXECUTE_CASE(ALU_MUL)
+    ALU_EXECUTE_CASE(ALU_DIV)
+    ALU_EXECUTE_CASE(ALU_OR)
+    ALU_EXECUTE_CASE(ALU_AND)
+    ALU_EXECUTE_CASE(ALU_XOR)
+    ALU_EXECUTE_CASE(ALU_SHL)
+    ALU_EXECUTE_CASE(ALU_SHR)
+    ALU_EXECUTE_CASE(ALU_NOT)
+    ALU_EXECUTE_CASE(ALU_CMP)
+#undef ALU_EXECUTE_CASE
+    default:
+      return false;
+  }
+}
+} // namespace cxx::detail
+
+namespace cxx {
+using detail::aluExecute;
+} // namespace cxx
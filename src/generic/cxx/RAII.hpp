@@ -46,8 +46,51 @@ public:
 private:
   ::Instruction _instr {nullptr};
 };
+
+class InstructionArena {
+public:
+  explicit InstructionArena(U32 capacity = 0) : _arena{InstructionArena_ctor(capacity)} {
+    assert(_arena && "Instruction arena constructor yielded null memory");
+  }
+
+  InstructionArena(InstructionArena const&) = delete;
+  InstructionArena(InstructionArena&& arena) noexcept : _arena{exchange(arena._arena, nullptr)} {}
+  auto operator=(InstructionArena const&) -> InstructionArena& = delete;
+  auto operator=(InstructionArena&& arena) noexcept -> InstructionArena& {
+    if (this == &arena) {
+      return *this;
+    }
+
+    if (auto old = exchange(_arena, exchange(arena._arena, nullptr))) {
+      InstructionArena_dtor(old);
+    }
+    return *this;
+  };
+
+  ~InstructionArena() noexcept {
+    if (_arena) {
+      InstructionArena_dtor(_arena);
+    }
+  }
+
+  auto reset() noexcept {
+    InstructionArena_reset(_arena);
+  }
+
+  [[nodiscard]] auto make(InstructionType type, Register* r0 = nullptr, Register* r1 = nullptr) const noexcept {
+    return Instruction_ctorIn(_arena, type, r0, r1);
+  }
+
+  [[nodiscard]] constexpr auto handle() const noexcept {
+    return _arena;
+  }
+
+private:
+  ::InstructionArena _arena {nullptr};
+};
 } // namespace cxx::detail
 
 namespace cxx {
 using detail::Instruction;
+using detail::InstructionArena;
 } // namespace cxx
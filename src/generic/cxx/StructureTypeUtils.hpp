@@ -17,6 +17,18 @@ template <> struct FindStructureTypeResultImpl<STRUCTURE_TYPE_PARSER_UNDEFINED_R
   using Type = ParserUndefinedReferenceOutputInfo;
 };
 
+template <> struct FindStructureTypeResultImpl<STRUCTURE_TYPE_PARSER_PROGRAM_CACHE_INFO> {
+  using Type = ParserProgramCacheInfo;
+};
+
+template <> struct FindStructureTypeResultImpl<STRUCTURE_TYPE_PARSER_PARALLEL_PARSE_INFO> {
+  using Type = ParserParallelParseInfo;
+};
+
+template <> struct FindStructureTypeResultImpl<STRUCTURE_TYPE_PARSER_EDITABLE_SOURCE_INFO> {
+  using Type = ParserEditableSourceInfo;
+};
+
 template <StructureType type> using FindStructureTypeResult = typename FindStructureTypeResultImpl<type>::Type;
 
 template <StructureType type> auto find(void* pChain) noexcept -> FindStructureTypeResult<type>* {
@@ -26,6 +26,19 @@ static inline Instruction Instruction_ctor2(InstructionType type, Register *p1)
 
 extern void Instruction_dtor(Instruction obj);
 
+// Bump allocator for instructions that share a lifetime, e.g. a parsed program. Instructions
+// stay at the same address until the arena is reset or destroyed and must not be passed to
+// Instruction_dtor.
+typedef struct Private_InstructionArena * InstructionArena;
+
+extern InstructionArena InstructionArena_ctor(U32 capacity);
+extern void InstructionArena_dtor(InstructionArena self);
+
+// Releases every instruction allocated so far, keeping the memory for reuse.
+extern void InstructionArena_reset(InstructionArena self);
+
+extern Instruction Instruction_ctorIn(InstructionArena arena, InstructionType type, Register *p1, Register *p2);
+
 extern InstructionType Instruction_getType(Instruction self);
 extern void Instruction_setType(Instruction self, InstructionType type);
 
@@ -37,8 +50,70 @@ extern void Instruction_setParam2(Instruction self, Register * param2);
 
 extern void Instruction_setParameters(Instruction self, Register p1, Register p2);
 
+// Instruction index an IPU_J* / IPU_CALL instruction branches to. The first operand holds its
+// low 16 bits and the second, when present, the high 16 bits, so that programs may be longer
+// than 65536 instructions.
+extern U32 Instruction_getBranchTarget(Instruction self);
+
 extern bool Instruction_isALU(Instruction self);
 extern bool Instruction_isIPU(Instruction self);
 extern bool Instruction_isMMU(Instruction self);
 
+static inline bool InstructionType_isALU(InstructionType type) { return type >= ALU_ADD && type <= ALU_CMP; }
+static inline bool InstructionType_isIPU(InstructionType type) { return type >= IPU_JMP && type <= IPU_RET; }
+static inline bool InstructionType_isBranch(InstructionType type) { return type >= IPU_JMP && type <= IPU_CALL; }
+static inline bool InstructionType_isConditionalJump(InstructionType type) { return type >= IPU_JEQ && type <= IPU_JGE; }
+static inline bool InstructionType_isMMU(InstructionType type) { return type >= MMU_MOV && type <= MMU_POP; }
+
+// Packed encoding, one 64-bit word per instruction so that a program is a single array:
+//   bits  0..7   InstructionType
+//   bits  8..9   first operand kind
+//   bits 10..11  second operand kind
+//   bits 16..31  first operand, a data register index or an immediate
+//   bits 32..47  second operand, likewise
+// Jump targets are immediates holding the instruction index, split like the operands of
+// Instruction_getBranchTarget: bits 16..47 read as one 32-bit index.
+typedef U64 PackedInstruction;
+
+typedef enum {
+  INSTRUCTION_OPERAND_NONE,
+  INSTRUCTION_OPERAND_REGISTER,
+  INSTRUCTION_OPERAND_IMMEDIATE,
+} InstructionOperandKind;
+
+static inline PackedInstruction PackedInstruction_make(
+    InstructionType type,
+    InstructionOperandKind kind0,
+    U16 operand0,
+    InstructionOperandKind kind1,
+    U16 operand1
+) {
+  return (PackedInstruction) (type & 0xFFu)
+      | (PackedInstruction) (kind0 & 0x3u) << 8
+      | (PackedInstruction) (kind1 & 0x3u) << 10
+      | (PackedInstruction) operand0 << 16
+      | (PackedInstruction) operand1 << 32;
+}
+
+static inline InstructionType PackedInstruction_getType(PackedInstruction self) {
+  return (InstructionType) (self & 0xFFu);
+}
+
+static inline InstructionOperandKind PackedInstruction_getOperandKind(PackedInstruction self, U8 index) {
+  return (InstructionOperandKind) ((self >> (8 + 2 * index)) & 0x3u);
+}
+
+static inline U16 PackedInstruction_getOperand(PackedInstruction self, U8 index) {
+  return (U16) (self >> (16 + 16 * index));
+}
+
+static inline U32 PackedInstruction_getBranchTarget(PackedInstruction self) {
+  return (U32) (self >> 16);
+}
+
+// Encodes an instruction whose operands point either into pDataRegisters, an array of
+// CPU_DATA_REGISTRY_LIST_SIZE registers, or at constants, which are folded into immediates.
+// Fails for an ALU instruction writing to a constant.
+extern bool Instruction_pack(Instruction self, Register const * pDataRegisters, PackedInstruction * pPacked);
+
 #endif //INSTRUCTION_H
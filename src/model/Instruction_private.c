@@ -1,6 +1,7 @@
 //
 // Created by rosa on 11/5/24.
 //
+#include <assert.h>
 #include <model/Instruction.h>
 #include <stdlib.h>
 
@@ -21,6 +22,74 @@ Private_Instruction *Instruction_ctor3(InstructionType type, Register *p1, Regis
 
 void Instruction_dtor(Private_Instruction *self) { free(self); }
 
+#define INSTRUCTION_ARENA_MIN_BLOCK_CAPACITY 64u
+
+typedef struct InstructionArenaBlock {
+  struct InstructionArenaBlock *next;
+  U32 capacity;
+  U32 used;
+  Private_Instruction instructions[];
+} InstructionArenaBlock;
+
+typedef struct Private_InstructionArena {
+  InstructionArenaBlock *first;
+  InstructionArenaBlock *current;
+} Private_InstructionArena;
+
+static InstructionArenaBlock *InstructionArenaBlock_ctor(U32 capacity) {
+  if (capacity < INSTRUCTION_ARENA_MIN_BLOCK_CAPACITY) {
+    capacity = INSTRUCTION_ARENA_MIN_BLOCK_CAPACITY;
+  }
+  InstructionArenaBlock *block =
+      (InstructionArenaBlock *) malloc(sizeof(InstructionArenaBlock) + capacity * sizeof(Private_Instruction));
+  block->next = NULL;
+  block->capacity = capacity;
+  block->used = 0;
+  return block;
+}
+
+Private_InstructionArena *InstructionArena_ctor(U32 capacity) {
+  Private_InstructionArena *arena = (Private_InstructionArena *) malloc(sizeof(Private_InstructionArena));
+  arena->first = InstructionArenaBlock_ctor(capacity);
+  arena->current = arena->first;
+  return arena;
+}
+
+void InstructionArena_dtor(Private_InstructionArena *self) {
+  InstructionArenaBlock *block = self->first;
+  while (block != NULL) {
+    InstructionArenaBlock *next = block->next;
+    free(block);
+    block = next;
+  }
+  free(self);
+}
+
+void InstructionArena_reset(Private_InstructionArena *self) {
+  for (InstructionArenaBlock *block = self->first; block != NULL; block = block->next) {
+    block->used = 0;
+  }
+  self->current = self->first;
+}
+
+Private_Instruction *Instruction_ctorIn(Private_InstructionArena *arena, InstructionType type, Register *p1,
+                                        Register *p2) {
+  InstructionArenaBlock *block = arena->current;
+  while (block->used == block->capacity) {
+    if (block->next == NULL) {
+      block->next = InstructionArenaBlock_ctor(block->capacity * 2);
+    }
+    block = block->next;
+  }
+  arena->current = block;
+
+  Private_Instruction *instr = &block->instructions[block->used++];
+  instr->type = type;
+  instr->param1 = p1;
+  instr->param2 = p2;
+  return instr;
+}
+
 InstructionType Instruction_getType(Private_Instruction *self) { return self->type; }
 
 void Instruction_setType(Private_Instruction *self, InstructionType type) { self->type = type; }
@@ -33,6 +102,15 @@ void Instruction_setParam1(Instruction self, Register *param1) { self->param1 =
 
 void Instruction_setParam2(Instruction self, Register *param2) { self->param2 = param2; }
 
+U32 Instruction_getBranchTarget(Private_Instruction *self) {
+  assert(self->param1 != NULL && "Branch without a target");
+  U32 target = *self->param1;
+  if (self->param2 != NULL) {
+    target |= (U32) *self->param2 << 16;
+  }
+  return target;
+}
+
 bool Instruction_isALU(Private_Instruction *self) {
   if (self->type >= ALU_ADD && self->type <= ALU_CMP) {
     return true;
@@ -53,3 +131,32 @@ bool Instruction_isMMU(Private_Instruction *self) {
   }
   return false;
 }
+
+static InstructionOperandKind Instruction_packOperand(Register const *operand, Register const *pDataRegisters,
+                                                     U16 *pValue) {
+  if (operand == NULL) {
+    *pValue = 0;
+    return INSTRUCTION_OPERAND_NONE;
+  }
+  if (pDataRegisters != NULL && operand >= pDataRegisters && operand < pDataRegisters + CPU_DATA_REGISTRY_LIST_SIZE) {
+    *pValue = (U16) (operand - pDataRegisters);
+    return INSTRUCTION_OPERAND_REGISTER;
+  }
+  *pValue = *operand;
+  return INSTRUCTION_OPERAND_IMMEDIATE;
+}
+
+bool Instruction_pack(Private_Instruction *self, Register const *pDataRegisters, PackedInstruction *pPacked) {
+  U16 operand0;
+  U16 operand1;
+  // Branch targets are resolved when the program is loaded, so they are always folded.
+  bool branch = InstructionType_isBranch(self->type);
+  InstructionOperandKind kind0 = Instruction_packOperand(self->param1, branch ? NULL : pDataRegisters, &operand0);
+  InstructionOperandKind kind1 = Instruction_packOperand(self->param2, pDataRegisters, &operand1);
+  if (InstructionType_isALU(self->type) && self->type != ALU_CMP && kind0 != INSTRUCTION_OPERAND_REGISTER) {
+    return false;
+  }
+
+  *pPacked = PackedInstruction_make(self->type, kind0, operand0, kind1, operand1);
+  return true;
+}
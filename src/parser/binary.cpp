@@ -0,0 +1,160 @@
+#include "binary.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <model/InstructionType.h>
+
+namespace parser::binary {
+namespace {
+constexpr auto entriesOffset = sizeof(Header);
+
+auto namesOffset(Header const& header) noexcept -> uint64_t {
+  return entriesOffset + uint64_t{header.entryCount} * sizeof(Entry);
+}
+
+auto stringsOffset(Header const& header) noexcept -> uint64_t {
+  return namesOffset(header) + uint64_t{header.nameCount} * sizeof(Name);
+}
+
+template <typename T> auto read(std::string_view bytes, uint64_t offset) noexcept -> T {
+  T value;
+  std::memcpy(&value, bytes.data() + offset, sizeof(T));
+  return value;
+}
+
+template <typename T> auto append(std::string& bytes, T const& value) {
+  bytes.append(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+auto validOperand(Header const& header, OperandKind kind, uint32_t operand) noexcept -> bool {
+  switch (kind) {
+    case OperandKind::None:
+      return operand == 0;
+    case OperandKind::Constant:
+      return operand <= std::numeric_limits<uint16_t>::max();
+    case OperandKind::Reference:
+      return operand < header.nameCount;
+    default:
+      return false;
+  }
+}
+} // namespace
+
+auto hash(std::string_view bytes) noexcept -> uint64_t {
+  constexpr uint64_t multiplier = 0x9e3779b97f4a7c15u;
+  auto mix = [](uint64_t value, uint64_t word) noexcept {
+    value = (value ^ word) * multiplier;
+    return value ^ value >> 29u;
+  };
+
+  uint64_t value = bytes.length() * multiplier;
+  size_t offset = 0;
+  for (; offset + sizeof(uint64_t) <= bytes.length(); offset += sizeof(uint64_t)) {
+    value = mix(value, read<uint64_t>(bytes, offset));
+  }
+  uint64_t tail = 0;
+  if (offset < bytes.length()) {
+    std::memcpy(&tail, bytes.data() + offset, bytes.length() - offset);
+  }
+  return mix(mix(value, tail), multiplier);
+}
+
+auto Writer::name(std::string_view name) -> uint32_t {
+  auto [it, inserted] = _nameIndices.try_emplace(name, static_cast<uint32_t>(_names.size()));
+  if (inserted) {
+    _names.push_back(Name {
+        .offset = static_cast<uint32_t>(_strings.length()),
+        .length = static_cast<uint32_t>(name.length())
+    });
+    _strings.append(name);
+  }
+  return it->second;
+}
+
+auto Writer::add(Entry const& entry) -> void {
+  _entries.push_back(entry);
+}
+
+auto Writer::finish(uint64_t sourceLength, uint64_t sourceHash) const -> std::string {
+  Header header {
+      .magic = {},
+      .version = version,
+      .entryCount = static_cast<uint32_t>(_entries.size()),
+      .nameCount = static_cast<uint32_t>(_names.size()),
+      .stringTableLength = static_cast<uint32_t>(_strings.length()),
+      .sourceLength = sourceLength,
+      .sourceHash = sourceHash,
+      .payloadHash = 0
+  };
+  std::copy(std::begin(magic), std::end(magic), header.magic);
+
+  std::string bytes;
+  bytes.reserve(stringsOffset(header) + header.stringTableLength);
+  append(bytes, header);
+  for (auto const& entry : _entries) {
+    append(bytes, entry);
+  }
+  for (auto const& name : _names) {
+    append(bytes, name);
+  }
+  bytes.append(_strings);
+
+  header.payloadHash = hash(std::string_view{bytes}.substr(sizeof(Header)));
+  std::memcpy(bytes.data(), &header, sizeof(Header));
+  return bytes;
+}
+
+auto Image::open(std::string_view bytes) noexcept -> std::optional<Image> {
+  if (bytes.length() < sizeof(Header)) {
+    return std::nullopt;
+  }
+  auto const header = read<Header>(bytes, 0);
+  if (!std::equal(std::begin(magic), std::end(magic), header.magic) || header.version != version
+      || stringsOffset(header) + header.stringTableLength != bytes.length()
+      || hash(bytes.substr(sizeof(Header))) != header.payloadHash) {
+    return std::nullopt;
+  }
+
+  Image const image{bytes, header};
+  for (uint32_t i = 0; i < header.nameCount; ++i) {
+    auto const name = read<Name>(bytes, namesOffset(header) + uint64_t{i} * sizeof(Name));
+    if (name.length == 0 || uint64_t{name.offset} + name.length > header.stringTableLength) {
+      return std::nullopt;
+    }
+  }
+
+  uint32_t instructionCount = 0;
+  uint32_t line = 1;
+  for (uint32_t i = 0; i < header.entryCount; ++i) {
+    auto const entry = image.entry(i);
+    if (entry.index != instructionCount || entry.line < line
+        || !validOperand(header, entry.operandKinds[0], entry.operands[0])
+        || !validOperand(header, entry.operandKinds[1], entry.operands[1])) {
+      return std::nullopt;
+    }
+    line = entry.line;
+
+    if (entry.kind == EntryKind::Instruction) {
+      if (entry.type < ALU_ADD || entry.type > MMU_POP) {
+        return std::nullopt;
+      }
+      ++instructionCount;
+    } else if (entry.kind != EntryKind::Label || entry.type != DEFAULT
+               || entry.operandKinds[0] != OperandKind::Reference || entry.operandKinds[1] != OperandKind::None) {
+      return std::nullopt;
+    }
+  }
+  return image;
+}
+
+auto Image::entry(uint32_t index) const noexcept -> Entry {
+  return read<Entry>(_bytes, entriesOffset + uint64_t{index} * sizeof(Entry));
+}
+
+auto Image::name(uint32_t index) const noexcept -> std::string_view {
+  auto const name = read<Name>(_bytes, namesOffset(_header) + uint64_t{index} * sizeof(Name));
+  return _bytes.substr(stringsOffset(_header) + name.offset, name.length);
+}
+} // namespace parser::binary
@@ -0,0 +1,95 @@
+//
+// Binary form of a parsed program, emitted by getParserBinaryProgram and loaded through
+// PARSER_INPUT_TYPE_BINARY or the program cache. Layout, in host byte order:
+//   Header | Entry[entryCount] | Name[nameCount] | string table
+//
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace parser::binary {
+inline constexpr char magic[8] {'E', 'S', 'I', 'M', 'P', 'R', 'O', 'G'};
+inline constexpr uint32_t version = 1;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t entryCount;
+  uint32_t nameCount;
+  uint32_t stringTableLength;
+  uint64_t sourceLength;
+  uint64_t sourceHash;
+  uint64_t payloadHash; // Everything after the header.
+};
+
+enum class EntryKind : uint8_t {
+  Instruction,
+  Label,
+};
+
+enum class OperandKind : uint8_t {
+  None,
+  Constant,
+  Reference,
+};
+
+// Instructions and labels in source order. A label's index is that of the instruction it
+// precedes and its name is operands[0].
+struct Entry {
+  uint32_t index;
+  uint32_t line;
+  EntryKind kind;
+  uint8_t type;
+  OperandKind operandKinds[2];
+  uint32_t operands[2]; // Constant value or Name index.
+};
+
+// Referenced register and label names, each stored once.
+struct Name {
+  uint32_t offset;
+  uint32_t length;
+};
+
+// Non-cryptographic 64-bit hash, eight bytes per step.
+[[nodiscard]] auto hash(std::string_view bytes) noexcept -> uint64_t;
+
+// Interns names by view, so they must outlive the writer.
+class Writer {
+public:
+  auto name(std::string_view name) -> uint32_t;
+  auto add(Entry const& entry) -> void;
+  [[nodiscard]] auto finish(uint64_t sourceLength, uint64_t sourceHash) const -> std::string;
+
+private:
+  std::vector<Entry> _entries;
+  std::vector<Name> _names;
+  std::string _strings;
+  std::unordered_map<std::string_view, uint32_t> _nameIndices;
+};
+
+// Image whose layout, checksum, names and entry encoding were validated when opened. Whether
+// an instruction's operand count fits its type is left to the caller.
+class Image {
+public:
+  [[nodiscard]] static auto open(std::string_view bytes) noexcept -> std::optional<Image>;
+
+  [[nodiscard]] auto header() const noexcept -> Header const& {
+    return _header;
+  }
+
+  [[nodiscard]] auto entry(uint32_t index) const noexcept -> Entry;
+  [[nodiscard]] auto name(uint32_t index) const noexcept -> std::string_view;
+
+private:
+  Image(std::string_view bytes, Header const& header) noexcept : _bytes{bytes}, _header{header} {}
+
+  std::string_view _bytes;
+  Header _header;
+};
+} // namespace parser::binary
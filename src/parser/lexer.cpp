@@ -0,0 +1,107 @@
+#include "lexer.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LEXER_SCAN_X86_64
+#include <immintrin.h>
+#endif
+
+namespace parser {
+namespace {
+using detail::BlockClass;
+using detail::ClassifyFunction;
+using detail::isBlank;
+using detail::scanBlockLength;
+
+#ifdef LEXER_SCAN_X86_64
+// Tail of the source, shorter than a block.
+auto classifyScalar(char const* pBlock, size_t length) noexcept -> BlockClass {
+  BlockClass block {.blank = length < scanBlockLength ? ~uint64_t{0} << length : 0, .newLine = 0};
+  for (size_t i = 0; i < length; ++i) {
+    block.blank |= uint64_t{isBlank(pBlock[i])} << i;
+    block.newLine |= uint64_t{pBlock[i] == '\n'} << i;
+  }
+  return block;
+}
+
+// '\t', '\v', '\f' and '\r' are 9, 11, 12 and 13, i.e. the (8, 14) range without '\n'. Bytes
+// above 0x7f compare as negative and fall outside it.
+auto classifySse2(char const* pBlock, size_t length) noexcept -> BlockClass {
+  if (length < scanBlockLength) {
+    return classifyScalar(pBlock, length);
+  }
+
+  BlockClass block {.blank = 0, .newLine = 0};
+  for (unsigned i = 0; i < scanBlockLength; i += 16) {
+    auto const bytes = _mm_loadu_si128(reinterpret_cast<__m128i const*>(pBlock + i));
+    auto const newLine = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n'));
+    auto const space = _mm_or_si128(
+        _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8(',')));
+    auto const control = _mm_andnot_si128(
+        newLine, _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8(8)), _mm_cmplt_epi8(bytes, _mm_set1_epi8(14))));
+    block.blank |= uint64_t{static_cast<uint16_t>(_mm_movemask_epi8(_mm_or_si128(space, control)))} << i;
+    block.newLine |= uint64_t{static_cast<uint16_t>(_mm_movemask_epi8(newLine))} << i;
+  }
+  return block;
+}
+
+__attribute__((target("avx2"))) auto classifyAvx2(char const* pBlock, size_t length) noexcept -> BlockClass {
+  if (length < scanBlockLength) {
+    return classifyScalar(pBlock, length);
+  }
+
+  BlockClass block {.blank = 0, .newLine = 0};
+  for (unsigned i = 0; i < scanBlockLength; i += 32) {
+    auto const bytes = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(pBlock + i));
+    auto const newLine = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n'));
+    auto const space = _mm256_or_si256(
+        _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(',')));
+    auto const control = _mm256_andnot_si256(
+        newLine,
+        _mm256_and_si256(
+            _mm256_cmpgt_epi8(bytes, _mm256_set1_epi8(8)), _mm256_cmpgt_epi8(_mm256_set1_epi8(14), bytes)));
+    block.blank |= uint64_t{static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(space, control)))} << i;
+    block.newLine |= uint64_t{static_cast<uint32_t>(_mm256_movemask_epi8(newLine))} << i;
+  }
+  return block;
+}
+#endif
+} // namespace
+
+auto isScanKernelSupported(ScanKernel kernel) noexcept -> bool {
+  switch (kernel) {
+    case ScanKernel::Scalar:
+      return true;
+#ifdef LEXER_SCAN_X86_64
+    case ScanKernel::Sse2:
+      return true;
+    case ScanKernel::Avx2:
+      return __builtin_cpu_supports("avx2");
+#endif
+    default:
+      return false;
+  }
+}
+
+auto bestScanKernel() noexcept -> ScanKernel {
+  static auto const kernel = isScanKernelSupported(ScanKernel::Avx2) ? ScanKernel::Avx2
+      : isScanKernelSupported(ScanKernel::Sse2)                      ? ScanKernel::Sse2
+                                                                     : ScanKernel::Scalar;
+  return kernel;
+}
+
+auto detail::classifyFunction(ScanKernel kernel) noexcept -> ClassifyFunction {
+  if (!isScanKernelSupported(kernel)) {
+    return nullptr;
+  }
+  switch (kernel) {
+#ifdef LEXER_SCAN_X86_64
+    case ScanKernel::Sse2:
+      return classifySse2;
+    case ScanKernel::Avx2:
+      return classifyAvx2;
+#endif
+    default:
+      return nullptr;
+  }
+}
+} // namespace parser
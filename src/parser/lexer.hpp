@@ -0,0 +1,149 @@
+//
+// Tokenizer front end of the parser. The source is classified 64 bytes at a time into
+// separator and line break bitmasks by a kernel picked at run time (SSE2 or AVX2 on x86-64),
+// and token boundaries are then found by counting trailing zeros. Without vector kernels the
+// source is scanned byte by byte, which is faster than classifying blocks with scalar code.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+
+namespace parser {
+enum class ScanKernel {
+  Scalar,
+  Sse2,
+  Avx2,
+};
+
+// Widest kernel the host supports.
+[[nodiscard]] auto bestScanKernel() noexcept -> ScanKernel;
+[[nodiscard]] auto isScanKernelSupported(ScanKernel kernel) noexcept -> bool;
+
+namespace detail {
+inline constexpr size_t scanBlockLength = 64;
+
+constexpr auto isBlank(char c) noexcept -> bool {
+  return c == ' ' || c == ',' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Bit i describes byte i of a block. Bytes past the end of the source count as blanks.
+struct BlockClass {
+  uint64_t blank;   // Separators: ' ', ',', '\t', '\r', '\v', '\f'.
+  uint64_t newLine;
+};
+
+using ClassifyFunction = auto (*)(char const* pBlock, size_t length) noexcept -> BlockClass;
+
+// nullptr for the scalar kernel, which the lexer runs byte by byte. Unsupported kernels
+// resolve to the scalar one.
+[[nodiscard]] auto classifyFunction(ScanKernel kernel) noexcept -> ClassifyFunction;
+} // namespace detail
+
+struct LexedToken {
+  std::string_view text;
+  unsigned line;
+  unsigned column;
+};
+
+// Single pass over the source yielding the whitespace or comma separated tokens as views,
+// with 1-based line and column numbers.
+class Lexer {
+public:
+  explicit Lexer(std::string_view source, ScanKernel kernel = bestScanKernel()) noexcept :
+      _source{source}, _classify{detail::classifyFunction(kernel)} {}
+
+  auto next() noexcept -> std::optional<LexedToken> {
+    if (_classify == nullptr) {
+      return nextByteByByte();
+    }
+    for (;;) {
+      if (!seek([](detail::BlockClass const& block) { return ~block.blank; })) {
+        return std::nullopt;
+      }
+      if (_block.newLine >> (_offset - _blockOffset) & 1u) {
+        ++_line;
+        _lineStart = ++_offset;
+        continue;
+      }
+
+      auto const begin = _offset;
+      seek([](detail::BlockClass const& block) { return block.blank | block.newLine; });
+      auto const end = std::min(_offset, _source.length());
+      return LexedToken {
+          .text = _source.substr(begin, end - begin),
+          .line = _line,
+          .column = static_cast<unsigned>(begin - _lineStart + 1)
+      };
+    }
+  }
+
+  // Drops the rest of the current line, e.g. after a comment marker.
+  auto skipLine() noexcept -> void {
+    auto const newLine = _source.find('\n', _offset);
+    _offset = newLine == std::string_view::npos ? _source.length() : newLine;
+  }
+
+  // Number of lines, not counting an empty one after a final line break.
+  [[nodiscard]] auto lineCount() const noexcept -> unsigned {
+    return _source.empty() || _source.ends_with('\n') ? _line - 1 : _line;
+  }
+
+private:
+  auto nextByteByByte() noexcept -> std::optional<LexedToken> {
+    while (_offset < _source.length()) {
+      auto const c = _source[_offset];
+      if (c == '\n') {
+        ++_line;
+        _lineStart = ++_offset;
+      } else if (detail::isBlank(c)) {
+        ++_offset;
+      } else {
+        auto const begin = _offset;
+        while (_offset < _source.length() && _source[_offset] != '\n' && !detail::isBlank(_source[_offset])) {
+          ++_offset;
+        }
+        return LexedToken {
+            .text = _source.substr(begin, _offset - begin),
+            .line = _line,
+            .column = static_cast<unsigned>(begin - _lineStart + 1)
+        };
+      }
+    }
+    return std::nullopt;
+  }
+
+  // Advances _offset to the first byte whose bit is set in mask(classification of its
+  // block). False when the source ends first.
+  template <typename Mask> auto seek(Mask&& mask) noexcept -> bool {
+    using detail::scanBlockLength;
+    while (_offset < _source.length()) {
+      if (_offset - _blockOffset >= scanBlockLength) {
+        _blockOffset = _offset - _offset % scanBlockLength;
+        _block = _classify(_source.data() + _blockOffset,
+                           std::min(scanBlockLength, _source.length() - _blockOffset));
+      }
+      if (auto const bits = mask(_block) >> (_offset - _blockOffset); bits != 0) {
+        _offset += static_cast<size_t>(std::countr_zero(bits));
+        return true;
+      }
+      _offset = _blockOffset + scanBlockLength;
+    }
+    return false;
+  }
+
+  std::string_view _source;
+  detail::ClassifyFunction _classify;
+  detail::BlockClass _block {};
+  size_t _blockOffset {std::numeric_limits<size_t>::max() / 2};
+  size_t _offset {0};
+  size_t _lineStart {0};
+  unsigned _line {1};
+};
+} // namespace parser
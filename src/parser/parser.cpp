@@ -1,17 +1,29 @@
 // Created by logout
 
 #include "parser.h"
+#include "binary.hpp"
+#include "lexer.hpp"
+#include "symbols.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <charconv>
+#include <cstdint>
 #include <functional>
 #include <filesystem>
+#include <cstdio>
 #include <fstream>
 #include <memory>
 #include <numeric>
 #include <iostream>
 #include <optional>
+#include <random>
 #include <string>
+#include <system_error>
 #include <sstream>
+#include <thread>
 #include <tuple>
 #include <utility>
 #include <unordered_map>
@@ -25,16 +37,22 @@
 #include <generic/cxx/StructureTypeUtils.hpp>
 #include <generic/cxx/RAII.hpp>
 
+#if defined(__unix__) || defined(__APPLE__)
+#define PARSER_MAPPED_INPUT
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace {
-using std::iota;
-using std::addressof;
+using std::array;
 using std::char_traits;
-using std::construct_at;
-using std::destroy_at;
+using std::errc;
 using std::exception;
 using std::exchange;
-using std::holds_alternative;
-using std::getline;
+using std::from_chars;
+using std::get_if;
 using std::fstream;
 using std::ios;
 using std::invoke;
@@ -53,13 +71,27 @@ using std::unordered_map;
 using std::variant;
 using std::vector;
 
+using parser::Lexer;
+using parser::Symbol;
+using parser::SymbolTable;
+using parser::symbolIndex;
+
+namespace binary = parser::binary;
+
 namespace fs = std::filesystem;
 
-using Reference = string;
+// References and labels are symbols of the parser's table, so that encoded instructions hold
+// no strings.
+using Reference = Symbol;
 using Constant = unsigned;
 using Parameter = variant<Reference, Constant>;
-using Instr = tuple<InstructionType, optional<Parameter>, optional<Parameter>>;
-using Label = string;
+using Label = Symbol;
+
+struct Instr {
+  InstructionType type;
+  optional<Parameter> p0;
+  optional<Parameter> p1;
+};
 
 enum class FeedResult {
   Full,
@@ -75,6 +107,8 @@ class NoMessageException : public exception {
 
 class InvalidPathException : public NoMessageException {};
 
+class InvalidBinaryException : public NoMessageException {};
+
 class InvalidTokenException : public exception {
 public:
   explicit InvalidTokenException(string_view token, unsigned lOffset = 0, unsigned cOffset = 0) :
@@ -122,7 +156,12 @@ private:
   unsigned _column;
 };
 
-unordered_map<string_view, InstructionType> const iTypeMap {
+struct Mnemonic {
+  string_view name;
+  InstructionType type;
+};
+
+constexpr Mnemonic mnemonics[] {
     {"add", ALU_ADD},
     {"sub", ALU_SUB},
     {"mul", ALU_MUL},
@@ -148,6 +187,84 @@ unordered_map<string_view, InstructionType> const iTypeMap {
     {"pop", MMU_POP}
 };
 
+// Perfect hash over mnemonics, built during compilation. A token of up to maxLength
+// characters packs into a key together with its length, so a lookup is one multiplicative
+// hash and one key compare, and empty slots (key 0) never match.
+class MnemonicTable {
+public:
+  static constexpr size_t maxLength = 4;
+
+  constexpr MnemonicTable() noexcept {
+    // Odd multipliers from a fixed LCG sequence until one maps every mnemonic to its own slot.
+    for (uint64_t seed = 1; _multiplier == 0; seed = seed * 6364136223846793005u + 1442695040888963407u) {
+      auto const multiplier = seed | 1u;
+      if (fill(multiplier)) {
+        _multiplier = multiplier;
+      }
+    }
+  }
+
+  [[nodiscard]] constexpr auto find(string_view token) const noexcept -> optional<InstructionType> {
+    if (token.length() > maxLength) {
+      return nullopt;
+    }
+    auto const key = makeKey(token);
+    if (auto const& slot = _slots[slotIndex(key, _multiplier)]; slot.key == key) {
+      return slot.type;
+    }
+    return nullopt;
+  }
+
+private:
+  static constexpr unsigned slotBits = 6;
+
+  struct Slot {
+    uint64_t key {0};
+    InstructionType type {};
+  };
+
+  static constexpr auto makeKey(string_view token) noexcept -> uint64_t {
+    uint64_t key = uint64_t{token.length()} << 32u;
+    for (size_t i = 0; i < token.length(); ++i) {
+      key |= uint64_t{static_cast<unsigned char>(token[i])} << 8u * i;
+    }
+    return key;
+  }
+
+  static constexpr auto slotIndex(uint64_t key, uint64_t multiplier) noexcept -> size_t {
+    return static_cast<size_t>(key * multiplier >> (64u - slotBits));
+  }
+
+  constexpr auto fill(uint64_t multiplier) noexcept -> bool {
+    for (auto& slot : _slots) {
+      slot = Slot{};
+    }
+    for (auto const& [name, type] : mnemonics) {
+      auto& slot = _slots[slotIndex(makeKey(name), multiplier)];
+      if (slot.key != 0) {
+        return false;
+      }
+      slot = Slot{.key = makeKey(name), .type = type};
+    }
+    return true;
+  }
+
+  uint64_t _multiplier {0};
+  Slot _slots[size_t{1} << slotBits] {};
+};
+
+constexpr MnemonicTable mnemonicTable;
+
+static_assert([] {
+  for (auto const& [name, type] : mnemonics) {
+    if (name.length() > MnemonicTable::maxLength || mnemonicTable.find(name) != type) {
+      return false;
+    }
+  }
+  return !mnemonicTable.find("") && !mnemonicTable.find("r0") && !mnemonicTable.find("addr")
+      && !mnemonicTable.find("calls") && !mnemonicTable.find(string_view{"\0", 1});
+}(), "Every mnemonic must be found and nothing else");
+
 auto instructionOpCount(InstructionType type) noexcept -> tuple<unsigned, unsigned> {
   switch (type) {
     case ALU_ADD:
@@ -184,16 +301,30 @@ auto instructionOpCount(InstructionType type) noexcept -> tuple<unsigned, unsign
 }
 
 auto op(string_view token) noexcept -> optional<InstructionType> {
-  if (auto const it = iTypeMap.find(token);
-      it != iTypeMap.end()) {
-    return it->second;
+  return mnemonicTable.find(token);
+}
+
+// Constant operands and resolved labels point into this table, shared read-only by every
+// parser, so programs must never write through them.
+constexpr auto constantTable = [] {
+  array<Register, size_t{numeric_limits<Register>::max()} + 1> table {};
+  for (size_t value = 0; value < table.size(); ++value) {
+    table[value] = static_cast<Register>(value);
   }
-  return nullopt;
+  return table;
+}();
+
+auto constantAddress(unsigned value) noexcept -> Register* {
+  assert(value < constantTable.size() && "Constant out of range");
+  return const_cast<Register*>(&constantTable[value]);
 }
 
-template <typename T> auto revive(T&& object) {
-  destroy_at(addressof(std::forward<T>(object)));
-  construct_at(addressof(object));
+// Labels resolve to instruction indices, which fit a single operand only up to this one.
+constexpr auto maxLabelValue = unsigned{numeric_limits<Register>::max()};
+
+auto isConstantAddress(Register const* pRegister) noexcept -> bool {
+  return std::less_equal<>{}(constantTable.data(), pRegister)
+      && std::less<>{}(pRegister, constantTable.data() + constantTable.size());
 }
 
 auto sanitize(string_view sv) {
@@ -215,16 +346,85 @@ auto sanitize(string_view sv) {
   return sv;
 }
 
-auto parsePath(string_view path) -> string {
-  if (!fs::exists(path)) {
-    throw InvalidPathException();
+// Parser input: either owned text or a read-only mapping of a regular file, which is then
+// parsed straight from the page cache.
+class Source {
+public:
+  explicit Source(string&& text) noexcept : _text{std::move(text)} {}
+  Source(Source&& source) noexcept :
+      _text{std::move(source._text)},
+      _pMapped{exchange(source._pMapped, nullptr)},
+      _mappedLength{exchange(source._mappedLength, 0)} {}
+  Source(Source const&) = delete;
+  auto operator=(Source const&) -> Source& = delete;
+  auto operator=(Source&&) -> Source& = delete;
+
+  ~Source() noexcept {
+#ifdef PARSER_MAPPED_INPUT
+    if (_pMapped) {
+      munmap(const_cast<char*>(_pMapped), _mappedLength);
+    }
+#endif
   }
 
-  fstream file{path.data(), ios::in};
-  stringstream buffer;
-  buffer << file.rdbuf();
-  return buffer.str();
-}
+  // Regular files are mapped; pipes and other special files are read in full.
+  static auto fromPath(string const& path) -> Source {
+#ifdef PARSER_MAPPED_INPUT
+    struct FileDescriptor {
+      int fd;
+      ~FileDescriptor() noexcept {
+        if (fd >= 0) {
+          close(fd);
+        }
+      }
+    } const file {open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+    auto const fd = file.fd;
+    if (fd < 0) {
+      throw InvalidPathException();
+    }
+
+    struct stat status {};
+    if (fstat(fd, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0) {
+      auto const length = static_cast<size_t>(status.st_size);
+      if (auto* pMapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0); pMapped != MAP_FAILED) {
+        madvise(pMapped, length, MADV_SEQUENTIAL);
+        return Source{static_cast<char const*>(pMapped), length};
+      }
+    }
+
+    string text;
+    char buffer[1u << 16u];
+    ssize_t count;
+    while ((count = read(fd, buffer, sizeof(buffer))) > 0) {
+      text.append(buffer, static_cast<size_t>(count));
+    }
+    if (count < 0) {
+      throw InvalidPathException();
+    }
+    return Source{std::move(text)};
+#else
+    if (!fs::exists(path)) {
+      throw InvalidPathException();
+    }
+
+    fstream file{path, ios::in};
+    stringstream buffer;
+    buffer << file.rdbuf();
+    return Source{buffer.str()};
+#endif
+  }
+
+  [[nodiscard]] auto view() const noexcept -> string_view {
+    return _pMapped ? string_view{_pMapped, _mappedLength} : string_view{_text};
+  }
+
+private:
+  Source(char const* pMapped, size_t mappedLength) noexcept : _pMapped{pMapped}, _mappedLength{mappedLength} {}
+
+  string _text;
+  char const* _pMapped {nullptr};
+  size_t _mappedLength {0};
+};
 
 auto validateLabel(string_view token) {
   auto inRange = [](auto b, auto e, auto t) {
@@ -246,35 +446,37 @@ auto validateLabel(string_view token) {
   return token;
 }
 
-auto replaceUnnecessary(string& str) {
-  for (auto& c : str) {
-    if (c == ',') {
-      c = ' ';
-    }
-  }
-}
-
+// Fixed-size record of an instruction or a label. Each operand is a constant or a symbol,
+// tagged by two bits of _kinds; a label is tagged by another bit and holds its symbol as the
+// first operand.
 class EncodedInstruction {
 public:
-  explicit EncodedInstruction(InstructionType type, unsigned idx) noexcept :
-      _idx{idx}, _encoded{Instr{type, nullopt, nullopt}} {}
-  explicit EncodedInstruction(string_view sv, unsigned refInstrIdx) noexcept :
-      _idx{refInstrIdx}, _encoded{Label{sv}} {}
+  explicit EncodedInstruction(InstructionType type, unsigned idx, unsigned line) noexcept :
+      _idx{idx}, _line{line}, _type{static_cast<uint8_t>(type)} {}
+  explicit EncodedInstruction(Instr const& instr, unsigned idx, unsigned line) noexcept :
+      EncodedInstruction{instr.type, idx, line} {
+    for (auto const* p : {&instr.p0, &instr.p1}) {
+      if (*p) {
+        addParam(**p);
+      }
+    }
+  }
+  explicit EncodedInstruction(Label label, unsigned refInstrIdx, unsigned line) noexcept :
+      _operands{static_cast<uint32_t>(label), 0}, _idx{refInstrIdx}, _line{line}, _kinds{labelTag} {}
 
-  auto feed(string_view sv, bool final) -> FeedResult {
+  auto feed(string_view sv, bool final, SymbolTable& symbols) -> FeedResult {
     using enum FeedResult;
     if (sv == ":" || sv == ";") {
       return AcceptedFinished;
     }
 
-    assert(holds_alternative<Instr>(_encoded) && "Unexpected parametrized label");
-    auto& [type, _0, _1] = get<Instr>(_encoded);
-    auto const [minParamCount, maxParamCount] = instructionOpCount(type);
+    assert(!label() && "Unexpected parametrized label");
+    auto const [minParamCount, maxParamCount] = instructionOpCount(type());
     auto const paramCount = currentParameterCount();
     if (paramCount == maxParamCount) {
       return Full;
     }
-    addParam(makeParam(sanitize(sv)));
+    addParam(makeParam(sanitize(sv), symbols));
     if (paramCount == maxParamCount) {
       return AcceptedFinished;
     }
@@ -290,90 +492,153 @@ public:
     return _idx;
   }
 
-  template <typename IfInstr, typename IfLabel> [[nodiscard]]
-  decltype(auto) visit(IfInstr&& ifInstr, IfLabel&& ifLabel) {
-    return std::visit([this, &ifLabel, &ifInstr]<typename DT>(DT&& val) {
-      using T = remove_cvref_t<DT>;
-      if constexpr (is_same_v<T, Instr>) {
-        auto&& [type, p0, p1] = val;
-        return invoke(ifInstr, type, std::move(p0), std::move(p1));
-      } else if constexpr (is_same_v<T, Label>) {
-        return invoke(ifLabel, std::move(std::forward<DT>(val)), _idx);
-      } else {
-        assert(false && "Unhandled EncodedInstruction alternative");
-        terminate();
+  [[nodiscard]] auto line() const noexcept {
+    return _line;
+  }
+
+  // Line of the token that closed the instruction, which for an unterminated one is the
+  // token after it. The tokenizer is idle at the start of any later line. Instructions
+  // spanning maxLineSpan lines or more never end, so no line after them looks idle.
+  [[nodiscard]] auto endLine() const noexcept -> unsigned {
+    return _lineSpan == maxLineSpan ? numeric_limits<unsigned>::max() : _line + _lineSpan;
+  }
+
+  auto close(unsigned endLine) noexcept {
+    _lineSpan = static_cast<uint16_t>(std::min<unsigned>(endLine - _line, maxLineSpan));
+  }
+
+  // Offsets wrap around, so they may stand for negative shifts.
+  auto relocate(unsigned indexOffset, unsigned lineOffset) noexcept {
+    _idx += indexOffset;
+    _line += lineOffset;
+  }
+
+  [[nodiscard]] auto label() const noexcept -> optional<Label> {
+    if (_kinds & labelTag) {
+      return static_cast<Label>(_operands[0]);
+    }
+    return nullopt;
+  }
+
+  // Moves symbols of another table to this one, symbol s becoming symbols[s].
+  auto remap(vector<Symbol> const& symbols) noexcept {
+    for (unsigned operand = 0; operand < 2; ++operand) {
+      if (label() ? operand == 0 : kind(operand) == OperandKind::Reference) {
+        _operands[operand] = static_cast<uint32_t>(symbols[_operands[operand]]);
       }
-    }, _encoded);
+    }
+  }
+
+  template <typename IfInstr, typename IfLabel> [[nodiscard]]
+  decltype(auto) visit(IfInstr&& ifInstr, IfLabel&& ifLabel) const {
+    if (auto const label = this->label()) {
+      return invoke(ifLabel, *label, _idx);
+    }
+    return invoke(ifInstr, type(), param(0), param(1));
   }
 
   [[nodiscard]] auto incomplete() const noexcept {
-    return holds_alternative<Instr>(_encoded)
-        && currentParameterCount() < get<0>(instructionOpCount(get<0>(get<Instr>(_encoded))));
+    return !label() && currentParameterCount() < get<0>(instructionOpCount(type()));
   }
 
 private:
+  enum class OperandKind : uint8_t {
+    None,
+    Constant,
+    Reference,
+  };
+
+  static constexpr uint8_t labelTag = 1u << 4u;
+  static constexpr auto maxLineSpan = numeric_limits<uint16_t>::max();
+
   static auto makeConstantParam(string_view sv) -> Constant {
     if (sv == "0") {
       return 0;
     }
 
-    char* end = nullptr;
-    auto value = [sv, &end]() {
+    auto [digits, base] = [sv]() -> tuple<string_view, int> {
       if (sv.front() == '0') {
         if (sv[1] == 'b' || sv[1] == 'B') {
-          return strtol(sv.data() + 2, &end, 2);
+          return {sv.substr(2), 2};
         } else if (sv[1] == 'x' || sv[1] == 'X') {
-          return strtol(sv.data() + 2, &end, 16);
+          return {sv.substr(2), 16};
         } else {
-          return strtol(sv.data() + 1, &end, 8);
+          return {sv.substr(1), 8};
         }
       }
-      return strtol(sv.data(), &end, 10);
+      return {sv, 10};
     }();
 
-    if (end < sv.data() + sv.length()) {
+    Constant value = 0;
+    auto const [end, error] = from_chars(digits.data(), digits.data() + digits.length(), value, base);
+    if (error != errc{} || end != digits.data() + digits.length() || value > numeric_limits<Register>::max()) {
       throw InvalidTokenException(sv);
     }
     return value;
   }
 
-  static auto makeReferenceParam(string_view sv) -> Reference {
-    return Reference{sv};
+  static auto makeReferenceParam(string_view sv, SymbolTable& symbols) -> Reference {
+    return symbols.intern(sv);
   }
 
-  static auto makeParam(string_view sv) -> Parameter {
+  static auto makeParam(string_view sv, SymbolTable& symbols) -> Parameter {
     if ('0' <= sv[0] && sv[0] <= '9') {
       return makeConstantParam(sv);
     }
-    return makeReferenceParam(sv);
+    return makeReferenceParam(sv, symbols);
+  }
+
+  [[nodiscard]] auto type() const noexcept -> InstructionType {
+    return static_cast<InstructionType>(_type);
+  }
+
+  [[nodiscard]] auto kind(unsigned operand) const noexcept -> OperandKind {
+    return static_cast<OperandKind>(_kinds >> 2u * operand & 3u);
+  }
+
+  [[nodiscard]] auto param(unsigned operand) const noexcept -> optional<Parameter> {
+    switch (kind(operand)) {
+      case OperandKind::Constant:
+        return Parameter{Constant{_operands[operand]}};
+      case OperandKind::Reference:
+        return Parameter{static_cast<Reference>(_operands[operand])};
+      default:
+        return nullopt;
+    }
   }
 
-  [[nodiscard]] auto currentParameterCount() const -> unsigned {
-    assert(holds_alternative<Instr>(_encoded) && "Invalid instruction encoding");
-    auto const& [_, p0, p1] = get<Instr>(_encoded);
-    if (p0 && p1) {
+  [[nodiscard]] auto currentParameterCount() const noexcept -> unsigned {
+    assert(!label() && "Invalid instruction encoding");
+    if (kind(1) != OperandKind::None) {
       return 2;
     }
-    if (p0) {
+    if (kind(0) != OperandKind::None) {
       return 1;
     }
     return 0;
   }
 
-  auto addParam(Parameter const& p) -> void {
-    assert(holds_alternative<Instr>(_encoded) && "Invalid instruction encoding");
-    auto& [_, p0, p1] = get<Instr>(_encoded);
-    if (!p0) {
-      p0 = p;
-    } else {
-      p1 = p;
-    }
+  auto addParam(Parameter const& p) noexcept -> void {
+    assert(!label() && "Invalid instruction encoding");
+    auto const operand = currentParameterCount();
+    auto const* pConstant = get_if<Constant>(&p);
+    _operands[operand] = pConstant ? *pConstant : static_cast<uint32_t>(get<Reference>(p));
+    _kinds |= static_cast<uint8_t>(
+        static_cast<unsigned>(pConstant ? OperandKind::Constant : OperandKind::Reference) << 2u * operand
+    );
   }
 
-  variant<Label, Instr> _encoded;
+  uint32_t _operands[2] {0, 0}; // Constant value or symbol.
   unsigned _idx;
+  unsigned _line;
+  uint16_t _lineSpan {0}; // Lines from the first to the end line, up to maxLineSpan.
+  uint8_t _type {DEFAULT};
+  uint8_t _kinds {0};
 };
 
+static_assert(std::is_trivially_copyable_v<EncodedInstruction> && sizeof(EncodedInstruction) == 20);
+static_assert(MMU_POP <= numeric_limits<uint8_t>::max(), "Instruction types are stored in a byte");
+
 class UndefinedReferenceException : public exception {
 public:
   UndefinedReferenceException(string_view referencedIdentifier, EncodedInstruction const& referencedFrom) :
@@ -396,8 +661,18 @@ private:
   EncodedInstruction const* _pInstruction {nullptr};
 };
 
+class IllegalParameterException : public exception {
+public:
+  [[nodiscard]] auto what() const noexcept -> char const* override {
+    return "";
+  }
+};
+
+// Interns the identifiers it meets into the table it is bound to.
 class Tokenizer {
 public:
+  explicit Tokenizer(SymbolTable& symbols) noexcept : _pSymbols{&symbols} {}
+
   auto feed(string_view token) -> optional<EncodedInstruction> {
     using enum FeedResult;
     if (_lineComment || !_current && token == "//") {
@@ -417,25 +692,27 @@ public:
 
     if (!_current) {
       if (auto const opToken = op(sanitize(token))) {
-        _current.emplace(*opToken, _instructionIndex++);
+        _current.emplace(*opToken, _instructionIndex++, _line);
         if (finalToken) {
           if (_current->incomplete()) {
             throw InvalidTokenException(";", 0, token.length());
           }
           auto current = std::move(_current);
           _current.reset();
+          current->close(_line);
           return current;
         }
       } else {
-        return EncodedInstruction{validateLabel(token), _instructionIndex};
+        return EncodedInstruction{_pSymbols->intern(validateLabel(token)), _instructionIndex, _line};
       }
     } else {
-      auto res = _current->feed(token, finalToken);
+      auto res = _current->feed(token, finalToken, *_pSymbols);
       switch (res) {
         case AcceptedFinished:
         case Full: {
           auto finished = std::move(*_current);
           _current.reset();
+          finished.close(_line);
           if (res == Full) {
             ignore = feed(token);
           }
@@ -449,11 +726,20 @@ public:
     return nullopt;
   }
 
-  auto newLine() {
+  auto newLine(unsigned line) {
+    _line = line;
     _lineComment = false;
   }
 
-  auto anyRemaining() noexcept -> optional<EncodedInstruction> {
+  [[nodiscard]] auto inLineComment() const noexcept -> bool {
+    return _lineComment;
+  }
+
+  // The instruction still open at the end of input, closed on the line past it.
+  auto anyRemaining(unsigned endLine) noexcept -> optional<EncodedInstruction> {
+    if (_current) {
+      _current->close(endLine);
+    }
     return _current;
   }
 
@@ -461,61 +747,363 @@ public:
     return _current && _current->incomplete();
   }
 
+  // No instruction is open, so the next token starts a new one or a label.
+  [[nodiscard]] auto idle() const noexcept -> bool {
+    return !_current;
+  }
+
+  [[nodiscard]] auto instructionCount() const noexcept -> unsigned {
+    return _instructionIndex;
+  }
+
+  auto relocate(unsigned indexOffset, unsigned lineOffset) noexcept {
+    _instructionIndex += indexOffset;
+    _line += lineOffset;
+    if (_current) {
+      _current->relocate(indexOffset, lineOffset);
+    }
+  }
+
+  // Binds to another table, symbol s of the current one becoming remapped[s].
+  auto rebind(SymbolTable& symbols, vector<Symbol> const& remapped) noexcept {
+    _pSymbols = &symbols;
+    if (_current) {
+      _current->remap(remapped);
+    }
+  }
+
 private:
+  SymbolTable* _pSymbols;
   bool _lineComment {false};
+  unsigned _line {1};
   unsigned _instructionIndex {0};
   optional<EncodedInstruction> _current {nullopt};
 };
 
-class CxxParser {
-public:
-  explicit CxxParser(string&& code) : _code{std::move(code)} {
-    _possibleConstants.resize(numeric_limits<Register>::max());
-    iota(_possibleConstants.begin(), _possibleConstants.end(), 0);
-    Tokenizer tokenizer;
-    string line;
-    unsigned lineIndex = 0;
-    while (getline(_code, line)) {
-      ++lineIndex;
-      tokenizer.newLine();
-      replaceUnnecessary(line);
-      stringstream lineBuf{std::move(line)};
-      revive(line);
-      string token;
-      while (lineBuf >> token) {
-        try {
-          if (auto maybeInstruction = tokenizer.feed(token)) {
-            _encodedInstructions.push_back(std::move(*maybeInstruction));
-          }
-        } catch (InvalidTokenException const& tokenException) {
-          throw LocatedInvalidTokenException(tokenException, lineIndex, lineBuf.str().find(token) + 1);
-        }
+// Feeds the tokens of whole lines to tokenizer and appends what it finishes to encoded. Lines
+// are numbered from lineOffset + 1. onLine(line) runs before the first token of every line
+// and stops tokenizing by returning true. Yields the number of lines read.
+template <typename OnLine>
+auto tokenizeLines(
+    string_view text,
+    Tokenizer& tokenizer,
+    vector<EncodedInstruction>& encoded,
+    unsigned lineOffset,
+    OnLine&& onLine
+) -> unsigned {
+  Lexer lexer{text};
+  unsigned line = 0;
+  while (auto token = lexer.next()) {
+    if (token->line != line) {
+      line = token->line;
+      if (onLine(lineOffset + line)) {
+        break;
+      }
+      tokenizer.newLine(lineOffset + line);
+    }
+    try {
+      if (auto maybeInstruction = tokenizer.feed(token->text)) {
+        encoded.push_back(std::move(*maybeInstruction));
+      }
+      if (tokenizer.inLineComment()) {
+        lexer.skipLine();
       }
+    } catch (InvalidTokenException const& tokenException) {
+      throw LocatedInvalidTokenException(tokenException, lineOffset + token->line, token->column);
+    }
+  }
+  return lexer.lineCount();
+}
+
+// Ends a source of lineCount lines, where an instruction may still be open.
+auto finishLines(Tokenizer& tokenizer, vector<EncodedInstruction>& encoded, unsigned lineCount) -> void {
+  if (tokenizer.incomplete()) {
+    throw LocatedInvalidTokenException(InvalidTokenException("<EOF>"), lineCount + 1, 0);
+  }
+  if (auto maybeInstruction = tokenizer.anyRemaining(lineCount + 1)) {
+    encoded.push_back(std::move(*maybeInstruction));
+  }
+}
+
+// Splits source after line breaks into chunks of at least chunkLength bytes.
+auto splitLines(string_view source, size_t chunkLength) -> vector<string_view> {
+  vector<string_view> chunks;
+  while (!source.empty()) {
+    auto const newLine = source.find('\n', std::min(chunkLength, source.length()) - 1);
+    auto const length = newLine == string_view::npos ? source.length() : newLine + 1;
+    chunks.push_back(source.substr(0, length));
+    source.remove_prefix(length);
+  }
+  return chunks;
+}
+
+// Tokenizer state before the first token of a line, taken while it was idle.
+struct ChunkCheckpoint {
+  unsigned line;
+  size_t encodedCount;
+  unsigned instructionCount;
+};
+
+// Chunk tokenized from an idle tokenizer, with lines and indices counted from its start and
+// symbols from a table of its own.
+struct TokenizedChunk {
+  // Checkpoints past the first few lines are never needed to resume after a carried-over
+  // instruction.
+  static constexpr size_t checkpointLimit = 64;
+
+  vector<EncodedInstruction> encoded;
+  SymbolTable symbols;
+  Tokenizer tokenizer {symbols};
+  vector<ChunkCheckpoint> checkpoints;
+  optional<LocatedInvalidTokenException> error;
+  std::exception_ptr failure;
+  unsigned lineCount {0};
+};
+
+struct ParseOptions {
+  unsigned threadCount {1};
+  size_t chunkLength {0}; // 0 to derive it from the source length and threadCount.
+  bool keepSource {false}; // For update(); the source is released once parsed otherwise.
+
+  [[nodiscard]] auto chunks(string_view source) const -> vector<string_view> {
+    constexpr size_t minimumChunkLength = 64u << 10u;
+    if (threadCount <= 1) {
+      return {source};
     }
+    return splitLines(
+        source, chunkLength != 0 ? chunkLength : std::max(minimumChunkLength, source.length() / (threadCount * 4) + 1)
+    );
+  }
+};
+
+struct RegisterNameHash {
+  using is_transparent = void;
+  auto operator()(string_view name) const noexcept {
+    return std::hash<string_view>{}(name);
+  }
+};
 
-    if (auto maybeInstruction = tokenizer.anyRemaining()) {
-      _encodedInstructions.push_back(std::move(*maybeInstruction));
+// Registers mapped by the last getParserInstructionSet* call, looked up by symbol. Symbols
+// interned after the map was made are added by resolve().
+struct RegisterMap {
+  U32 count;
+  ParserMappedRegister const* pMappedRegisters;
+  unordered_map<string, Register*, RegisterNameHash, std::equal_to<>> byName;
+  vector<Register*> bySymbol;
+
+  auto resolve(SymbolTable const& symbols) {
+    while (bySymbol.size() < symbols.size()) {
+      auto const reg = byName.find(symbols.name(static_cast<Symbol>(bySymbol.size())));
+      bySymbol.push_back(reg != byName.end() ? reg->second : nullptr);
     }
+  }
+
+  [[nodiscard]] auto find(Symbol symbol) const noexcept -> Register* {
+    return bySymbol[symbolIndex(symbol)];
+  }
+};
 
-    if (tokenizer.incomplete()) {
-      throw LocatedInvalidTokenException(InvalidTokenException("<EOF>"), lineIndex + 1, 0);
+// Instruction index of the first definition of every label, by symbol.
+class JumpMap {
+public:
+  [[nodiscard]] auto find(Symbol label) const noexcept -> optional<unsigned> {
+    auto const i = symbolIndex(label);
+    if (i < _targets.size() && _targets[i] != undefined) {
+      return _targets[i];
     }
+    return nullopt;
   }
 
-  auto requiresInvalidation(U16 registerCount, ParserMappedRegister const* pMappedRegisters) noexcept {
-    if (_registerMap) {
-      auto const& [count, addr, map] = *_registerMap;
-      if (count == registerCount && addr == pMappedRegisters) {
-        return false;
+  // False if the label is already defined, which is then left as it is.
+  auto define(Symbol label, unsigned target) -> bool {
+    auto const i = symbolIndex(label);
+    if (i >= _targets.size()) {
+      _targets.resize(i + 1, undefined);
+    }
+    if (_targets[i] != undefined) {
+      return false;
+    }
+    _targets[i] = target;
+    return true;
+  }
+
+  auto move(Symbol label, unsigned target) noexcept {
+    _targets[symbolIndex(label)] = target;
+  }
+
+  auto erase(Symbol label) noexcept {
+    _targets[symbolIndex(label)] = undefined;
+  }
+
+private:
+  static constexpr auto undefined = numeric_limits<unsigned>::max();
+
+  vector<unsigned> _targets;
+};
+
+// Target of a branch to a label past maxLabelValue, which is split over both operands (see
+// Instruction_getBranchTarget).
+auto wideBranchTarget(
+    InstructionType type,
+    optional<Parameter> const& p0,
+    optional<Parameter> const& p1,
+    JumpMap const& jumpMap
+) -> optional<unsigned> {
+  if (!InstructionType_isBranch(type) || !p0 || p1) {
+    return nullopt;
+  }
+  if (auto const* pLabel = get_if<Reference>(&*p0)) {
+    if (auto const target = jumpMap.find(*pLabel); target && *target > maxLabelValue) {
+      return target;
+    }
+  }
+  return nullopt;
+}
+
+// Replaces count elements from position on with replacement, moving the tail once.
+template <typename T> auto spliceInto(vector<T>& elements, size_t position, size_t count, vector<T>&& replacement) {
+  auto const common = std::min(count, replacement.size());
+  auto const at = std::move(
+      replacement.begin(), replacement.begin() + static_cast<ptrdiff_t>(common),
+      elements.begin() + static_cast<ptrdiff_t>(position)
+  );
+  if (replacement.size() > count) {
+    elements.insert(
+        at, std::make_move_iterator(replacement.begin() + static_cast<ptrdiff_t>(common)),
+        std::make_move_iterator(replacement.end())
+    );
+  } else {
+    elements.erase(at, at + static_cast<ptrdiff_t>(count - common));
+  }
+}
+
+// Operand of a linked instruction that holds the index of a label.
+struct LabelUse {
+  // A branch target, split over both operands past maxLabelValue.
+  static constexpr unsigned branchTarget = 2;
+
+  Instruction instruction;
+  unsigned operand;
+
+  // False if the target no longer fits the operand.
+  [[nodiscard]] auto link(unsigned target) const noexcept -> bool {
+    if (operand == branchTarget) {
+      Instruction_setParam1(instruction, constantAddress(target & maxLabelValue));
+      Instruction_setParam2(instruction, target > maxLabelValue ? constantAddress(target >> 16u) : nullptr);
+      return true;
+    }
+    if (target > maxLabelValue) {
+      return false;
+    }
+    (operand == 0 ? Instruction_setParam1 : Instruction_setParam2)(instruction, constantAddress(target));
+    return true;
+  }
+};
+
+// Uses of every label, by symbol.
+class LabelUses {
+public:
+  auto operator[](Label label) -> vector<LabelUse>& {
+    auto const i = symbolIndex(label);
+    if (i >= _uses.size()) {
+      _uses.resize(i + 1);
+    }
+    return _uses[i];
+  }
+
+private:
+  vector<vector<LabelUse>> _uses;
+};
+
+struct SourceDigest {
+  uint64_t length;
+  uint64_t hash;
+
+  explicit SourceDigest(string_view source) noexcept : length{source.length()}, hash{binary::hash(source)} {}
+  SourceDigest(uint64_t length, uint64_t hash) noexcept : length{length}, hash{hash} {}
+
+  auto operator==(SourceDigest const&) const noexcept -> bool = default;
+};
+
+class CxxParser {
+public:
+  CxxParser(CxxParser const&) = delete;
+  auto operator=(CxxParser const&) -> CxxParser& = delete;
+
+  // Loads a program emitted by binaryProgram() without tokenizing anything: the names of the
+  // image are interned once each and the image is released. Throws InvalidBinaryException if
+  // the image is malformed or was not made from a source with the expected digest.
+  CxxParser(Source&& image, optional<SourceDigest> const& expectedDigest) : _source{std::move(image)} {
+    auto const program = binary::Image::open(_source->view());
+    if (!program) {
+      throw InvalidBinaryException();
+    }
+    auto const& header = program->header();
+    _sourceDigest.emplace(header.sourceLength, header.sourceHash);
+    if (expectedDigest && *expectedDigest != *_sourceDigest) {
+      throw InvalidBinaryException();
+    }
+
+    vector<Symbol> names;
+    names.reserve(header.nameCount);
+    for (uint32_t i = 0; i < header.nameCount; ++i) {
+      names.push_back(_symbols.intern(program->name(i)));
+    }
+    auto makeParam = [&names](binary::OperandKind kind, uint32_t operand) -> optional<Parameter> {
+      switch (kind) {
+        case binary::OperandKind::Constant:
+          return Parameter{Constant{operand}};
+        case binary::OperandKind::Reference:
+          return Parameter{names[operand]};
+        default:
+          return nullopt;
       }
+    };
+
+    _encodedInstructions.reserve(header.entryCount);
+    for (uint32_t i = 0; i < header.entryCount; ++i) {
+      auto const entry = program->entry(i);
+      if (entry.kind == binary::EntryKind::Label) {
+        _encodedInstructions.emplace_back(names[entry.operands[0]], entry.index, entry.line);
+        continue;
+      }
+
+      auto const type = static_cast<InstructionType>(entry.type);
+      auto p0 = makeParam(entry.operandKinds[0], entry.operands[0]);
+      auto p1 = makeParam(entry.operandKinds[1], entry.operands[1]);
+      auto const [minParamCount, maxParamCount] = instructionOpCount(type);
+      auto const paramCount = p1 ? 2u : p0 ? 1u : 0u;
+      if ((p1 && !p0) || paramCount < minParamCount || paramCount > maxParamCount) {
+        throw InvalidBinaryException();
+      }
+      _encodedInstructions.emplace_back(Instr{type, std::move(p0), std::move(p1)}, entry.index, entry.line);
     }
+    _source.reset();
+  }
 
-    _registerMap.emplace();
-    auto& [count, addr, map] = *_registerMap;
-    count = registerCount;
-    addr = pMappedRegisters;
+  explicit CxxParser(Source&& source, ParseOptions const& options = {}) : _source{std::move(source)} {
+    Tokenizer tokenizer{_symbols};
+    auto const chunks = options.chunks(_source->view());
+    auto const lineIndex = chunks.size() > 1
+        ? tokenizeChunks(chunks, options.threadCount, tokenizer)
+        : tokenizeLines(_source->view(), tokenizer, _encodedInstructions, 0, [](unsigned) { return false; });
+    finishLines(tokenizer, _encodedInstructions, lineIndex);
+    if (options.keepSource) {
+      _editable = true;
+    } else {
+      _sourceDigest.emplace(_source->view());
+      _source.reset();
+    }
+  }
+
+  auto requiresInvalidation(U32 registerCount, ParserMappedRegister const* pMappedRegisters) {
+    if (_registerMap && _registerMap->count == registerCount && _registerMap->pMappedRegisters == pMappedRegisters) {
+      return false;
+    }
+
+    _registerMap.emplace(RegisterMap {.count = registerCount, .pMappedRegisters = pMappedRegisters, .byName = {}, .bySymbol = {}});
     for (auto end = pMappedRegisters + registerCount; pMappedRegisters != end; ++pMappedRegisters) {
-      map.emplace(
+      _registerMap->byName.emplace(
           string{pMappedRegisters->pRegisterName, pMappedRegisters->registerNameLength},
           pMappedRegisters->pRegister
       );
@@ -523,8 +1111,8 @@ public:
     return true;
   }
 
-  auto makeInstructionSet(U16 registerCount, ParserMappedRegister const* pMappedRegisters)
-      -> vector<cxx::Instruction> const& {
+  auto makeInstructionSet(U32 registerCount, ParserMappedRegister const* pMappedRegisters)
+      -> vector<Instruction> const& {
     if (requiresInvalidation(registerCount, pMappedRegisters)) {
       _cachedInstructions.reset();
     }
@@ -534,107 +1122,853 @@ public:
       return *_cachedInstructions;
     }
 
+    if (_instructionArena) {
+      _instructionArena->reset();
+      _freeInstructions.clear();
+    } else {
+      _instructionArena.emplace(_encodedInstructions.size());
+    }
     _cachedInstructions.emplace();
     _cachedInstructions->reserve(_encodedInstructions.size());
-    unordered_map<string_view, unsigned> jumpMap;
+    _labelUses.reset();
+    _registerMap->resolve(_symbols);
+
+    try {
+      for (auto& encoded : _encodedInstructions) {
+        if (auto* instruction = linkInstruction(encoded, nullptr)) {
+          _cachedInstructions->push_back(instruction);
+        }
+      }
+    } catch (...) {
+      _cachedInstructions.reset();
+      throw;
+    }
+
+    _cachedInstructions->shrink_to_fit();
+    return *_cachedInstructions;
+  }
+
+  // Parsed from source text that was kept, which update() can edit.
+  [[nodiscard]] auto editable() const noexcept -> bool {
+    return _editable;
+  }
+
+  [[nodiscard]] auto text() const noexcept -> string_view {
+    assert(_editable && "The source was released");
+    return _text ? string_view{*_text} : _source->view();
+  }
+
+  // Replaces removedLength bytes at offset with text. Tokenizing resumes at the last line
+  // before the edit where the tokenizer was idle and stops at the first line after it where it
+  // is idle again, as it was there before the edit; the encoded instructions past that line
+  // only have their indices and lines shifted. A linked program is patched in place while the
+  // set of labels stays the same and linked again on demand otherwise. Nothing changes if the
+  // edit yields an invalid token.
+  auto update(size_t offset, size_t removedLength, string_view text) -> void {
+    assert(_editable && offset + removedLength <= this->text().length() && "Invalid edit");
+    auto const source = this->text();
+    if (_lineStarts.empty()) {
+      _lineStarts.push_back(0);
+      for (auto newLine = source.find('\n'); newLine != string_view::npos; newLine = source.find('\n', newLine + 1)) {
+        _lineStarts.push_back(newLine + 1);
+      }
+    }
+
+    auto lineAt = [this](size_t at) {
+      return static_cast<unsigned>(std::upper_bound(_lineStarts.begin(), _lineStarts.end(), at) - _lineStarts.begin());
+    };
+    auto entryAt = [this](unsigned line) {
+      return std::lower_bound(
+          _encodedInstructions.begin(), _encodedInstructions.end(), line,
+          [](EncodedInstruction const& encoded, unsigned at) { return encoded.line() < at; }
+      );
+    };
+    auto idleAt = [this, &entryAt](unsigned line) {
+      auto const entry = entryAt(line);
+      return entry == _encodedInstructions.begin() || std::prev(entry)->endLine() < line;
+    };
+    auto indexAt = [this](vector<EncodedInstruction>::const_iterator entry) -> unsigned {
+      if (entry != _encodedInstructions.end()) {
+        return entry->index();
+      }
+      if (_encodedInstructions.empty()) {
+        return 0;
+      }
+      return _encodedInstructions.back().index() + (_encodedInstructions.back().label() ? 0 : 1);
+    };
+
+    auto const editEnd = offset + removedLength;
+    auto const lastEditLine = lineAt(editEnd);
+    auto firstLine = lineAt(offset);
+    while (!idleAt(firstLine)) {
+      firstLine = std::prev(entryAt(firstLine))->line();
+    }
+    auto const firstIndex = indexAt(entryAt(firstLine));
+    // Line counts change by lineDelta past the edit; unsigned arithmetic wraps for removals.
+    auto const lineDelta = static_cast<unsigned>(
+        std::count(text.begin(), text.end(), '\n') - std::count(source.begin() + offset, source.begin() + editEnd, '\n'));
+
+    // The edited region starts a few lines past the edit and grows until the tokenizer
+    // settles or input ends.
+    string region;
+    vector<EncodedInstruction> encoded;
+    Tokenizer tokenizer{_symbols};
+    optional<unsigned> resumeLine;
+    for (unsigned regionLines = 4;; regionLines *= 4) {
+      auto const endLine = lastEditLine + regionLines;
+      auto const regionEnd = endLine <= _lineStarts.size() ? _lineStarts[endLine - 1] : source.length();
+      auto const regionBegin = _lineStarts[firstLine - 1];
+      region.assign(source.substr(regionBegin, offset - regionBegin));
+      region.append(text);
+      region.append(source.substr(editEnd, regionEnd - editEnd));
+
+      encoded.clear();
+      tokenizer = Tokenizer{_symbols};
+      tokenizer.relocate(firstIndex, 0);
+      auto const lineCount = tokenizeLines(
+          region, tokenizer, encoded, firstLine - 1,
+          [&tokenizer, &idleAt, &resumeLine, lineDelta, lastEditLine](unsigned line) {
+            if (line > lastEditLine + lineDelta && tokenizer.idle() && idleAt(line - lineDelta)) {
+              resumeLine = line - lineDelta;
+            }
+            return resumeLine.has_value();
+          }
+      );
+      if (resumeLine) {
+        break;
+      }
+      if (regionEnd == source.length()) {
+        finishLines(tokenizer, encoded, firstLine - 1 + lineCount);
+        break;
+      }
+      if (tokenizer.idle() && idleAt(endLine)) {
+        resumeLine = endLine;
+        break;
+      }
+    }
+
+    auto const first = entryAt(firstLine);
+    auto const kept = resumeLine ? entryAt(*resumeLine) : _encodedInstructions.end();
+    auto const firstPosition = first - _encodedInstructions.begin();
+    auto const replacedCount = static_cast<size_t>(kept - first);
+    auto const keptIndex = indexAt(kept);
+    auto const indexDelta = tokenizer.instructionCount() - keptIndex;
+
+    auto labelsOf = [](auto begin, auto end) {
+      vector<Label> labels;
+      for (; begin != end; ++begin) {
+        if (auto const label = begin->label()) {
+          labels.push_back(*label);
+        }
+      }
+      std::sort(labels.begin(), labels.end());
+      return labels;
+    };
+    auto const sameLabels = labelsOf(first, kept) == labelsOf(encoded.begin(), encoded.end());
+
+    auto relink = _cachedInstructions && sameLabels && !_duplicateLabels;
+    if (relink) {
+      auto& uses = labelUses();
+      auto instruction = _cachedInstructions->begin() + firstIndex;
+      for (auto entry = first; entry != kept; ++entry) {
+        entry->visit(
+            [this, &uses, &instruction](InstructionType, optional<Parameter>&& p0, optional<Parameter>&& p1) {
+              for (auto const* p : {&p0, &p1}) {
+                if (auto const* pReference = *p ? get_if<Reference>(&**p) : nullptr; pReference && _jumpMap->find(*pReference)) {
+                  std::erase_if(uses[*pReference], [&instruction](LabelUse const& use) { return use.instruction == *instruction; });
+                }
+              }
+              ++instruction;
+            },
+            [](auto&&...) {}
+        );
+      }
+    } else {
+      _cachedInstructions.reset();
+      _labelUses.reset();
+    }
+
+    if (_jumpMap && !_duplicateLabels) {
+      if (sameLabels) {
+        for (auto const& entry : encoded) {
+          if (auto const label = entry.label()) {
+            _jumpMap->move(*label, entry.index());
+          }
+        }
+      } else {
+        for (auto entry = first; entry != kept; ++entry) {
+          if (auto const label = entry->label()) {
+            _jumpMap->erase(*label);
+          }
+        }
+        for (auto const& entry : encoded) {
+          if (auto const label = entry.label()) {
+            _duplicateLabels |= !_jumpMap->define(*label, entry.index());
+          }
+        }
+      }
+    }
+    if (_duplicateLabels) {
+      _jumpMap.reset();
+    }
+
+    vector<Label> movedLabels;
+    if (indexDelta != 0 || lineDelta != 0) {
+      for (auto entry = kept; entry != _encodedInstructions.end(); ++entry) {
+        entry->relocate(indexDelta, lineDelta);
+        if (auto const label = entry->label(); label && indexDelta != 0 && _jumpMap) {
+          _jumpMap->move(*label, entry->index());
+          if (relink) {
+            movedLabels.push_back(*label);
+          }
+        }
+      }
+    }
+    auto const newCount = encoded.size();
+    spliceInto(_encodedInstructions, firstPosition, replacedCount, std::move(encoded));
+
+    if (!_text) {
+      _text.emplace(source);
+      _source.reset();
+    }
+    _text->replace(offset, removedLength, text);
+    auto const removedStart = std::upper_bound(_lineStarts.begin(), _lineStarts.end(), offset);
+    auto const removedEnd = std::upper_bound(removedStart, _lineStarts.end(), editEnd);
+    for (auto start = removedEnd; start != _lineStarts.end(); ++start) {
+      *start = *start + text.length() - removedLength;
+    }
+    vector<size_t> insertedStarts;
+    for (auto newLine = text.find('\n'); newLine != string_view::npos; newLine = text.find('\n', newLine + 1)) {
+      insertedStarts.push_back(offset + newLine + 1);
+    }
+    spliceInto(
+        _lineStarts, static_cast<size_t>(removedStart - _lineStarts.begin()),
+        static_cast<size_t>(removedEnd - removedStart), std::move(insertedStarts)
+    );
+
+    _packedProgram.reset();
+    _binaryProgram.reset();
+    _sourceDigest.reset();
+    if (relink) {
+      relinkRegion(static_cast<size_t>(firstPosition), newCount, firstIndex, keptIndex - firstIndex, movedLabels);
+    }
+  }
+
+  [[nodiscard]] auto sourceDigest() -> SourceDigest const& {
+    if (!_sourceDigest) {
+      _sourceDigest.emplace(text());
+    }
+    return *_sourceDigest;
+  }
+
+  // Program in the format of binary.hpp, loadable through the binary constructor.
+  auto binaryProgram() -> string const& {
+    if (_binaryProgram) {
+      return *_binaryProgram;
+    }
+
+    binary::Writer writer;
+    auto makeOperand = [this, &writer](optional<Parameter> const& p) -> tuple<binary::OperandKind, uint32_t> {
+      if (!p) {
+        return {binary::OperandKind::None, 0};
+      }
+      if (auto const* pConstant = get_if<Constant>(&*p)) {
+        return {binary::OperandKind::Constant, *pConstant};
+      }
+      return {binary::OperandKind::Reference, writer.name(_symbols.name(get<Reference>(*p)))};
+    };
     for (auto& encoded : _encodedInstructions) {
       encoded.visit(
-          [](auto&&...) {},
-          [&jumpMap](auto const& label, unsigned instrRefIdx) {
-            jumpMap.emplace(label, instrRefIdx);
+          [&writer, &makeOperand, &encoded](InstructionType type, optional<Parameter>&& p0, optional<Parameter>&& p1) {
+            auto const [kind0, operand0] = makeOperand(p0);
+            auto const [kind1, operand1] = makeOperand(p1);
+            writer.add(binary::Entry {
+                .index = encoded.index(),
+                .line = encoded.line(),
+                .kind = binary::EntryKind::Instruction,
+                .type = static_cast<uint8_t>(type),
+                .operandKinds = {kind0, kind1},
+                .operands = {operand0, operand1}
+            });
+          },
+          [this, &writer, &encoded](Label label, unsigned instrRefIdx) {
+            writer.add(binary::Entry {
+                .index = instrRefIdx,
+                .line = encoded.line(),
+                .kind = binary::EntryKind::Label,
+                .type = DEFAULT,
+                .operandKinds = {binary::OperandKind::Reference, binary::OperandKind::None},
+                .operands = {writer.name(_symbols.name(label)), 0}
+            });
           }
       );
     }
 
-    for (auto&& encoded : std::move(_encodedInstructions)) {
+    auto const& [length, hash] = sourceDigest();
+    return _binaryProgram.emplace(writer.finish(length, hash));
+  }
+
+  auto makePackedProgram(U16 registerNameCount, ParserRegisterName const* pRegisterNames)
+      -> vector<PackedInstruction> const& {
+    vector<string> names;
+    names.reserve(registerNameCount);
+    for (auto end = pRegisterNames + registerNameCount; pRegisterNames != end; ++pRegisterNames) {
+      names.emplace_back(pRegisterNames->pRegisterName, pRegisterNames->registerNameLength);
+    }
+    if (_packedProgram && get<0>(*_packedProgram) == names) {
+      return get<1>(*_packedProgram);
+    }
+    _packedProgram.reset();
+
+    // Index of the first name of every symbol among names.
+    vector<optional<U16>> registerIndices(_symbols.size());
+    for (auto i = names.size(); i-- != 0;) {
+      if (auto const symbol = _symbols.find(names[i])) {
+        registerIndices[symbolIndex(*symbol)] = static_cast<U16>(i);
+      }
+    }
+
+    auto const& jumpMap = this->jumpMap();
+    vector<PackedInstruction> program;
+    program.reserve(_encodedInstructions.size());
+    for (auto& encoded : _encodedInstructions) {
       encoded.visit(
-          [this, &jumpMap, &encoded](InstructionType type, optional<Parameter>&& p0, optional<Parameter>&& p1) {
-            auto paramVisitor = [this, &jumpMap, &encoded](optional<Parameter>&& p) -> Register* {
+          [&](InstructionType type, optional<Parameter>&& p0, optional<Parameter>&& p1) {
+            auto paramVisitor = [&](optional<Parameter> const& p, U16& operand) -> InstructionOperandKind {
+              operand = 0;
               if (!p) {
-                return nullptr;
+                return INSTRUCTION_OPERAND_NONE;
+              }
+              if (auto const* pConstant = std::get_if<Constant>(&*p)) {
+                operand = static_cast<U16>(*pConstant);
+                return INSTRUCTION_OPERAND_IMMEDIATE;
               }
 
-              return std::visit([this, &jumpMap, &regMap= get<2>(*_registerMap), &encoded]<typename DT>(DT&& val) -> Register* {
-                using T = remove_cvref_t<DT>;
-                if constexpr (is_same_v<T, Reference>) {
-                  if (auto jumpAt = jumpMap.find(val); jumpAt != jumpMap.end()) {
-                    return _possibleConstants.data() + jumpAt->second;
-                  } else if (auto reg = regMap.find(val); reg != regMap.end()) {
-                    return reg->second;
-                  } else {
-                    throw UndefinedReferenceException(val, encoded);
-                  }
-                } else if constexpr (std::is_same_v<T, Constant>) {
-                  return _possibleConstants.data() + val;
-                } else {
-                  assert(false && "Unhandled Parameter type");
-                  return nullptr;
+              auto const reference = get<Reference>(*p);
+              if (auto const target = jumpMap.find(reference)) {
+                if (*target > maxLabelValue) {
+                  throw IllegalParameterException();
                 }
-              }, std::move(*p));
+                operand = static_cast<U16>(*target);
+                return INSTRUCTION_OPERAND_IMMEDIATE;
+              }
+              if (auto const registerIndex = registerIndices[symbolIndex(reference)]) {
+                operand = *registerIndex;
+                return INSTRUCTION_OPERAND_REGISTER;
+              }
+              throw UndefinedReferenceException(_symbols.name(reference), encoded);
             };
-            _cachedInstructions->emplace_back(type, paramVisitor(std::move(p0)), paramVisitor(std::move(p1)));
+
+            if (auto const target = wideBranchTarget(type, p0, p1, jumpMap)) {
+              program.push_back(PackedInstruction_make(
+                  type, INSTRUCTION_OPERAND_IMMEDIATE, static_cast<U16>(*target),
+                  INSTRUCTION_OPERAND_IMMEDIATE, static_cast<U16>(*target >> 16u)));
+              return;
+            }
+
+            U16 operand0;
+            U16 operand1;
+            // Resolve the second operand first so undefined references match makeInstructionSet.
+            auto const kind1 = paramVisitor(p1, operand1);
+            auto const kind0 = paramVisitor(p0, operand0);
+            if (InstructionType_isALU(type) && type != ALU_CMP && kind0 != INSTRUCTION_OPERAND_REGISTER) {
+              throw IllegalParameterException();
+            }
+            program.push_back(PackedInstruction_make(type, kind0, operand0, kind1, operand1));
           },
           [](auto&&...) {}
       );
     }
 
-    _cachedInstructions->shrink_to_fit();
-    return *_cachedInstructions;
+    return get<1>(_packedProgram.emplace(std::move(names), std::move(program)));
   }
 
 private:
-  stringstream _code;
+  // Tokenizes the chunks concurrently, each from an idle tokenizer, then stitches them in
+  // order. A chunk that starts inside an instruction carried over from the previous one is
+  // tokenized again from the carried state until both tokenizers are idle at the start of the
+  // same line; the rest of the chunk is kept, with its indices and lines shifted and its
+  // symbols moved to the parser's table. Yields the number of lines.
+  auto tokenizeChunks(vector<string_view> const& chunks, unsigned threadCount, Tokenizer& tokenizer) -> unsigned {
+    vector<TokenizedChunk> tokenized(chunks.size());
+    std::atomic<size_t> nextChunk {0};
+    auto work = [&chunks, &tokenized, &nextChunk] {
+      for (size_t i; (i = nextChunk.fetch_add(1, std::memory_order_relaxed)) < chunks.size();) {
+        auto& chunk = tokenized[i];
+        try {
+          chunk.lineCount = tokenizeLines(chunks[i], chunk.tokenizer, chunk.encoded, 0, [&chunk](unsigned line) {
+            if (chunk.tokenizer.idle() && chunk.checkpoints.size() < TokenizedChunk::checkpointLimit) {
+              chunk.checkpoints.push_back({line, chunk.encoded.size(), chunk.tokenizer.instructionCount()});
+            }
+            return false;
+          });
+        } catch (LocatedInvalidTokenException const& tokenException) {
+          chunk.error.emplace(tokenException);
+        } catch (...) {
+          chunk.failure = std::current_exception();
+        }
+      }
+    };
+    {
+      vector<std::jthread> workers;
+      for (size_t i = 1; i < std::min<size_t>(threadCount, chunks.size()); ++i) {
+        workers.emplace_back(work);
+      }
+      work();
+    }
+
+    _encodedInstructions.reserve(std::accumulate(
+        tokenized.begin(), tokenized.end(), size_t{0},
+        [](size_t count, TokenizedChunk const& chunk) { return count + chunk.encoded.size(); }
+    ));
+    unsigned lineOffset = 0;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+      auto& chunk = tokenized[i];
+      if (chunk.failure) {
+        std::rethrow_exception(chunk.failure);
+      }
+
+      auto resumeAt = chunk.checkpoints.end();
+      auto const lineCount = tokenizeLines(
+          chunks[i], tokenizer, _encodedInstructions, lineOffset, [&chunk, &tokenizer, &resumeAt, lineOffset](unsigned line) {
+            if (!tokenizer.idle()) {
+              return false;
+            }
+            resumeAt = std::find_if(chunk.checkpoints.begin(), chunk.checkpoints.end(), [line, lineOffset](auto const& checkpoint) {
+              return lineOffset + checkpoint.line == line;
+            });
+            return resumeAt != chunk.checkpoints.end();
+          }
+      );
+      if (resumeAt == chunk.checkpoints.end()) {
+        lineOffset += lineCount;
+        continue;
+      }
+
+      // Checkpoints all precede the speculative error, so it is also the serial one.
+      if (chunk.error) {
+        throw LocatedInvalidTokenException(
+            InvalidTokenException(chunk.error->token()), lineOffset + chunk.error->line(), chunk.error->column()
+        );
+      }
+      auto const indexOffset = tokenizer.instructionCount() - resumeAt->instructionCount;
+      vector<Symbol> symbols;
+      symbols.reserve(chunk.symbols.size());
+      for (size_t symbol = 0; symbol < chunk.symbols.size(); ++symbol) {
+        symbols.push_back(_symbols.intern(chunk.symbols.name(static_cast<Symbol>(symbol))));
+      }
+      for (auto encoded = chunk.encoded.begin() + static_cast<ptrdiff_t>(resumeAt->encodedCount);
+           encoded != chunk.encoded.end(); ++encoded) {
+        encoded->relocate(indexOffset, lineOffset);
+        encoded->remap(symbols);
+        _encodedInstructions.push_back(*encoded);
+      }
+      tokenizer = std::move(chunk.tokenizer);
+      tokenizer.relocate(indexOffset, lineOffset);
+      tokenizer.rebind(_symbols, symbols);
+      lineOffset += chunk.lineCount;
+    }
+    return lineOffset;
+  }
+
+  // Links the count encoded instructions from position on in place of the replacedCount
+  // linked ones from index on, then points the uses of their labels and of movedLabels at
+  // the new targets. The replaced instructions are patched into the new ones, so the arena
+  // only grows with the program. Anything that does not link is left to the next
+  // makeInstructionSet().
+  auto relinkRegion(size_t position, size_t count, unsigned index, size_t replacedCount, vector<Label> const& movedLabels)
+      -> void {
+    auto& uses = *_labelUses;
+    _registerMap->resolve(_symbols);
+    auto const replaced = _cachedInstructions->begin() + index;
+    _freeInstructions.insert(
+        _freeInstructions.end(), std::make_reverse_iterator(replaced + static_cast<ptrdiff_t>(replacedCount)),
+        std::make_reverse_iterator(replaced)
+    );
+    vector<Instruction> instructions;
+    vector<Label> labels = movedLabels;
+    try {
+      for (auto entry = _encodedInstructions.begin() + static_cast<ptrdiff_t>(position),
+               end = entry + static_cast<ptrdiff_t>(count); entry != end; ++entry) {
+        if (auto const label = entry->label()) {
+          labels.push_back(*label);
+        } else {
+          instructions.push_back(linkInstruction(*entry, &uses));
+        }
+      }
+    } catch (UndefinedReferenceException const&) {
+      instructions.clear();
+    } catch (IllegalParameterException const&) {
+      instructions.clear();
+    }
+    auto linked = instructions.size() == static_cast<size_t>(std::count_if(
+        _encodedInstructions.begin() + static_cast<ptrdiff_t>(position),
+        _encodedInstructions.begin() + static_cast<ptrdiff_t>(position + count),
+        [](EncodedInstruction const& entry) { return !entry.label(); }
+    ));
+    if (linked) {
+      spliceInto(*_cachedInstructions, index, replacedCount, std::move(instructions));
+      for (auto const label : labels) {
+        auto const target = *_jumpMap->find(label);
+        for (auto const& use : uses[label]) {
+          linked &= use.link(target);
+        }
+      }
+    }
+    if (!linked) {
+      _cachedInstructions.reset();
+      _labelUses.reset();
+    }
+  }
+
+  // First definition of every label, kept up to date by update().
+  auto jumpMap() -> JumpMap const& {
+    if (!_jumpMap) {
+      _jumpMap.emplace();
+      _duplicateLabels = false;
+      for (auto const& encoded : _encodedInstructions) {
+        if (auto const label = encoded.label()) {
+          _duplicateLabels |= !_jumpMap->define(*label, encoded.index());
+        }
+      }
+    }
+    return *_jumpMap;
+  }
+
+  // Instruction for an encoded one, or nullptr for a label. Labels take precedence over
+  // registers. Operands holding the index of a label are added to pUses when given.
+  auto linkInstruction(EncodedInstruction& encoded, LabelUses* pUses) -> Instruction {
+    auto const& jumpMap = this->jumpMap();
+    return encoded.visit(
+        [this, &jumpMap, &encoded, pUses](InstructionType type, optional<Parameter>&& p0, optional<Parameter>&& p1)
+            -> Instruction {
+          if (auto const target = wideBranchTarget(type, p0, p1, jumpMap)) {
+            auto* instruction = makeInstruction(
+                type, constantAddress(*target & maxLabelValue), constantAddress(*target >> 16u));
+            if (pUses) {
+              (*pUses)[get<Reference>(*p0)].push_back({instruction, LabelUse::branchTarget});
+            }
+            return instruction;
+          }
+
+          optional<Label> labels[2];
+          auto paramVisitor = [this, &jumpMap, &encoded](optional<Parameter>&& p, optional<Label>& label) -> Register* {
+            if (!p) {
+              return nullptr;
+            }
+
+            return std::visit([this, &jumpMap, &encoded, &label]<typename DT>(DT&& val) -> Register* {
+              using T = remove_cvref_t<DT>;
+              if constexpr (is_same_v<T, Reference>) {
+                if (auto const target = jumpMap.find(val)) {
+                  if (*target > maxLabelValue) {
+                    throw IllegalParameterException();
+                  }
+                  label = val;
+                  return constantAddress(*target);
+                } else if (auto* reg = _registerMap->find(val)) {
+                  return reg;
+                } else {
+                  throw UndefinedReferenceException(_symbols.name(val), encoded);
+                }
+              } else if constexpr (std::is_same_v<T, Constant>) {
+                return constantAddress(val);
+              } else {
+                assert(false && "Unhandled Parameter type");
+                return nullptr;
+              }
+            }, std::move(*p));
+          };
+          // Resolve the second operand first so undefined references are reported as before.
+          auto* r1 = paramVisitor(std::move(p1), labels[1]);
+          auto* r0 = paramVisitor(std::move(p0), labels[0]);
+          if (InstructionType_isALU(type) && type != ALU_CMP && isConstantAddress(r0)) {
+            throw IllegalParameterException();
+          }
+          auto* instruction = makeInstruction(type, r0, r1);
+          if (pUses) {
+            for (unsigned operand = 0; operand < 2; ++operand) {
+              if (labels[operand]) {
+                auto const branchTarget = operand == 0 && InstructionType_isBranch(type) && r1 == nullptr;
+                (*pUses)[*labels[operand]].push_back({instruction, branchTarget ? LabelUse::branchTarget : operand});
+              }
+            }
+          }
+          return instruction;
+        },
+        [](auto&&...) -> Instruction { return nullptr; }
+    );
+  }
+
+  // Instruction from the arena, reusing one that relinkRegion() replaced when there is any.
+  auto makeInstruction(InstructionType type, Register* r0, Register* r1) -> Instruction {
+    if (_freeInstructions.empty()) {
+      return _instructionArena->make(type, r0, r1);
+    }
+    auto const instruction = _freeInstructions.back();
+    _freeInstructions.pop_back();
+    Instruction_setType(instruction, type);
+    Instruction_setParam1(instruction, r0);
+    Instruction_setParam2(instruction, r1);
+    return instruction;
+  }
+
+  // Label operands of the linked program, gathered on its first update.
+  auto labelUses() -> LabelUses& {
+    if (_labelUses) {
+      return *_labelUses;
+    }
+
+    auto const& jumpMap = this->jumpMap();
+    auto& uses = _labelUses.emplace();
+    auto instruction = _cachedInstructions->begin();
+    for (auto& encoded : _encodedInstructions) {
+      encoded.visit(
+          [&jumpMap, &uses, &instruction](InstructionType type, optional<Parameter>&& p0, optional<Parameter>&& p1) {
+            auto labelOf = [&jumpMap](optional<Parameter> const& p) -> Reference const* {
+              auto const* pReference = p ? get_if<Reference>(&*p) : nullptr;
+              return pReference && jumpMap.find(*pReference) ? pReference : nullptr;
+            };
+            if (auto const* pLabel = labelOf(p0)) {
+              uses[*pLabel].push_back({*instruction, InstructionType_isBranch(type) && !p1 ? LabelUse::branchTarget : 0});
+            }
+            if (auto const* pLabel = labelOf(p1)) {
+              uses[*pLabel].push_back({*instruction, 1});
+            }
+            ++instruction;
+          },
+          [](auto&&...) {}
+      );
+    }
+    return uses;
+  }
+
+  optional<Source> _source; // Released once parsed unless editable.
+  SymbolTable _symbols;
   vector<EncodedInstruction> _encodedInstructions;
-  optional<vector<cxx::Instruction>> _cachedInstructions;
-  vector<Register> _possibleConstants;
-  optional<tuple<U16, ParserMappedRegister const*, unordered_map<string, Register*>>> _registerMap {nullopt};
+  optional<cxx::InstructionArena> _instructionArena;
+  vector<Instruction> _freeInstructions; // Replaced by updates, reused before the arena grows.
+  optional<vector<Instruction>> _cachedInstructions;
+  optional<tuple<vector<string>, vector<PackedInstruction>>> _packedProgram;
+  optional<SourceDigest> _sourceDigest;
+  optional<string> _binaryProgram;
+  bool _editable {false};
+  optional<string> _text; // Source text once edited.
+  vector<size_t> _lineStarts;
+  optional<JumpMap> _jumpMap;
+  bool _duplicateLabels {false};
+  optional<LabelUses> _labelUses;
+  optional<RegisterMap> _registerMap {nullopt};
 };
+
+auto reportInvalidToken(LocatedInvalidTokenException const& invalidTokenException, void* pNext) -> ParserError {
+  if (auto* pInvalidTokenOutput = cxx::find<STRUCTURE_TYPE_PARSER_INVALID_TOKEN_OUTPUT_INFO>(pNext)) {
+    auto const token = invalidTokenException.token();
+    auto const line = invalidTokenException.line();
+    auto const column = invalidTokenException.column();
+
+    if (!pInvalidTokenOutput->pToken) {
+      return PARSER_ERROR_ILLEGAL_PARAMETER;
+    }
+
+    if (pInvalidTokenOutput->tokenLength <= token.length()) { // Includes '\0'
+      return PARSER_ERROR_ARRAY_TOO_SMALL;
+    }
+
+    pInvalidTokenOutput->line = line;
+    pInvalidTokenOutput->column = column;
+    pInvalidTokenOutput->tokenLength = token.length();
+    char_traits<char>::copy(pInvalidTokenOutput->pToken, token.data(), token.length());
+    *(pInvalidTokenOutput->pToken + pInvalidTokenOutput->tokenLength) = '\0';
+  }
+  return PARSER_ERROR_INVALID_TOKEN;
+}
+
+auto reportUndefinedReference(UndefinedReferenceException const& undefinedReferenceException, void* pNext)
+    -> ParserError {
+  if (auto* pUndefinedReferenceInfo = cxx::find<STRUCTURE_TYPE_PARSER_UNDEFINED_REFERENCE_OUTPUT_INFO>(pNext)) {
+    auto const* pEncoded = undefinedReferenceException.referencedFrom();
+    auto const id = undefinedReferenceException.identifier();
+
+    if (!pUndefinedReferenceInfo->pToken) {
+      return PARSER_ERROR_ILLEGAL_PARAMETER;
+    }
+
+    if (pUndefinedReferenceInfo->tokenLength <= id.length()) { // Includes '\0'
+      return PARSER_ERROR_ARRAY_TOO_SMALL;
+    }
+
+    pUndefinedReferenceInfo->referencingInstructionIndex = pEncoded->index();
+    pUndefinedReferenceInfo->referencingLine = pEncoded->line();
+    pUndefinedReferenceInfo->tokenLength = id.length();
+    char_traits<char>::copy(pUndefinedReferenceInfo->pToken, id.data(), id.length());
+    *(pUndefinedReferenceInfo->pToken + pUndefinedReferenceInfo->tokenLength) = '\0';
+  }
+  return PARSER_ERROR_UNDEFINED_REFERENCE;
+}
+auto cachedProgramPath(ParserProgramCacheInfo const& cacheInfo, SourceDigest const& digest) -> fs::path {
+  auto const directoryLength = cacheInfo.directoryPathLength == 0u
+      ? char_traits<char>::length(cacheInfo.pDirectoryPath)
+      : cacheInfo.directoryPathLength;
+  char name[24];
+  snprintf(name, sizeof(name), "%016llx.esp", static_cast<unsigned long long>(digest.hash));
+  return fs::path{string{cacheInfo.pDirectoryPath, directoryLength}} / name;
+}
+
+// Best effort: the program is written to a private file first and renamed over the cached
+// one, so concurrent writers and readers only ever see complete images.
+auto storeCachedProgram(fs::path const& path, string_view image) noexcept -> void {
+  try {
+    std::error_code error;
+    fs::create_directories(path.parent_path(), error);
+    auto temporary = path;
+    temporary += ".tmp" + std::to_string(std::random_device{}());
+    {
+      std::ofstream file{temporary, ios::binary | ios::trunc};
+      file.write(image.data(), static_cast<std::streamsize>(image.length()));
+      if (!file.flush()) {
+        file.close();
+        fs::remove(temporary, error);
+        return;
+      }
+    }
+    fs::rename(temporary, path, error);
+    if (error) {
+      fs::remove(temporary, error);
+    }
+  } catch (exception const&) {
+  }
+}
 } // namespace
 
 extern "C" {
 typedef struct Parser_T {
   CxxParser parser;
 } Parser_T;
+} // extern "C"
+
+namespace {
+// Copies a program out through the two-call idiom of the public API; the U16 entry points
+// refuse programs they cannot count instead of truncating.
+template <typename Count, typename T>
+auto copyProgram(vector<T> const& program, Count* pCount, T* pOut) -> ParserError {
+  if (program.size() > numeric_limits<Count>::max()) {
+    return PARSER_ERROR_PROGRAM_TOO_LARGE;
+  }
+  auto givenCount = exchange(*pCount, static_cast<Count>(program.size()));
+  if (pOut) {
+    if (givenCount < program.size()) {
+      return PARSER_ERROR_ARRAY_TOO_SMALL;
+    }
+    std::copy(program.begin(), program.end(), pOut);
+  }
+  return PARSER_ERROR_NONE;
+}
+
+template <typename GetInfo, typename Count>
+auto getInstructionSet(Parser parser, GetInfo const* pGetInfo, Count* pInstructionCount, Instruction* pInstructions)
+    -> ParserError {
+  if (parser == nullptr || pGetInfo == nullptr || pInstructionCount == nullptr) {
+    return PARSER_ERROR_ILLEGAL_PARAMETER;
+  }
 
+  try {
+    auto const& instructions =
+        parser->parser.makeInstructionSet(pGetInfo->mappedRegisterCount, pGetInfo->pMappedRegisters);
+    return copyProgram(instructions, pInstructionCount, pInstructions);
+  } catch (UndefinedReferenceException const& undefinedReferenceException) {
+    return reportUndefinedReference(undefinedReferenceException, pGetInfo->pNext);
+  } catch (IllegalParameterException const&) {
+    return PARSER_ERROR_ILLEGAL_PARAMETER;
+  } catch (exception const&) {
+    return PARSER_ERROR_UNKNOWN;
+  }
+}
+
+template <typename Count>
+auto getPackedProgram(
+    Parser parser,
+    ParserGetPackedProgramInfo const* pGetInfo,
+    Count* pInstructionCount,
+    PackedInstruction* pInstructions
+) -> ParserError {
+  if (parser == nullptr || pGetInfo == nullptr || pInstructionCount == nullptr
+      || pGetInfo->registerNameCount > CPU_DATA_REGISTRY_LIST_SIZE
+      || (pGetInfo->registerNameCount != 0 && pGetInfo->pRegisterNames == nullptr)) {
+    return PARSER_ERROR_ILLEGAL_PARAMETER;
+  }
+
+  try {
+    auto const& program = parser->parser.makePackedProgram(pGetInfo->registerNameCount, pGetInfo->pRegisterNames);
+    return copyProgram(program, pInstructionCount, pInstructions);
+  } catch (UndefinedReferenceException const& undefinedReferenceException) {
+    return reportUndefinedReference(undefinedReferenceException, pGetInfo->pNext);
+  } catch (IllegalParameterException const&) {
+    return PARSER_ERROR_ILLEGAL_PARAMETER;
+  } catch (exception const&) {
+    return PARSER_ERROR_UNKNOWN;
+  }
+}
+} // namespace
+
+extern "C" {
 ParserError createParser(ParserCreateInfo const* pCreateInfo, Parser_T** pParser) {
   if (!pCreateInfo || !pParser || !pCreateInfo->pData) {
     return PARSER_ERROR_ILLEGAL_PARAMETER;
   }
 
   try {
-    assert(pCreateInfo->inputType == PARSER_INPUT_TYPE_CODE || pCreateInfo->inputType == PARSER_INPUT_TYPE_FILE_PATH);
+    assert(pCreateInfo->inputType == PARSER_INPUT_TYPE_CODE || pCreateInfo->inputType == PARSER_INPUT_TYPE_FILE_PATH
+           || pCreateInfo->inputType == PARSER_INPUT_TYPE_BINARY);
     auto const dataLength = pCreateInfo->dataLength == 0u
         ? char_traits<char>::length(pCreateInfo->pData)
         : pCreateInfo->dataLength;
-    auto data = pCreateInfo->inputType == PARSER_INPUT_TYPE_FILE_PATH
-        ? parsePath({pCreateInfo->pData, dataLength})
-        : string{pCreateInfo->pData, dataLength};
-    *pParser = new Parser_T{.parser{std::move(data)}};
-    return PARSER_ERROR_NONE;
-  } catch (LocatedInvalidTokenException const& invalidTokenException) {
-    if (auto* pInvalidTokenOutput =
-        cxx::find<STRUCTURE_TYPE_PARSER_INVALID_TOKEN_OUTPUT_INFO>(pCreateInfo->pNext)) {
-      auto const token = invalidTokenException.token();
-      auto const line = invalidTokenException.line();
-      auto const column = invalidTokenException.column();
-
-      if (!pInvalidTokenOutput->pToken) {
-        return PARSER_ERROR_ILLEGAL_PARAMETER;
-      }
+    if (pCreateInfo->inputType == PARSER_INPUT_TYPE_BINARY) {
+      auto image = Source::fromPath(string{pCreateInfo->pData, dataLength});
+      *pParser = new Parser_T{.parser{std::move(image), nullopt}};
+      return PARSER_ERROR_NONE;
+    }
 
-      if (pInvalidTokenOutput->tokenLength <= token.length()) { // Includes '\0'
-        return PARSER_ERROR_ARRAY_TOO_SMALL;
-      }
+    auto source = pCreateInfo->inputType == PARSER_INPUT_TYPE_FILE_PATH
+        ? Source::fromPath(string{pCreateInfo->pData, dataLength})
+        : Source{string{pCreateInfo->pData, dataLength}};
+    ParseOptions options;
+    if (auto const* pParallelInfo = cxx::find<STRUCTURE_TYPE_PARSER_PARALLEL_PARSE_INFO>(pCreateInfo->pNext)) {
+      options.threadCount = pParallelInfo->threadCount != 0
+          ? pParallelInfo->threadCount
+          : std::max(std::thread::hardware_concurrency(), 1u);
+      options.chunkLength = pParallelInfo->chunkLength;
+    }
+    auto const* pCacheInfo = cxx::find<STRUCTURE_TYPE_PARSER_PROGRAM_CACHE_INFO>(pCreateInfo->pNext);
+    if (!pCacheInfo) {
+      options.keepSource = cxx::find<STRUCTURE_TYPE_PARSER_EDITABLE_SOURCE_INFO>(pCreateInfo->pNext) != nullptr;
+      *pParser = new Parser_T{.parser{std::move(source), options}};
+      return PARSER_ERROR_NONE;
+    }
+    if (!pCacheInfo->pDirectoryPath) {
+      return PARSER_ERROR_ILLEGAL_PARAMETER;
+    }
 
-      pInvalidTokenOutput->line = line;
-      pInvalidTokenOutput->column = column;
-      pInvalidTokenOutput->tokenLength = token.length();
-      char_traits<char>::copy(pInvalidTokenOutput->pToken, token.data(), token.length());
-      *(pInvalidTokenOutput->pToken + pInvalidTokenOutput->tokenLength) = '\0';
+    SourceDigest const digest{source.view()};
+    auto const cachedPath = cachedProgramPath(*pCacheInfo, digest);
+    try {
+      auto image = Source::fromPath(cachedPath.string());
+      *pParser = new Parser_T{.parser{std::move(image), digest}};
+      return PARSER_ERROR_NONE;
+    } catch (InvalidPathException const&) {
+    } catch (InvalidBinaryException const&) {
     }
-    return PARSER_ERROR_INVALID_TOKEN;
+
+    auto* pNewParser = new Parser_T{.parser{std::move(source), options}};
+    storeCachedProgram(cachedPath, pNewParser->parser.binaryProgram());
+    *pParser = pNewParser;
+    return PARSER_ERROR_NONE;
+  } catch (LocatedInvalidTokenException const& invalidTokenException) {
+    return reportInvalidToken(invalidTokenException, pCreateInfo->pNext);
   } catch (InvalidPathException const&) {
     return PARSER_ERROR_INVALID_PATH;
+  } catch (InvalidBinaryException const&) {
+    return PARSER_ERROR_INVALID_BINARY;
   } catch (exception const& e) {
     ignore = e;
     return PARSER_ERROR_UNKNOWN;
@@ -645,52 +1979,81 @@ void destroyParser(Parser parser) {
   delete parser;
 }
 
+ParserError updateParser(Parser parser, ParserUpdateInfo const* pUpdateInfo) {
+  if (parser == nullptr || pUpdateInfo == nullptr || (pUpdateInfo->pText == nullptr && pUpdateInfo->textLength != 0)
+      || !parser->parser.editable()
+      || uint64_t{pUpdateInfo->offset} + pUpdateInfo->removedLength > parser->parser.text().length()) {
+    return PARSER_ERROR_ILLEGAL_PARAMETER;
+  }
+
+  try {
+    parser->parser.update(
+        pUpdateInfo->offset, pUpdateInfo->removedLength, string_view{pUpdateInfo->pText, pUpdateInfo->textLength}
+    );
+    return PARSER_ERROR_NONE;
+  } catch (LocatedInvalidTokenException const& invalidTokenException) {
+    return reportInvalidToken(invalidTokenException, pUpdateInfo->pNext);
+  } catch (exception const&) {
+    return PARSER_ERROR_UNKNOWN;
+  }
+}
+
 ParserError getParserInstructionSet(
     Parser parser,
     ParserGetInstructionSetInfo const* pGetInfo,
     U16* pInstructionCount,
     Instruction* pInstructions
 ) {
-  if (parser == nullptr || pGetInfo == nullptr || pInstructionCount == nullptr) {
+  return getInstructionSet(parser, pGetInfo, pInstructionCount, pInstructions);
+}
+
+ParserError getParserInstructionSet2(
+    Parser parser,
+    ParserGetInstructionSetInfo2 const* pGetInfo,
+    U32* pInstructionCount,
+    Instruction* pInstructions
+) {
+  return getInstructionSet(parser, pGetInfo, pInstructionCount, pInstructions);
+}
+
+ParserError getParserBinaryProgram(Parser parser, U32* pBinarySize, void* pBinary) {
+  if (parser == nullptr || pBinarySize == nullptr) {
     return PARSER_ERROR_ILLEGAL_PARAMETER;
   }
 
   try {
-    auto const &instructions =
-        parser->parser.makeInstructionSet(pGetInfo->mappedRegisterCount, pGetInfo->pMappedRegisters);
-    auto givenCount = exchange(*pInstructionCount, instructions.size());
-    if (pInstructions) {
-      if (givenCount < instructions.size()) {
-        return PARSER_ERROR_ARRAY_TOO_SMALL;
-      }
-
-      for (auto const &instruction: instructions) {
-        *(pInstructions++) = instruction.handle();
-      }
+    auto const& image = parser->parser.binaryProgram();
+    if (image.size() > numeric_limits<U32>::max()) {
+      return PARSER_ERROR_PROGRAM_TOO_LARGE;
     }
-    return PARSER_ERROR_NONE;
-  } catch (UndefinedReferenceException const& undefinedReferenceException) {
-    if (auto* pUndefinedReferenceInfo =
-        cxx::find<STRUCTURE_TYPE_PARSER_UNDEFINED_REFERENCE_OUTPUT_INFO>(pGetInfo->pNext)) {
-      auto const* pEncoded = undefinedReferenceException.referencedFrom();
-      auto const id = undefinedReferenceException.identifier();
-
-      if (!pUndefinedReferenceInfo->pToken) {
-        return PARSER_ERROR_ILLEGAL_PARAMETER;
-      }
-
-      if (pUndefinedReferenceInfo->tokenLength <= id.length()) { // Includes '\0'
+    auto givenSize = exchange(*pBinarySize, static_cast<U32>(image.size()));
+    if (pBinary) {
+      if (givenSize < image.size()) {
         return PARSER_ERROR_ARRAY_TOO_SMALL;
       }
-
-      pUndefinedReferenceInfo->referencingInstructionIndex = pEncoded->index();
-      pUndefinedReferenceInfo->tokenLength = id.length();
-      char_traits<char>::copy(pUndefinedReferenceInfo->pToken, id.data(), id.length());
-      *(pUndefinedReferenceInfo->pToken + pUndefinedReferenceInfo->tokenLength) = '\0';
+      char_traits<char>::copy(static_cast<char*>(pBinary), image.data(), image.size());
     }
-    return PARSER_ERROR_UNDEFINED_REFERENCE;
+    return PARSER_ERROR_NONE;
   } catch (exception const& e) {
     return PARSER_ERROR_UNKNOWN;
   }
 }
+
+ParserError getParserPackedProgram(
+    Parser parser,
+    ParserGetPackedProgramInfo const* pGetInfo,
+    U16* pInstructionCount,
+    PackedInstruction* pInstructions
+) {
+  return getPackedProgram(parser, pGetInfo, pInstructionCount, pInstructions);
+}
+
+ParserError getParserPackedProgram2(
+    Parser parser,
+    ParserGetPackedProgramInfo const* pGetInfo,
+    U32* pInstructionCount,
+    PackedInstruction* pInstructions
+) {
+  return getPackedProgram(parser, pGetInfo, pInstructionCount, pInstructions);
+}
 } // extern "C"
@@ -16,11 +16,14 @@ typedef enum {
   PARSER_ERROR_INVALID_TOKEN,
   PARSER_ERROR_UNDEFINED_REFERENCE,
   PARSER_ERROR_UNKNOWN,
+  PARSER_ERROR_INVALID_BINARY,
+  PARSER_ERROR_PROGRAM_TOO_LARGE, // More instructions or bytes than the count type can hold.
 } ParserError;
 
 typedef enum {
   PARSER_INPUT_TYPE_CODE,
   PARSER_INPUT_TYPE_FILE_PATH,
+  PARSER_INPUT_TYPE_BINARY, // Path of a program emitted by getParserBinaryProgram.
 } ParserInputType;
 
 typedef struct {
@@ -44,6 +47,25 @@ typedef struct {
   ParserMappedRegister const* pMappedRegisters;
 } ParserGetInstructionSetInfo;
 
+typedef struct {
+  StructureType structureType;
+  void* pNext;
+  U32 mappedRegisterCount;
+  ParserMappedRegister const* pMappedRegisters;
+} ParserGetInstructionSetInfo2;
+
+typedef struct {
+  U32 registerNameLength;
+  char const* pRegisterName;
+} ParserRegisterName;
+
+typedef struct {
+  StructureType structureType;
+  void* pNext;
+  U16 registerNameCount;
+  ParserRegisterName const* pRegisterNames;
+} ParserGetPackedProgramInfo;
+
 typedef struct {
   StructureType structureType;
   void* pNext;
@@ -59,13 +81,61 @@ typedef struct {
   U32 referencingInstructionIndex;
   U32 tokenLength;
   char* pToken;
+  U32 referencingLine;
 } ParserUndefinedReferenceOutputInfo;
 
+// Chained into ParserCreateInfo for code or file path input. Programs are cached in the
+// directory under a hash of their source text; a hit loads the binary form instead of
+// parsing, and a miss parses and stores it.
+typedef struct {
+  StructureType structureType;
+  void* pNext;
+  U32 directoryPathLength; // 0 if pDirectoryPath is '\0' terminated
+  char const* pDirectoryPath;
+} ParserProgramCacheInfo;
+
+// Chained into ParserCreateInfo for code or file path input. The source is split after line
+// breaks into chunks that are tokenized concurrently and stitched together; the program and
+// the location of any invalid token match a serial parse.
+typedef struct {
+  StructureType structureType;
+  void* pNext;
+  U32 threadCount; // 0 for one per hardware thread
+  U32 chunkLength; // Bytes per chunk; 0 to derive it from the source length and threadCount
+} ParserParallelParseInfo;
+
+// Chained into ParserCreateInfo for code or file path input. Parsers release the source
+// text once it is parsed unless this is given, which keeps it for updateParser to edit.
+typedef struct {
+  StructureType structureType;
+  void* pNext;
+} ParserEditableSourceInfo;
+
+// Replaces removedLength bytes at offset in the source text with textLength bytes of pText.
+typedef struct {
+  StructureType structureType;
+  void* pNext;
+  U32 offset;
+  U32 removedLength;
+  U32 textLength;
+  char const* pText;
+} ParserUpdateInfo;
+
 DEFINE_HANDLE(Parser);
 
 extern ParserError createParser(ParserCreateInfo const* pCreateInfo, Parser* pParser);
 extern void destroyParser(Parser parser);
 
+// Edits the source of a parser created from code or a file path with ParserEditableSourceInfo
+// and without a program cache. Only the lines around the edit are tokenized again, and an
+// instruction set already linked is patched where possible, so getParserInstructionSet*
+// stays cheap afterwards; instructions it returned before may change in place. An invalid
+// token leaves the parser unchanged and is reported like createParser does, through
+// ParserInvalidTokenOutputInfo in pNext.
+extern ParserError updateParser(Parser parser, ParserUpdateInfo const* pUpdateInfo);
+
+// Constant operands and branch targets point into a read-only table shared by every parser,
+// so a program writing to a constant yields PARSER_ERROR_ILLEGAL_PARAMETER.
 extern ParserError getParserInstructionSet(
     Parser parser,
     ParserGetInstructionSetInfo const* pGetInfo,
@@ -73,6 +143,41 @@ extern ParserError getParserInstructionSet(
     Instruction* pInstructions
 );
 
+// As getParserInstructionSet, for programs of any size. Branches to instructions past index
+// 0xFFFF carry the target in both operands (see Instruction_getBranchTarget); any other use
+// of such a label yields PARSER_ERROR_ILLEGAL_PARAMETER.
+extern ParserError getParserInstructionSet2(
+    Parser parser,
+    ParserGetInstructionSetInfo2 const* pGetInfo,
+    U32* pInstructionCount,
+    Instruction* pInstructions
+);
+
+// Yields the program in its relocatable form (see Instruction_pack): the register named by
+// pRegisterNames[i] becomes data register i of whichever CPU runs it through CPU_runPacked,
+// so one program can be shared by any number of CPUs. At most CPU_DATA_REGISTRY_LIST_SIZE
+// names may be given. A program writing to a constant yields PARSER_ERROR_ILLEGAL_PARAMETER.
+// pNext accepts ParserUndefinedReferenceOutputInfo.
+extern ParserError getParserPackedProgram(
+    Parser parser,
+    ParserGetPackedProgramInfo const* pGetInfo,
+    U16* pInstructionCount,
+    PackedInstruction* pInstructions
+);
+
+// As getParserPackedProgram, for programs of any size (see getParserInstructionSet2).
+extern ParserError getParserPackedProgram2(
+    Parser parser,
+    ParserGetPackedProgramInfo const* pGetInfo,
+    U32* pInstructionCount,
+    PackedInstruction* pInstructions
+);
+
+// Serializes the program into the binary form loaded by PARSER_INPUT_TYPE_BINARY: the
+// instructions, labels, referenced names and the source line of every instruction. When
+// pBinary is not NULL, *pBinarySize must hold its capacity.
+extern ParserError getParserBinaryProgram(Parser parser, U32* pBinarySize, void* pBinary);
+
 #ifdef __cplusplus
 }
 #endif
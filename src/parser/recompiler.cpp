@@ -0,0 +1,365 @@
+#include "recompiler.h"
+
+#include <algorithm>
+#include <exception>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <model/Instruction.h>
+#include <model/InstructionType.h>
+#include <model/Register.h>
+
+namespace {
+using std::all_of;
+using std::any_of;
+using std::char_traits;
+using std::exchange;
+using std::exception;
+using std::ostringstream;
+using std::string;
+using std::string_view;
+using std::to_string;
+using std::vector;
+
+class IllegalParameterException : public exception {
+public:
+  [[nodiscard]] auto what() const noexcept -> char const* override {
+    return "";
+  }
+};
+
+auto validKernelName(string_view name) {
+  auto identifierChar = [](char c, bool first) {
+    return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || c == '_' || (!first && '0' <= c && c <= '9');
+  };
+  if (name.empty() || !identifierChar(name.front(), true)) {
+    return false;
+  }
+  return all_of(name.begin() + 1, name.end(), [&](char c) { return identifierChar(c, false); });
+}
+
+auto isBranch(InstructionType type) {
+  return type >= IPU_JMP && type <= IPU_CALL;
+}
+
+auto writesFirstOperand(InstructionType type) {
+  return type >= ALU_ADD && type <= ALU_SHR;
+}
+
+class KernelWriter {
+public:
+  KernelWriter(
+      string_view name,
+      vector<Instruction> const& instructions,
+      ParserTranslateInfo const& translateInfo
+  ) : _name{name}, _instructions{instructions}, _translateInfo{translateInfo} {}
+
+  auto write() -> string {
+    auto const count = static_cast<unsigned>(_instructions.size());
+    for (auto idx = 0u; idx < count; ++idx) {
+      writeInstruction(idx, _instructions[idx]);
+    }
+
+    ostringstream out;
+    out << "// Generated by translateParserProgram. Do not edit.\n\n"
+        << "#include <proc/Alu.h>\n"
+        << "#include <proc/Kernel.h>\n\n"
+        << "static CpuRunResult " << _name
+        << "_run(CPU cpu, KernelCallStack * pCallStack, U32 maxSteps, CpuRunStats * pStats) {\n"
+        << "  Register * const r = CPU_getDataRegisters(cpu);\n"
+        << "  Register * const flags = CPU_getFlagRegisterAddress(cpu);\n";
+    if (_usesAluFlags || _usesOverflow) {
+      out << "  ALU const alu = CPU_getALU(cpu);\n";
+    }
+    if (_usesAluFlags) {
+      out << "  Register * const aluFlags = ALU_getFlagRegister(alu);\n";
+    }
+    if (_usesOverflow) {
+      out << "  Register * const overflow = ALU_getOverflowRegister(alu);\n";
+    }
+    if (!_usesCallStack) {
+      out << "  (void) pCallStack;\n";
+    }
+    if (count == 0) {
+      out << "  (void) maxSteps;\n";
+    }
+    out << "  U32 pc = CPU_getProgramCounter(cpu);\n"
+        << "  U32 steps = 0;\n"
+        << "  CpuRunResult result;\n\n"
+        << "  if (Register_isSet(*flags, FR_FAULT_MASK)) {\n"
+        << "    result = CPU_RUN_RESULT_FAULT;\n"
+        << "    goto stop;\n"
+        << "  }\n\n";
+
+    if (_usesDispatch) {
+      out << "dispatch:\n";
+    }
+    out << "  switch (pc) {\n";
+    for (auto idx = 0u; idx < count; ++idx) {
+      out << "    case " << idx << ": goto i" << idx << ";\n";
+    }
+    out << "    default: goto i" << count << ";\n"
+        << "  }\n\n"
+        << _body.str()
+        << "i" << count << ":\n"
+        << "  pc = " << count << ";\n"
+        << "  result = CPU_RUN_RESULT_END_OF_PROGRAM;\n"
+        << "  goto stop;\n";
+    if (count != 0) {
+      out << "limit:\n"
+          << "  result = CPU_RUN_RESULT_STEP_LIMIT;\n"
+          << "  goto stop;\n";
+    }
+    if (_usesFault) {
+      out << "fault:\n"
+          << "  result = CPU_RUN_RESULT_FAULT;\n";
+    }
+    out << "stop:\n"
+        << "  CPU_setProgramCounter(cpu, pc);\n"
+        << "  if (pStats != NULL) {\n"
+        << "    pStats->result = result;\n"
+        << "    pStats->executedInstructionCount = steps;\n"
+        << "    pStats->programCounter = pc;\n"
+        << "  }\n"
+        << "  return result;\n"
+        << "}\n\n"
+        << "Kernel const " << _name << " = {\"" << _name << "\", " << count << ", " << _name << "_run};\n";
+    return out.str();
+  }
+
+private:
+  [[nodiscard]] auto isDataRegister(Register const* p) const {
+    auto const* pFile = _translateInfo.pRegisterFile;
+    return pFile <= p && p < pFile + CPU_DATA_REGISTRY_LIST_SIZE;
+  }
+
+  [[nodiscard]] auto operand(Register const* p) const -> string {
+    if (isDataRegister(p)) {
+      return "r[" + to_string(p - _translateInfo.pRegisterFile) + "]";
+    }
+
+    auto const* pMapped = _translateInfo.pMappedRegisters;
+    if (any_of(pMapped, pMapped + _translateInfo.mappedRegisterCount, [p](auto const& mapped) {
+      return mapped.pRegister == p;
+    })) {
+      throw IllegalParameterException();
+    }
+    return to_string(*p) + "u";
+  }
+
+  auto writeFault(unsigned idx, string_view indent) {
+    _usesFault = true;
+    _body << indent << "*flags |= FR_SEG_FLAG;\n"
+          << indent << "pc = " << idx << ";\n"
+          << indent << "goto fault;\n";
+  }
+
+  auto writeJump(unsigned idx, U32 target, string_view indent) {
+    if (target > _instructions.size()) {
+      writeFault(idx, indent);
+      return;
+    }
+    _body << indent << "++steps;\n"
+          << indent << "goto i" << target << ";\n";
+  }
+
+  auto writeAlu(InstructionType type, Register const* p0, Register const* p1) {
+    if (writesFirstOperand(type) && !isDataRegister(p0)) {
+      throw IllegalParameterException();
+    }
+    if (p1 == nullptr && type != ALU_NOT) {
+      throw IllegalParameterException();
+    }
+
+    auto const lhs = operand(p0);
+    _body << "  *flags = 0;\n"
+          << "  {\n"
+          << "    Register const a = " << lhs;
+    if (p1 != nullptr && type != ALU_NOT) {
+      _body << ", b = " << operand(p1);
+    }
+    _body << ";\n";
+
+    auto binary = [&](char const* op) {
+      _body << "    " << lhs << " = (Register) ((U32) a " << op << " (U32) b);\n";
+    };
+    switch (type) {
+      case ALU_ADD: binary("+"); break;
+      case ALU_MUL: binary("*"); break;
+      case ALU_AND: binary("&"); break;
+      case ALU_OR: binary("|"); break;
+      case ALU_XOR: binary("^"); break;
+      case ALU_SHL: binary("<<"); break;
+      case ALU_SHR: binary(">>"); break;
+      case ALU_NOT:
+        _body << "    " << lhs << " = (Register) ~(U32) a;\n";
+        break;
+      case ALU_SUB:
+        _usesOverflow = true;
+        _body << "    U32 const c = (U32) a - (U32) b;\n"
+              << "    " << lhs << " = (Register) c;\n"
+              << "    *overflow = (Register) (c >> 16);\n";
+        break;
+      case ALU_DIV:
+        _usesAluFlags = true;
+        _usesOverflow = true;
+        _body << "    if (b == 0) {\n"
+              << "      *aluFlags |= FR_DIV_ZERO_FLAG;\n"
+              << "    } else {\n"
+              << "      " << lhs << " = (Register) (a / b);\n"
+              << "      *overflow = (Register) (a % b);\n"
+              << "    }\n";
+        break;
+      case ALU_CMP:
+        _usesAluFlags = true;
+        _body << "    if (a == b) {\n"
+              << "      *aluFlags |= FR_EQUAL_FLAG;\n"
+              << "    } else if (a < b) {\n"
+              << "      *aluFlags |= FR_LESS_FLAG;\n"
+              << "    }\n";
+        break;
+      default:
+        throw IllegalParameterException();
+    }
+    _body << "  }\n"
+          << "  ++steps;\n";
+  }
+
+  auto writeBranch(unsigned idx, InstructionType type, Instruction instr) {
+    if (Instruction_getParam1(instr) == nullptr) {
+      throw IllegalParameterException();
+    }
+
+    auto const target = Instruction_getBranchTarget(instr);
+    char const* condition = nullptr;
+    switch (type) {
+      case IPU_JEQ: condition = "Register_isSet(*flags, FR_EQUAL_FLAG)"; break;
+      case IPU_JNE: condition = "!Register_isSet(*flags, FR_EQUAL_FLAG)"; break;
+      case IPU_JLT: condition = "Register_isSet(*flags, FR_LESS_FLAG)"; break;
+      case IPU_JLE: condition = "Register_isSet(*flags, FR_LESS_FLAG | FR_EQUAL_FLAG)"; break;
+      case IPU_JGT: condition = "!Register_isSet(*flags, FR_LESS_FLAG | FR_EQUAL_FLAG)"; break;
+      case IPU_JGE: condition = "!Register_isSet(*flags, FR_LESS_FLAG)"; break;
+      default: break;
+    }
+
+    if (type == IPU_CALL) {
+      _usesCallStack = true;
+      _body << "  if (pCallStack->callDepth == IPU_CALL_STACK_SIZE) {\n";
+      writeFault(idx, "    ");
+      _body << "  }\n";
+      if (target > _instructions.size()) {
+        writeFault(idx, "  ");
+        return;
+      }
+      _body << "  pCallStack->returnAddresses[pCallStack->callDepth++] = " << idx + 1 << ";\n";
+      writeJump(idx, target, "  ");
+    } else if (condition == nullptr) {
+      writeJump(idx, target, "  ");
+    } else {
+      _body << "  if (" << condition << ") {\n";
+      writeJump(idx, target, "    ");
+      _body << "  }\n"
+            << "  ++steps;\n";
+    }
+  }
+
+  auto writeInstruction(unsigned idx, Instruction instr) -> void {
+    auto const type = Instruction_getType(instr);
+    _body << "i" << idx << ":\n"
+          << "  if (steps == maxSteps) {\n"
+          << "    pc = " << idx << ";\n"
+          << "    goto limit;\n"
+          << "  }\n";
+
+    if (type >= ALU_ADD && type <= ALU_CMP) {
+      writeAlu(type, Instruction_getParam1(instr), Instruction_getParam2(instr));
+    } else if (isBranch(type)) {
+      writeBranch(idx, type, instr);
+    } else if (type == IPU_RET) {
+      _usesCallStack = true;
+      _usesDispatch = true;
+      _body << "  ++steps;\n"
+            << "  if (pCallStack->callDepth == 0) {\n"
+            << "    goto i" << _instructions.size() << ";\n"
+            << "  }\n"
+            << "  pc = pCallStack->returnAddresses[--pCallStack->callDepth];\n"
+            << "  goto dispatch;\n";
+    } else {
+      _body << "  *flags = 0;\n"
+            << "  ++steps;\n";
+    }
+  }
+
+  string_view _name;
+  vector<Instruction> const& _instructions;
+  ParserTranslateInfo const& _translateInfo;
+  ostringstream _body;
+  bool _usesAluFlags {false};
+  bool _usesOverflow {false};
+  bool _usesCallStack {false};
+  bool _usesDispatch {false};
+  bool _usesFault {false};
+};
+} // namespace
+
+extern "C" {
+ParserError translateParserProgram(
+    Parser parser,
+    ParserTranslateInfo const* pTranslateInfo,
+    U32* pSourceLength,
+    char* pSource
+) {
+  if (parser == nullptr || pTranslateInfo == nullptr || pSourceLength == nullptr
+      || pTranslateInfo->pRegisterFile == nullptr || pTranslateInfo->pKernelName == nullptr) {
+    return PARSER_ERROR_ILLEGAL_PARAMETER;
+  }
+
+  auto const name = string_view{
+      pTranslateInfo->pKernelName,
+      pTranslateInfo->kernelNameLength == 0u
+          ? char_traits<char>::length(pTranslateInfo->pKernelName)
+          : pTranslateInfo->kernelNameLength
+  };
+  if (!validKernelName(name)) {
+    return PARSER_ERROR_ILLEGAL_PARAMETER;
+  }
+
+  ParserGetInstructionSetInfo2 getInfo {
+      .structureType = STRUCTURE_TYPE_PARSER_GET_INSTRUCTION_SET_INFO_2,
+      .pNext = pTranslateInfo->pNext,
+      .mappedRegisterCount = pTranslateInfo->mappedRegisterCount,
+      .pMappedRegisters = pTranslateInfo->pMappedRegisters
+  };
+  U32 instructionCount = 0;
+  if (auto const error = getParserInstructionSet2(parser, &getInfo, &instructionCount, nullptr);
+      error != PARSER_ERROR_NONE) {
+    return error;
+  }
+  vector<Instruction> instructions(instructionCount, nullptr);
+  if (auto const error = getParserInstructionSet2(parser, &getInfo, &instructionCount, instructions.data());
+      error != PARSER_ERROR_NONE) {
+    return error;
+  }
+
+  try {
+    auto const source = KernelWriter{name, instructions, *pTranslateInfo}.write();
+    auto const requiredLength = static_cast<U32>(source.length() + 1); // Includes '\0'
+    auto const givenLength = exchange(*pSourceLength, requiredLength);
+    if (pSource) {
+      if (givenLength < requiredLength) {
+        return PARSER_ERROR_ARRAY_TOO_SMALL;
+      }
+      char_traits<char>::copy(pSource, source.data(), source.length());
+      pSource[source.length()] = '\0';
+    }
+    return PARSER_ERROR_NONE;
+  } catch (IllegalParameterException const&) {
+    return PARSER_ERROR_ILLEGAL_PARAMETER;
+  } catch (exception const&) {
+    return PARSER_ERROR_UNKNOWN;
+  }
+}
+} // extern "C"
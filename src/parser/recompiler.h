@@ -0,0 +1,40 @@
+#ifndef RECOMPILER_H
+#define RECOMPILER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <parser/parser.h>
+
+typedef struct {
+  StructureType structureType;
+  void* pNext;
+  U16 mappedRegisterCount;
+  ParserMappedRegister const* pMappedRegisters;
+  Register const* pRegisterFile;
+  U32 kernelNameLength;
+  char const* pKernelName;
+} ParserTranslateInfo;
+
+// Translates the parsed program into a C translation unit defining `Kernel const <name>`
+// (see proc/Kernel.h). Every mapped register must point into pRegisterFile, an array of
+// CPU_DATA_REGISTRY_LIST_SIZE registers standing in for the CPU's data registers; the
+// register at index i becomes data register i in the generated code. Constant operands
+// are folded into the code, so a program writing to a constant yields
+// PARSER_ERROR_ILLEGAL_PARAMETER. pNext accepts ParserUndefinedReferenceOutputInfo.
+//
+// pSourceLength receives the size of the source including the terminating '\0'. When
+// pSource is not NULL, *pSourceLength must hold its capacity.
+extern ParserError translateParserProgram(
+    Parser parser,
+    ParserTranslateInfo const* pTranslateInfo,
+    U32* pSourceLength,
+    char* pSource
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
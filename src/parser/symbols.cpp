@@ -0,0 +1,92 @@
+#include "symbols.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace parser {
+auto SymbolTable::intern(std::string_view name) -> Symbol {
+  if (_slots.size() < 2 * (_names.size() + 1)) {
+    grow();
+  }
+  auto const nameHash = hash(name);
+  auto& slot = _slots[this->slot(name, nameHash)];
+  if (slot.symbol != 0) {
+    return static_cast<Symbol>(slot.symbol - 1);
+  }
+  _names.push_back(store(name));
+  slot = Slot{.hash = nameHash, .symbol = static_cast<uint32_t>(_names.size())};
+  return static_cast<Symbol>(_names.size() - 1);
+}
+
+auto SymbolTable::find(std::string_view name) const noexcept -> std::optional<Symbol> {
+  if (_slots.empty()) {
+    return std::nullopt;
+  }
+  if (auto const symbol = _slots[slot(name, hash(name))].symbol; symbol != 0) {
+    return static_cast<Symbol>(symbol - 1);
+  }
+  return std::nullopt;
+}
+
+// Identifiers are short, so they are hashed eight bytes per step.
+auto SymbolTable::hash(std::string_view name) noexcept -> uint32_t {
+  constexpr uint64_t multiplier = 0x9e3779b97f4a7c15u;
+  uint64_t value = name.length() * multiplier;
+  while (!name.empty()) {
+    uint64_t word = 0;
+    auto const length = std::min(name.length(), sizeof(word));
+    std::memcpy(&word, name.data(), length);
+    value = (value ^ word) * multiplier;
+    name.remove_prefix(length);
+  }
+  return static_cast<uint32_t>(value >> 32u);
+}
+
+auto SymbolTable::slot(std::string_view name, uint32_t hash) const noexcept -> size_t {
+  auto const mask = _slots.size() - 1;
+  for (auto i = size_t{hash} & mask;; i = (i + 1) & mask) {
+    auto const& slot = _slots[i];
+    if (slot.symbol == 0 || (slot.hash == hash && _names[slot.symbol - 1] == name)) {
+      return i;
+    }
+  }
+}
+
+// Keeps the table at most half full.
+auto SymbolTable::grow() -> void {
+  auto const slots = std::move(_slots);
+  _slots.assign(std::max<size_t>(64, slots.size() * 2), Slot{.hash = 0, .symbol = 0});
+  auto const mask = _slots.size() - 1;
+  for (auto const& slot : slots) {
+    if (slot.symbol != 0) {
+      auto i = size_t{slot.hash} & mask;
+      while (_slots[i].symbol != 0) {
+        i = (i + 1) & mask;
+      }
+      _slots[i] = slot;
+    }
+  }
+}
+
+// Names longer than a block get one of their own, placed before the block being filled.
+auto SymbolTable::store(std::string_view name) -> std::string_view {
+  if (name.empty()) {
+    return {};
+  }
+  char* pName;
+  if (name.length() > blockLength) {
+    auto const at = _blocks.empty() ? _blocks.end() : std::prev(_blocks.end());
+    pName = _blocks.insert(at, std::make_unique_for_overwrite<char[]>(name.length()))->get();
+  } else {
+    if (name.length() > _blockFree) {
+      _blocks.push_back(std::make_unique_for_overwrite<char[]>(blockLength));
+      _blockFree = blockLength;
+    }
+    pName = _blocks.back().get() + (blockLength - _blockFree);
+    _blockFree -= name.length();
+  }
+  std::copy(name.begin(), name.end(), pName);
+  return {pName, name.length()};
+}
+} // namespace parser
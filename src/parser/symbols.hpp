@@ -0,0 +1,57 @@
+//
+// Identifiers of a program, interned once each. References and labels are 32-bit symbols,
+// numbered densely from 0 in order of first appearance, so that tables indexed by symbol
+// replace lookups by name.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace parser {
+enum class Symbol : uint32_t {};
+
+[[nodiscard]] constexpr auto symbolIndex(Symbol symbol) noexcept -> size_t {
+  return static_cast<size_t>(symbol);
+}
+
+// Names are copied into blocks that never move, so views of them live as long as the table,
+// including across moves. Lookups probe a flat table of hashes and symbols.
+class SymbolTable {
+public:
+  auto intern(std::string_view name) -> Symbol;
+  [[nodiscard]] auto find(std::string_view name) const noexcept -> std::optional<Symbol>;
+
+  [[nodiscard]] auto name(Symbol symbol) const noexcept -> std::string_view {
+    return _names[symbolIndex(symbol)];
+  }
+
+  [[nodiscard]] auto size() const noexcept -> size_t {
+    return _names.size();
+  }
+
+private:
+  static constexpr size_t blockLength = 16u << 10u;
+
+  struct Slot {
+    uint32_t hash;
+    uint32_t symbol; // Symbol + 1, or 0 for an empty slot.
+  };
+
+  [[nodiscard]] static auto hash(std::string_view name) noexcept -> uint32_t;
+  // Slot holding name, or the empty one where it belongs.
+  [[nodiscard]] auto slot(std::string_view name, uint32_t hash) const noexcept -> size_t;
+  auto grow() -> void;
+  auto store(std::string_view name) -> std::string_view;
+
+  std::vector<std::unique_ptr<char[]>> _blocks;
+  size_t _blockFree {0};
+  std::vector<std::string_view> _names;
+  std::vector<Slot> _slots;
+};
+} // namespace parser
@@ -11,4 +11,36 @@ typedef struct Private_ALU * ALU;
 extern ALU ALU_ctor(Register*, Register*);
 extern void ALU_dtor(ALU obj);
 extern void ALU_execute(ALU self, Instruction instruction);
+// Shifts take their count modulo 32.
+extern void ALU_executeOperation(ALU self, InstructionType type, Register * lhs, Register * rhs);
+
+// Applies one operation to count independent operand pairs: out[i] receives what
+// ALU_executeOperation leaves in lhs, flags[i] the flags it raises, and overflow[i] is
+// written only where it writes the overflow register (sub, and div by a non-zero divisor).
+// flags and overflow may be NULL. The ALU's own registers are not touched. Shift counts are
+// taken modulo 32, as ALU_executeOperation does. Uses AVX2 or SSE2 kernels on x86-64 and the
+// scalar ALU elsewhere; division is always scalar.
+extern void ALU_executeBatch(
+    ALU self,
+    InstructionType type,
+    Register const * lhs,
+    Register const * rhs,
+    Register * out,
+    Register * overflow,
+    Register * flags,
+    U32 count
+);
+extern Register * ALU_getFlagRegister(ALU self);
+extern Register * ALU_getOverflowRegister(ALU self);
+
+// In lazy mode ALU_execute records only what the flags depend on, the operands of a compare
+// or whether a division was by zero, instead of writing the flag register, and the flags are
+// computed when they are read: by ALU_materializeFlags, ALU_getFlagRegister, or the CPU
+// before a conditional jump or a flag accessor. The materialized value
+// is that of the last operation alone, which is what eager mode yields when the register is
+// cleared before every instruction, as the CPU does when the ALU writes its flag register.
+extern void ALU_setLazyFlags(ALU self, bool lazy);
+extern bool ALU_hasLazyFlags(ALU self);
+extern void ALU_deferFlagClear(ALU self);
+extern void ALU_materializeFlags(ALU self);
 #endif //ALU_H
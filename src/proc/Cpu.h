@@ -11,15 +11,60 @@
 
 typedef struct Private_CPU * CPU;
 
+#define CPU_RUN_NO_STEP_LIMIT (0xFFFFFFFFu)
+
+typedef enum {
+  CPU_RUN_RESULT_END_OF_PROGRAM,
+  CPU_RUN_RESULT_STEP_LIMIT,
+  CPU_RUN_RESULT_FAULT,
+} CpuRunResult;
+
+typedef struct {
+  CpuRunResult result;
+  U32 executedInstructionCount;
+  U32 programCounter;
+} CpuRunStats;
+
 extern CPU CPU_ctor();
 extern void CPU_dtor(CPU self);
 
+// Clears the registers, program counter and call stacks, keeping the ALU and the loaded program.
+extern void CPU_reset(CPU self);
+
 extern void CPU_setALU(CPU self, ALU alu);
+extern ALU CPU_getALU(CPU self);
 extern void CPU_execute(CPU self, Instruction);
 extern void CPU_setDataRegister(CPU self, U8 index, Register value);
 extern Register CPU_getDataRegister(CPU self, U8 index);
 extern void CPU_raiseFlag(CPU self, U16 flag);
 extern Register CPU_getFlagRegister(CPU self);
+extern Register * CPU_getFlagRegisterAddress(CPU self);
 extern Register * CPU_getDataRegisters(CPU self);
 
+extern U32 CPU_getProgramCounter(CPU self);
+extern void CPU_setProgramCounter(CPU self, U32 programCounter);
+
+// Links the program run by CPU_run through an IPU and clears its call stack. The IPU keeps
+// the instruction handles and their decoded branch targets, so the program must be loaded
+// again whenever the array is refilled or its instructions are changed in place.
+extern void CPU_loadProgram(CPU self, Instruction const * pInstructions, U32 instructionCount);
+
+// Runs the loaded program from the current program counter until it falls off the end of
+// the instruction array, maxSteps instructions have retired, or a FR_FAULT_MASK flag is
+// raised. The program counter is left on the next instruction, so a run can be resumed. No
+// loaded program runs as an empty one. An ALU in lazy flags mode must write the CPU flag
+// register; its flags are materialized before conditional jumps and by the flag accessors.
+extern CpuRunResult CPU_run(CPU self, U32 maxSteps, CpuRunStats * pStats);
+
+// CPU_run over a packed program (see Instruction_pack). Register operands index the CPU's
+// data registers and immediates are read-only. Calls use a stack kept in the CPU, separate
+// from the one used by CPU_run.
+extern CpuRunResult CPU_runPacked(
+    CPU self,
+    PackedInstruction const * pInstructions,
+    U32 instructionCount,
+    U32 maxSteps,
+    CpuRunStats * pStats
+);
+
 #endif // EMBEDDED_SIM_CPU_H
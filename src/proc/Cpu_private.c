@@ -1,11 +1,16 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <proc/Cpu.h>
+#include <proc/Ipu.h>
 
 typedef struct Private_CPU {
   Register dataRegisters[CPU_DATA_REGISTRY_LIST_SIZE];
   Register flagRegister;
+  U32 programCounter;
   ALU alu;
+  IPU ipu;
+  U32 packedCallDepth;
+  U32 packedCallStack[IPU_CALL_STACK_SIZE];
 } Private_CPU;
 
 Private_CPU * CPU_ctor() {
@@ -15,9 +20,28 @@ Private_CPU * CPU_ctor() {
     cpu->dataRegisters[i] = 0;
   }
   cpu->flagRegister = 0;
+  cpu->programCounter = 0;
+  cpu->alu = NULL;
+  cpu->ipu = NULL;
+  cpu->packedCallDepth = 0;
   return cpu;
 }
 
+void CPU_reset(Private_CPU * self) {
+  for(int i = 0; i < CPU_DATA_REGISTRY_LIST_SIZE; i++) {
+    self->dataRegisters[i] = 0;
+  }
+  if (self->alu != NULL && ALU_hasLazyFlags(self->alu)) {
+    ALU_materializeFlags(self->alu);
+  }
+  self->flagRegister = 0;
+  self->programCounter = 0;
+  self->packedCallDepth = 0;
+  if (self->ipu != NULL) {
+    IPU_reset(self->ipu);
+  }
+}
+
 void CPU_setDataRegister(Private_CPU * self, U8 index, Register value) {
   assert(index >= 0 && index <= CPU_DATA_REGISTRY_LIST_SIZE && "Index out of bounds.\n");
   self->dataRegisters[index] = value;
@@ -29,6 +53,9 @@ Register CPU_getDataRegister(Private_CPU * self, U8 index) {
 }
 
 void CPU_dtor(Private_CPU * self) {
+  if (self->ipu != NULL) {
+    IPU_dtor(self->ipu);
+  }
   free(self);
 }
 
@@ -37,30 +64,228 @@ void CPU_setALU(CPU self, ALU alu) {
   self->alu = alu;
 }
 
-static void CPU_prepareStateBefore(Private_CPU * self, Instruction instr) {
-  assert(instr != NULL);
-  if(!Instruction_isIPU(instr)){
+ALU CPU_getALU(Private_CPU * self) {
+  return self->alu;
+}
+
+static bool CPU_hasLazyFlags(Private_CPU * self) {
+  return self->alu != NULL && ALU_hasLazyFlags(self->alu);
+}
+
+static void CPU_materializeFlags(Private_CPU * self) {
+  if (CPU_hasLazyFlags(self)) {
+    ALU_materializeFlags(self->alu);
+  }
+}
+
+static bool CPU_checkLazyFlags(Private_CPU * self) {
+  bool lazyFlags = CPU_hasLazyFlags(self);
+  assert((!lazyFlags || ALU_getFlagRegister(self->alu) == &self->flagRegister) &&
+         "Lazy flags require the ALU to write the CPU flag register");
+  return lazyFlags;
+}
+
+static void CPU_prepareStateBefore(Private_CPU * self, InstructionType type, bool lazyFlags) {
+  if (lazyFlags) {
+    if (InstructionType_isALU(type)) {
+      return;
+    }
+    if (InstructionType_isConditionalJump(type)) {
+      ALU_materializeFlags(self->alu);
+    } else if (!InstructionType_isIPU(type)) {
+      ALU_deferFlagClear(self->alu);
+    }
+    return;
+  }
+
+  if(!InstructionType_isIPU(type)){
    self->flagRegister = 0;
   }
 }
 
 void CPU_raiseFlag(Private_CPU * self, U16 flag) {
+  CPU_materializeFlags(self);
   self->flagRegister |= flag;
 }
 
 Register CPU_getFlagRegister(Private_CPU * self) {
+  CPU_materializeFlags(self);
   return self->flagRegister;
 }
 
+Register * CPU_getFlagRegisterAddress(Private_CPU * self) {
+  CPU_materializeFlags(self);
+  return &self->flagRegister;
+}
+
 Register * CPU_getDataRegisters(Private_CPU * self) {
   return self->dataRegisters;
 }
 
 void CPU_execute(Private_CPU * self, Instruction instr) {
   assert(instr != NULL);
-  CPU_prepareStateBefore(self, instr);
+  CPU_prepareStateBefore(self, Instruction_getType(instr), CPU_checkLazyFlags(self));
 
   if(Instruction_isALU(instr)) {
     ALU_execute(self->alu, instr);
   }
-}
\ No newline at end of file
+}
+
+U32 CPU_getProgramCounter(Private_CPU * self) {
+  return self->programCounter;
+}
+
+void CPU_setProgramCounter(Private_CPU * self, U32 programCounter) {
+  self->programCounter = programCounter;
+}
+
+void CPU_loadProgram(Private_CPU * self, Instruction const * pInstructions, U32 instructionCount) {
+  assert(self != NULL);
+  assert(pInstructions != NULL || instructionCount == 0);
+  if (self->ipu != NULL) {
+    IPU_dtor(self->ipu);
+  }
+  self->ipu = IPU_ctor(&self->flagRegister, pInstructions, instructionCount);
+}
+
+CpuRunResult CPU_run(Private_CPU * self, U32 maxSteps, CpuRunStats * pStats) {
+  assert(self != NULL && self->alu != NULL);
+
+  if (self->ipu == NULL) {
+    CPU_loadProgram(self, NULL, 0);
+  }
+
+  IPU ipu = self->ipu;
+  IPU_setProgramCounter(ipu, self->programCounter);
+  bool lazyFlags = CPU_checkLazyFlags(self);
+
+  CpuRunResult result;
+  U32 steps = 0;
+  for (;;) {
+    if (Register_isSet(self->flagRegister, FR_FAULT_MASK)) {
+      result = CPU_RUN_RESULT_FAULT;
+      break;
+    }
+
+    Instruction instr = IPU_fetch(ipu);
+    if (instr == NULL) {
+      result = CPU_RUN_RESULT_END_OF_PROGRAM;
+      break;
+    }
+    if (steps == maxSteps) {
+      result = CPU_RUN_RESULT_STEP_LIMIT;
+      break;
+    }
+
+    if (Instruction_getType(instr) > MMU_POP) {
+      CPU_raiseFlag(self, FR_ILLEGAL_FLAG);
+      continue;
+    }
+
+    CPU_prepareStateBefore(self, Instruction_getType(instr), lazyFlags);
+    if (Instruction_isALU(instr)) {
+      ALU_execute(self->alu, instr);
+    }
+    if (IPU_next(ipu)) {
+      ++steps;
+    } else if (lazyFlags) {
+      // The IPU raised FR_SEG_FLAG underneath the pending flags.
+      CPU_raiseFlag(self, FR_SEG_FLAG);
+    }
+  }
+
+  self->programCounter = IPU_getProgramCounter(ipu);
+  if (pStats != NULL) {
+    pStats->result = result;
+    pStats->executedInstructionCount = steps;
+    pStats->programCounter = self->programCounter;
+  }
+  return result;
+}
+
+static Register * CPU_getPackedOperand(
+    Private_CPU * self,
+    PackedInstruction instr,
+    U8 index,
+    Register * pImmediate
+) {
+  U16 operand = PackedInstruction_getOperand(instr, index);
+  if (PackedInstruction_getOperandKind(instr, index) == INSTRUCTION_OPERAND_REGISTER) {
+    assert(operand < CPU_DATA_REGISTRY_LIST_SIZE && "Register index out of bounds");
+    return &self->dataRegisters[operand];
+  }
+  *pImmediate = operand;
+  return pImmediate;
+}
+
+CpuRunResult CPU_runPacked(
+    Private_CPU * self,
+    PackedInstruction const * pInstructions,
+    U32 instructionCount,
+    U32 maxSteps,
+    CpuRunStats * pStats
+) {
+  assert(self != NULL && self->alu != NULL);
+  assert(pInstructions != NULL || instructionCount == 0);
+
+  bool lazyFlags = CPU_checkLazyFlags(self);
+  U32 programCounter = self->programCounter < instructionCount ? self->programCounter : instructionCount;
+  CpuRunResult result;
+  U32 steps = 0;
+  for (;;) {
+    if (Register_isSet(self->flagRegister, FR_FAULT_MASK)) {
+      result = CPU_RUN_RESULT_FAULT;
+      break;
+    }
+    if (programCounter == instructionCount) {
+      result = CPU_RUN_RESULT_END_OF_PROGRAM;
+      break;
+    }
+    if (steps == maxSteps) {
+      result = CPU_RUN_RESULT_STEP_LIMIT;
+      break;
+    }
+
+    PackedInstruction instr = pInstructions[programCounter];
+    InstructionType type = PackedInstruction_getType(instr);
+    if (type > MMU_POP) {
+      CPU_raiseFlag(self, FR_ILLEGAL_FLAG);
+      continue;
+    }
+
+    CPU_prepareStateBefore(self, type, lazyFlags);
+    if (InstructionType_isALU(type)) {
+      Register lhs;
+      Register rhs;
+      ALU_executeOperation(self->alu, type, CPU_getPackedOperand(self, instr, 0, &lhs),
+                           CPU_getPackedOperand(self, instr, 1, &rhs));
+      programCounter++;
+    } else if (type == IPU_RET) {
+      programCounter = self->packedCallDepth == 0 ? instructionCount : self->packedCallStack[--self->packedCallDepth];
+    } else if (InstructionType_isIPU(type)) {
+      U32 target = PackedInstruction_getBranchTarget(instr);
+      if (!IPU_isBranchTaken(self->flagRegister, type)) {
+        programCounter++;
+      } else if ((type == IPU_CALL && self->packedCallDepth == IPU_CALL_STACK_SIZE) || target > instructionCount) {
+        CPU_raiseFlag(self, FR_SEG_FLAG);
+        continue;
+      } else {
+        if (type == IPU_CALL) {
+          self->packedCallStack[self->packedCallDepth++] = programCounter + 1;
+        }
+        programCounter = target;
+      }
+    } else {
+      programCounter++;
+    }
+    steps++;
+  }
+
+  self->programCounter = programCounter;
+  if (pStats != NULL) {
+    pStats->result = result;
+    pStats->executedInstructionCount = steps;
+    pStats->programCounter = programCounter;
+  }
+  return result;
+}
@@ -0,0 +1,38 @@
+#ifndef EMBEDDED_SIM_FARM_H
+#define EMBEDDED_SIM_FARM_H
+
+#include <model/Instruction.h>
+#include <proc/Cpu.h>
+
+// Runs batches of independent packed programs (see getParserPackedProgram) on a pool of
+// worker threads. Each worker owns a CPU and ALU that are reset between jobs. Jobs are
+// split evenly between the workers up front; a worker that runs out steals half of the
+// remaining jobs of another one. Programs are only read, so jobs may share one.
+typedef struct Private_SimFarm * SimFarm;
+
+typedef struct {
+  PackedInstruction const * pInstructions;
+  U32 instructionCount;
+  U32 maxSteps;
+  Register dataRegisters[CPU_DATA_REGISTRY_LIST_SIZE];
+} SimJob;
+
+typedef struct {
+  Register dataRegisters[CPU_DATA_REGISTRY_LIST_SIZE];
+  Register flagRegister;
+  Register overflowRegister;
+  CpuRunStats stats;
+} SimJobResult;
+
+// A workerCount of 0 uses one worker per online host core. When the host cannot start that
+// many threads the farm keeps the workers that did start, as SimFarm_getWorkerCount reports,
+// and NULL is returned when none did.
+extern SimFarm SimFarm_ctor(U32 workerCount);
+extern void SimFarm_dtor(SimFarm self);
+
+extern U32 SimFarm_getWorkerCount(SimFarm self);
+
+// Runs every job and blocks until all results are written. pResults[i] belongs to pJobs[i].
+extern void SimFarm_run(SimFarm self, SimJob const * pJobs, U32 jobCount, SimJobResult * pResults);
+
+#endif // EMBEDDED_SIM_FARM_H
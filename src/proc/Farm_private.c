@@ -0,0 +1,220 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <threads.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+#include <proc/Farm.h>
+
+#define SIM_FARM_CACHE_LINE_SIZE 64u
+
+// A worker's pending jobs are the index range [begin, end), packed as begin << 32 | end so the
+// owner popping from the front and thieves taking from the back agree through a single CAS.
+typedef struct SimFarmWorker {
+  _Alignas(SIM_FARM_CACHE_LINE_SIZE) _Atomic U64 pending;
+  struct Private_SimFarm * farm;
+  U32 index;
+  thrd_t thread;
+  CPU cpu;
+  ALU alu;
+  Register overflowRegister;
+} SimFarmWorker;
+
+typedef struct Private_SimFarm {
+  U32 workerCount;
+  SimFarmWorker * workers;
+
+  mtx_t lock;
+  cnd_t started;
+  cnd_t finished;
+  U64 generation;
+  U32 busyWorkers;
+  bool stopping;
+
+  SimJob const * pJobs;
+  SimJobResult * pResults;
+} Private_SimFarm;
+
+static U64 SimFarm_makeRange(U32 begin, U32 end) { return (U64) begin << 32 | end; }
+
+static U32 SimFarm_rangeBegin(U64 range) { return (U32) (range >> 32); }
+
+static U32 SimFarm_rangeEnd(U64 range) { return (U32) range; }
+
+static bool SimFarm_pop(SimFarmWorker * worker, U32 * pJob) {
+  U64 range = atomic_load(&worker->pending);
+  while (SimFarm_rangeBegin(range) < SimFarm_rangeEnd(range)) {
+    U32 begin = SimFarm_rangeBegin(range);
+    if (atomic_compare_exchange_weak(&worker->pending, &range, SimFarm_makeRange(begin + 1, SimFarm_rangeEnd(range)))) {
+      *pJob = begin;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool SimFarm_steal(SimFarmWorker * thief) {
+  Private_SimFarm * farm = thief->farm;
+  for (U32 offset = 1; offset < farm->workerCount; offset++) {
+    SimFarmWorker * victim = &farm->workers[(thief->index + offset) % farm->workerCount];
+    U64 range = atomic_load(&victim->pending);
+    while (SimFarm_rangeBegin(range) < SimFarm_rangeEnd(range)) {
+      U32 begin = SimFarm_rangeBegin(range);
+      U32 end = SimFarm_rangeEnd(range);
+      U32 split = end - (end - begin + 1) / 2;
+      if (atomic_compare_exchange_weak(&victim->pending, &range, SimFarm_makeRange(begin, split))) {
+        atomic_store(&thief->pending, SimFarm_makeRange(split, end));
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+static void SimFarm_execute(SimFarmWorker * worker, SimJob const * job, SimJobResult * result) {
+  CPU cpu = worker->cpu;
+  CPU_reset(cpu);
+  for (U8 i = 0; i < CPU_DATA_REGISTRY_LIST_SIZE; i++) {
+    CPU_setDataRegister(cpu, i, job->dataRegisters[i]);
+  }
+  worker->overflowRegister = 0;
+
+  CPU_runPacked(cpu, job->pInstructions, job->instructionCount, job->maxSteps, &result->stats);
+  for (U8 i = 0; i < CPU_DATA_REGISTRY_LIST_SIZE; i++) {
+    result->dataRegisters[i] = CPU_getDataRegister(cpu, i);
+  }
+  result->flagRegister = CPU_getFlagRegister(cpu);
+  result->overflowRegister = worker->overflowRegister;
+}
+
+static void SimFarm_drain(SimFarmWorker * worker) {
+  Private_SimFarm * farm = worker->farm;
+  for (;;) {
+    U32 job;
+    if (SimFarm_pop(worker, &job)) {
+      SimFarm_execute(worker, &farm->pJobs[job], &farm->pResults[job]);
+    } else if (!SimFarm_steal(worker)) {
+      return;
+    }
+  }
+}
+
+static int SimFarm_workerMain(void * arg) {
+  SimFarmWorker * worker = (SimFarmWorker *) arg;
+  Private_SimFarm * farm = worker->farm;
+  U64 generation = 0;
+  for (;;) {
+    mtx_lock(&farm->lock);
+    while (!farm->stopping && farm->generation == generation) {
+      cnd_wait(&farm->started, &farm->lock);
+    }
+    if (farm->stopping) {
+      mtx_unlock(&farm->lock);
+      return 0;
+    }
+    generation = farm->generation;
+    mtx_unlock(&farm->lock);
+
+    SimFarm_drain(worker);
+
+    mtx_lock(&farm->lock);
+    if (--farm->busyWorkers == 0) {
+      cnd_signal(&farm->finished);
+    }
+    mtx_unlock(&farm->lock);
+  }
+}
+
+static U32 SimFarm_hostCoreCount() {
+#ifdef _SC_NPROCESSORS_ONLN
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  if (count > 0) {
+    return (U32) count;
+  }
+#endif
+  return 1;
+}
+
+Private_SimFarm * SimFarm_ctor(U32 workerCount) {
+  Private_SimFarm * farm = (Private_SimFarm *) malloc(sizeof(Private_SimFarm));
+  farm->workerCount = workerCount == 0 ? SimFarm_hostCoreCount() : workerCount;
+  farm->workers = (SimFarmWorker *) aligned_alloc(SIM_FARM_CACHE_LINE_SIZE, farm->workerCount * sizeof(SimFarmWorker));
+  mtx_init(&farm->lock, mtx_plain);
+  cnd_init(&farm->started);
+  cnd_init(&farm->finished);
+  farm->generation = 0;
+  farm->busyWorkers = 0;
+  farm->stopping = false;
+  farm->pJobs = NULL;
+  farm->pResults = NULL;
+
+  for (U32 i = 0; i < farm->workerCount; i++) {
+    SimFarmWorker * worker = &farm->workers[i];
+    atomic_init(&worker->pending, SimFarm_makeRange(0, 0));
+    worker->farm = farm;
+    worker->index = i;
+    worker->cpu = CPU_ctor();
+    worker->alu = ALU_ctor(CPU_getFlagRegisterAddress(worker->cpu), &worker->overflowRegister);
+    worker->overflowRegister = 0;
+    CPU_setALU(worker->cpu, worker->alu);
+    if (thrd_create(&worker->thread, SimFarm_workerMain, worker) != thrd_success) {
+      CPU_dtor(worker->cpu);
+      ALU_dtor(worker->alu);
+      farm->workerCount = i;
+      break;
+    }
+  }
+
+  if (farm->workerCount == 0) {
+    SimFarm_dtor(farm);
+    return NULL;
+  }
+  return farm;
+}
+
+void SimFarm_dtor(Private_SimFarm * self) {
+  mtx_lock(&self->lock);
+  self->stopping = true;
+  cnd_broadcast(&self->started);
+  mtx_unlock(&self->lock);
+
+  for (U32 i = 0; i < self->workerCount; i++) {
+    thrd_join(self->workers[i].thread, NULL);
+    CPU_dtor(self->workers[i].cpu);
+    ALU_dtor(self->workers[i].alu);
+  }
+  cnd_destroy(&self->finished);
+  cnd_destroy(&self->started);
+  mtx_destroy(&self->lock);
+  free(self->workers);
+  free(self);
+}
+
+U32 SimFarm_getWorkerCount(Private_SimFarm * self) { return self->workerCount; }
+
+void SimFarm_run(Private_SimFarm * self, SimJob const * pJobs, U32 jobCount, SimJobResult * pResults) {
+  assert(jobCount == 0 || (pJobs != NULL && pResults != NULL));
+  if (jobCount == 0) {
+    return;
+  }
+
+  for (U32 i = 0; i < self->workerCount; i++) {
+    U32 begin = (U32) ((U64) jobCount * i / self->workerCount);
+    U32 end = (U32) ((U64) jobCount * (i + 1) / self->workerCount);
+    atomic_store(&self->workers[i].pending, SimFarm_makeRange(begin, end));
+  }
+
+  mtx_lock(&self->lock);
+  self->pJobs = pJobs;
+  self->pResults = pResults;
+  self->busyWorkers = self->workerCount;
+  self->generation++;
+  cnd_broadcast(&self->started);
+  while (self->busyWorkers != 0) {
+    cnd_wait(&self->finished, &self->lock);
+  }
+  self->pJobs = NULL;
+  self->pResults = NULL;
+  mtx_unlock(&self->lock);
+}
@@ -0,0 +1,26 @@
+#ifndef EMBEDDED_SIM_INTERPRETER_H
+#define EMBEDDED_SIM_INTERPRETER_H
+
+#include <model/Instruction.h>
+#include <proc/Cpu.h>
+
+// Pre-decoded execution engine. The instruction array is translated once into a
+// direct-threaded stream (computed goto on GCC/Clang, switch dispatch elsewhere),
+// with branch targets linked to stream pointers. Interpreter_run follows the same
+// contract as CPU_run and yields the same register, flag and program counter values.
+// The call stack belongs to the interpreter, so a run interrupted inside a call must
+// be resumed with the same engine.
+//
+// Decoding fuses cmp followed by a conditional jump, and mov followed by add or sub, into
+// single superinstructions that skip the dead intermediate flag write. The fused
+// instruction count reports how many instructions were executed through them.
+typedef struct Private_Interpreter * Interpreter;
+
+extern Interpreter Interpreter_ctor(Instruction const * pInstructions, U32 instructionCount);
+extern void Interpreter_dtor(Interpreter self);
+
+extern U32 Interpreter_getInstructionCount(Interpreter self);
+extern U64 Interpreter_getFusedInstructionCount(Interpreter self);
+extern CpuRunResult Interpreter_run(Interpreter self, CPU cpu, U32 maxSteps, CpuRunStats * pStats);
+
+#endif // EMBEDDED_SIM_INTERPRETER_H
@@ -0,0 +1,489 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <proc/Interpreter.h>
+#include <proc/Ipu.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define INTERPRETER_THREADED_DISPATCH
+#endif
+
+typedef enum {
+  INTERPRETER_OP_END,
+  INTERPRETER_OP_CLEAR,
+  INTERPRETER_OP_ADD,
+  INTERPRETER_OP_SUB,
+  INTERPRETER_OP_MUL,
+  INTERPRETER_OP_DIV,
+  INTERPRETER_OP_AND,
+  INTERPRETER_OP_OR,
+  INTERPRETER_OP_XOR,
+  INTERPRETER_OP_NOT,
+  INTERPRETER_OP_SHL,
+  INTERPRETER_OP_SHR,
+  INTERPRETER_OP_CMP,
+  INTERPRETER_OP_JMP,
+  INTERPRETER_OP_JEQ,
+  INTERPRETER_OP_JNE,
+  INTERPRETER_OP_JLT,
+  INTERPRETER_OP_JLE,
+  INTERPRETER_OP_JGT,
+  INTERPRETER_OP_JGE,
+  INTERPRETER_OP_CALL,
+  INTERPRETER_OP_RET,
+  INTERPRETER_OP_ILLEGAL,
+  INTERPRETER_OP_CMP_JEQ,
+  INTERPRETER_OP_CMP_JNE,
+  INTERPRETER_OP_CMP_JLT,
+  INTERPRETER_OP_CMP_JLE,
+  INTERPRETER_OP_CMP_JGT,
+  INTERPRETER_OP_CMP_JGE,
+  INTERPRETER_OP_MOV_ADD,
+  INTERPRETER_OP_MOV_SUB,
+  INTERPRETER_OP_COUNT
+} InterpreterOp;
+
+typedef struct DecodedInstruction {
+  void const *handler;
+  Register *p0;
+  Register *p1;
+  struct DecodedInstruction const *target;
+  InterpreterOp op;
+} DecodedInstruction;
+
+typedef struct Private_Interpreter {
+  U32 instructionCount;
+  bool threaded;
+  U32 callDepth;
+  U64 fusedInstructionCount;
+  DecodedInstruction const *callStack[IPU_CALL_STACK_SIZE];
+  DecodedInstruction stream[];
+} Private_Interpreter;
+
+static InterpreterOp Interpreter_decodeOp(InstructionType type) {
+  switch (type) {
+    case ALU_ADD: return INTERPRETER_OP_ADD;
+    case ALU_SUB: return INTERPRETER_OP_SUB;
+    case ALU_MUL: return INTERPRETER_OP_MUL;
+    case ALU_DIV: return INTERPRETER_OP_DIV;
+    case ALU_AND: return INTERPRETER_OP_AND;
+    case ALU_OR:  return INTERPRETER_OP_OR;
+    case ALU_XOR: return INTERPRETER_OP_XOR;
+    case ALU_NOT: return INTERPRETER_OP_NOT;
+    case ALU_SHL: return INTERPRETER_OP_SHL;
+    case ALU_SHR: return INTERPRETER_OP_SHR;
+    case ALU_CMP: return INTERPRETER_OP_CMP;
+    case IPU_JMP: return INTERPRETER_OP_JMP;
+    case IPU_JEQ: return INTERPRETER_OP_JEQ;
+    case IPU_JNE: return INTERPRETER_OP_JNE;
+    case IPU_JLT: return INTERPRETER_OP_JLT;
+    case IPU_JLE: return INTERPRETER_OP_JLE;
+    case IPU_JGT: return INTERPRETER_OP_JGT;
+    case IPU_JGE: return INTERPRETER_OP_JGE;
+    case IPU_CALL: return INTERPRETER_OP_CALL;
+    case IPU_RET: return INTERPRETER_OP_RET;
+    case DEFAULT:
+    case MMU_MOV:
+    case MMU_PUSH:
+    case MMU_POP:
+      return INTERPRETER_OP_CLEAR;
+    default:
+      return INTERPRETER_OP_ILLEGAL;
+  }
+}
+
+// Superinstructions replace the first instruction of a pair only; the second keeps its own
+// decoded entry, so branches into the middle of a pair and runs resumed there stay exact.
+static InterpreterOp Interpreter_fuseOp(InstructionType first, InstructionType second) {
+  if (first == ALU_CMP && second >= IPU_JEQ && second <= IPU_JGE) {
+    return INTERPRETER_OP_CMP_JEQ + (second - IPU_JEQ);
+  }
+  if (first == MMU_MOV && second == ALU_ADD) {
+    return INTERPRETER_OP_MOV_ADD;
+  }
+  if (first == MMU_MOV && second == ALU_SUB) {
+    return INTERPRETER_OP_MOV_SUB;
+  }
+  return INTERPRETER_OP_COUNT;
+}
+
+Private_Interpreter *Interpreter_ctor(Instruction const *pInstructions, U32 instructionCount) {
+  assert(pInstructions != NULL || instructionCount == 0);
+  Private_Interpreter *interpreter = (Private_Interpreter *) malloc(
+          sizeof(Private_Interpreter) + (instructionCount + 1) * sizeof(DecodedInstruction));
+  interpreter->instructionCount = instructionCount;
+  interpreter->threaded = false;
+  interpreter->callDepth = 0;
+  interpreter->fusedInstructionCount = 0;
+
+  for (U32 i = 0; i < instructionCount; i++) {
+    Instruction instr = pInstructions[i];
+    assert(instr != NULL);
+    DecodedInstruction *decoded = &interpreter->stream[i];
+    decoded->handler = NULL;
+    decoded->p0 = Instruction_getParam1(instr);
+    decoded->p1 = Instruction_getParam2(instr);
+    decoded->target = NULL;
+    decoded->op = Interpreter_decodeOp(Instruction_getType(instr));
+    if (decoded->op >= INTERPRETER_OP_JMP && decoded->op <= INTERPRETER_OP_CALL && decoded->p0 != NULL
+        && Instruction_getBranchTarget(instr) <= instructionCount) {
+      decoded->target = &interpreter->stream[Instruction_getBranchTarget(instr)];
+    }
+    assert((!Instruction_isALU(instr)
+            || (decoded->p0 != NULL && (decoded->p1 != NULL || Instruction_getType(instr) == ALU_NOT))) &&
+           "ALU instruction without operands");
+  }
+
+  for (U32 i = 0; i + 1 < instructionCount; i++) {
+    InterpreterOp fused =
+            Interpreter_fuseOp(Instruction_getType(pInstructions[i]), Instruction_getType(pInstructions[i + 1]));
+    if (fused != INTERPRETER_OP_COUNT) {
+      interpreter->stream[i].op = fused;
+    }
+  }
+
+  DecodedInstruction *end = &interpreter->stream[instructionCount];
+  end->handler = NULL;
+  end->p0 = NULL;
+  end->p1 = NULL;
+  end->target = NULL;
+  end->op = INTERPRETER_OP_END;
+  return interpreter;
+}
+
+void Interpreter_dtor(Private_Interpreter *self) { free(self); }
+
+U32 Interpreter_getInstructionCount(Private_Interpreter *self) { return self->instructionCount; }
+
+U64 Interpreter_getFusedInstructionCount(Private_Interpreter *self) { return self->fusedInstructionCount; }
+
+#ifdef INTERPRETER_THREADED_DISPATCH
+static void Interpreter_thread(Private_Interpreter *self, void const *const *handlers) {
+  for (U32 i = 0; i <= self->instructionCount; i++) {
+    self->stream[i].handler = handlers[self->stream[i].op];
+  }
+  self->threaded = true;
+}
+
+#define HANDLER(_op) handler_##_op:
+#define DISPATCH() goto *ip->handler
+#else
+#define HANDLER(_op)                                                                                                   \
+  case _op:                                                                                                            \
+  handler_##_op:
+#define DISPATCH() continue
+#endif
+
+#define NEXT(_next)                                                                                                    \
+  ip = (_next);                                                                                                        \
+  if (++steps == maxSteps) {                                                                                           \
+    goto stop;                                                                                                         \
+  }                                                                                                                    \
+  DISPATCH()
+
+#define BRANCH(_taken)                                                                                                 \
+  if (!(_taken)) {                                                                                                     \
+    NEXT(ip + 1);                                                                                                      \
+  }                                                                                                                    \
+  if (ip->target == NULL) {                                                                                            \
+    *cpuFlags |= FR_SEG_FLAG;                                                                                          \
+    goto stop;                                                                                                         \
+  }                                                                                                                    \
+  NEXT(ip->target)
+
+// Compare fused with the conditional branch reading its result. With the ALU writing the
+// CPU flag register, the flags are stored once and the branch tests the computed value;
+// otherwise, or with a single step of budget left, only the compare is executed.
+#define CMP_BRANCH(_taken)                                                                                             \
+  U16 lhs = *ip->p0;                                                                                                   \
+  U16 rhs = *ip->p1;                                                                                                   \
+  Register flags = lhs == rhs ? FR_EQUAL_FLAG : lhs < rhs ? FR_LESS_FLAG : 0;                                          \
+  if (aluFlags != cpuFlags || maxSteps - steps < 2) {                                                                  \
+    *cpuFlags = 0;                                                                                                     \
+    *aluFlags |= flags;                                                                                                \
+    NEXT(ip + 1);                                                                                                      \
+  }                                                                                                                    \
+  *cpuFlags = flags;                                                                                                   \
+  ++ip;                                                                                                                \
+  ++steps;                                                                                                             \
+  fused += 2;                                                                                                          \
+  BRANCH(_taken)
+
+// The flag clear of the mov is dead, as the ALU instruction clears the flags again.
+#define MOV_ALU(_op)                                                                                                   \
+  if (maxSteps - steps < 2) {                                                                                          \
+    *cpuFlags = 0;                                                                                                     \
+    NEXT(ip + 1);                                                                                                      \
+  }                                                                                                                    \
+  ++ip;                                                                                                                \
+  ++steps;                                                                                                             \
+  fused += 2;                                                                                                          \
+  goto handler_##_op
+
+CpuRunResult Interpreter_run(Private_Interpreter *self, CPU cpu, U32 maxSteps, CpuRunStats *pStats) {
+  assert(self != NULL && cpu != NULL);
+  ALU alu = CPU_getALU(cpu);
+  assert(alu != NULL && "Interpreter requires an ALU attached to the CPU");
+
+  Register *cpuFlags = CPU_getFlagRegisterAddress(cpu);
+  Register *aluFlags = ALU_getFlagRegister(alu);
+  Register *overflow = ALU_getOverflowRegister(alu);
+  U32 programCounter = CPU_getProgramCounter(cpu);
+  DecodedInstruction const *ip =
+          &self->stream[programCounter < self->instructionCount ? programCounter : self->instructionCount];
+  U32 steps = 0;
+  U32 fused = 0;
+  CpuRunResult result;
+
+#ifdef INTERPRETER_THREADED_DISPATCH
+  static void const *const handlers[INTERPRETER_OP_COUNT] = {
+          [INTERPRETER_OP_END] = &&handler_INTERPRETER_OP_END,
+          [INTERPRETER_OP_CLEAR] = &&handler_INTERPRETER_OP_CLEAR,
+          [INTERPRETER_OP_ADD] = &&handler_INTERPRETER_OP_ADD,
+          [INTERPRETER_OP_SUB] = &&handler_INTERPRETER_OP_SUB,
+          [INTERPRETER_OP_MUL] = &&handler_INTERPRETER_OP_MUL,
+          [INTERPRETER_OP_DIV] = &&handler_INTERPRETER_OP_DIV,
+          [INTERPRETER_OP_AND] = &&handler_INTERPRETER_OP_AND,
+          [INTERPRETER_OP_OR] = &&handler_INTERPRETER_OP_OR,
+          [INTERPRETER_OP_XOR] = &&handler_INTERPRETER_OP_XOR,
+          [INTERPRETER_OP_NOT] = &&handler_INTERPRETER_OP_NOT,
+          [INTERPRETER_OP_SHL] = &&handler_INTERPRETER_OP_SHL,
+          [INTERPRETER_OP_SHR] = &&handler_INTERPRETER_OP_SHR,
+          [INTERPRETER_OP_CMP] = &&handler_INTERPRETER_OP_CMP,
+          [INTERPRETER_OP_JMP] = &&handler_INTERPRETER_OP_JMP,
+          [INTERPRETER_OP_JEQ] = &&handler_INTERPRETER_OP_JEQ,
+          [INTERPRETER_OP_JNE] = &&handler_INTERPRETER_OP_JNE,
+          [INTERPRETER_OP_JLT] = &&handler_INTERPRETER_OP_JLT,
+          [INTERPRETER_OP_JLE] = &&handler_INTERPRETER_OP_JLE,
+          [INTERPRETER_OP_JGT] = &&handler_INTERPRETER_OP_JGT,
+          [INTERPRETER_OP_JGE] = &&handler_INTERPRETER_OP_JGE,
+          [INTERPRETER_OP_CALL] = &&handler_INTERPRETER_OP_CALL,
+          [INTERPRETER_OP_RET] = &&handler_INTERPRETER_OP_RET,
+          [INTERPRETER_OP_ILLEGAL] = &&handler_INTERPRETER_OP_ILLEGAL,
+          [INTERPRETER_OP_CMP_JEQ] = &&handler_INTERPRETER_OP_CMP_JEQ,
+          [INTERPRETER_OP_CMP_JNE] = &&handler_INTERPRETER_OP_CMP_JNE,
+          [INTERPRETER_OP_CMP_JLT] = &&handler_INTERPRETER_OP_CMP_JLT,
+          [INTERPRETER_OP_CMP_JLE] = &&handler_INTERPRETER_OP_CMP_JLE,
+          [INTERPRETER_OP_CMP_JGT] = &&handler_INTERPRETER_OP_CMP_JGT,
+          [INTERPRETER_OP_CMP_JGE] = &&handler_INTERPRETER_OP_CMP_JGE,
+          [INTERPRETER_OP_MOV_ADD] = &&handler_INTERPRETER_OP_MOV_ADD,
+          [INTERPRETER_OP_MOV_SUB] = &&handler_INTERPRETER_OP_MOV_SUB,
+  };
+
+  if (!self->threaded) {
+    Interpreter_thread(self, handlers);
+  }
+#endif
+
+  if (Register_isSet(*cpuFlags, FR_FAULT_MASK) || maxSteps == 0) {
+    goto stop;
+  }
+
+#ifdef INTERPRETER_THREADED_DISPATCH
+  goto *ip->handler;
+#else
+  for (;;) {
+    switch (ip->op) {
+#endif
+
+  HANDLER(INTERPRETER_OP_CLEAR) {
+    *cpuFlags = 0;
+    NEXT(ip + 1);
+  }
+
+  HANDLER(INTERPRETER_OP_ADD) {
+    *cpuFlags = 0;
+    U32 result = (U32) *ip->p0 + (U32) *ip->p1;
+    *ip->p0 = result & 0xFFFFu;
+    NEXT(ip + 1);
+  }
+
+  HANDLER(INTERPRETER_OP_SUB) {
+    *cpuFlags = 0;
+    U32 result = (U32) *ip->p0 - (U32) *ip->p1;
+    *ip->p0 = result & 0xFFFFu;
+    *overflow = (result >> 16) & 0xFFFFu;
+    NEXT(ip + 1);
+  }
+
+  HANDLER(INTERPRETER_OP_MUL) {
+    *cpuFlags = 0;
+    U32 result = (U32) *ip->p0 * (U32) *ip->p1;
+    *ip->p0 = result & 0xFFFFu;
+    NEXT(ip + 1);
+  }
+
+  HANDLER(INTERPRETER_OP_DIV) {
+    *cpuFlags = 0;
+    U16 lhs = *ip->p0;
+    U16 rhs = *ip->p1;
+    if (rhs == 0) {
+      *aluFlags |= FR_DIV_ZERO_FLAG;
+    } else {
+      *ip->p0 = lhs / rhs;
+      *overflow = lhs % rhs;
+    }
+    NEXT(ip + 1);
+  }
+
+  HANDLER(INTERPRETER_OP_AND) {
+    *cpuFlags = 0;
+    U32 result = (U32) *ip->p0 & (U32) *ip->p1;
+    *ip->p0 = result & 0xFFFFu;
+    NEXT(ip + 1);
+  }
+
+  HANDLER(INTERPRETER_OP_OR) {
+    *cpuFlags = 0;
+    U32 result = (U32) *ip->p0 | (U32) *ip->p1;
+    *ip->p0 = result & 0xFFFFu;
+    NEXT(ip + 1);
+  }
+
+  HANDLER(INTERPRETER_OP_XOR) {
+    *cpuFlags = 0;
+    U32 result = (U32) *ip->p0 ^ (U32) *ip->p1;
+    *ip->p0 = result & 0xFFFFu;
+    NEXT(ip + 1);
+  }
+
+  HANDLER(INTERPRETER_OP_NOT) {
+    *cpuFlags = 0;
+    U32 result = (U32) ~*ip->p0;
+    *ip->p0 = result & 0xFFFFu;
+    NEXT(ip + 1);
+  }
+
+  HANDLER(INTERPRETER_OP_SHL) {
+    *cpuFlags = 0;
+    U32 result = (U32) *ip->p0 << (*ip->p1 & 31u);
+    *ip->p0 = result & 0xFFFFu;
+    NEXT(ip + 1);
+  }
+
+  HANDLER(INTERPRETER_OP_SHR) {
+    *cpuFlags = 0;
+    U32 result = (U32) *ip->p0 >> (*ip->p1 & 31u);
+    *ip->p0 = result & 0xFFFFu;
+    NEXT(ip + 1);
+  }
+
+  HANDLER(INTERPRETER_OP_CMP) {
+    *cpuFlags = 0;
+    U16 lhs = *ip->p0;
+    U16 rhs = *ip->p1;
+    if (lhs == rhs) {
+      *aluFlags |= FR_EQUAL_FLAG;
+    } else if (lhs < rhs) {
+      *aluFlags |= FR_LESS_FLAG;
+    }
+    NEXT(ip + 1);
+  }
+
+  HANDLER(INTERPRETER_OP_JMP) {
+    BRANCH(true);
+  }
+
+  HANDLER(INTERPRETER_OP_JEQ) {
+    BRANCH(Register_isSet(*cpuFlags, FR_EQUAL_FLAG));
+  }
+
+  HANDLER(INTERPRETER_OP_JNE) {
+    BRANCH(!Register_isSet(*cpuFlags, FR_EQUAL_FLAG));
+  }
+
+  HANDLER(INTERPRETER_OP_JLT) {
+    BRANCH(Register_isSet(*cpuFlags, FR_LESS_FLAG));
+  }
+
+  HANDLER(INTERPRETER_OP_JLE) {
+    BRANCH(Register_isSet(*cpuFlags, FR_LESS_FLAG | FR_EQUAL_FLAG));
+  }
+
+  HANDLER(INTERPRETER_OP_JGT) {
+    BRANCH(!Register_isSet(*cpuFlags, FR_LESS_FLAG | FR_EQUAL_FLAG));
+  }
+
+  HANDLER(INTERPRETER_OP_JGE) {
+    BRANCH(!Register_isSet(*cpuFlags, FR_LESS_FLAG));
+  }
+
+  HANDLER(INTERPRETER_OP_CALL) {
+    if (self->callDepth == IPU_CALL_STACK_SIZE || ip->target == NULL) {
+      *cpuFlags |= FR_SEG_FLAG;
+      goto stop;
+    }
+    self->callStack[self->callDepth++] = ip + 1;
+    NEXT(ip->target);
+  }
+
+  HANDLER(INTERPRETER_OP_RET) {
+    NEXT(self->callDepth == 0 ? &self->stream[self->instructionCount] : self->callStack[--self->callDepth]);
+  }
+
+  HANDLER(INTERPRETER_OP_ILLEGAL) {
+    *cpuFlags |= FR_ILLEGAL_FLAG;
+    goto stop;
+  }
+
+  HANDLER(INTERPRETER_OP_END) {
+    goto stop;
+  }
+
+  HANDLER(INTERPRETER_OP_CMP_JEQ) {
+    CMP_BRANCH(Register_isSet(flags, FR_EQUAL_FLAG));
+  }
+
+  HANDLER(INTERPRETER_OP_CMP_JNE) {
+    CMP_BRANCH(!Register_isSet(flags, FR_EQUAL_FLAG));
+  }
+
+  HANDLER(INTERPRETER_OP_CMP_JLT) {
+    CMP_BRANCH(Register_isSet(flags, FR_LESS_FLAG));
+  }
+
+  HANDLER(INTERPRETER_OP_CMP_JLE) {
+    CMP_BRANCH(Register_isSet(flags, FR_LESS_FLAG | FR_EQUAL_FLAG));
+  }
+
+  HANDLER(INTERPRETER_OP_CMP_JGT) {
+    CMP_BRANCH(!Register_isSet(flags, FR_LESS_FLAG | FR_EQUAL_FLAG));
+  }
+
+  HANDLER(INTERPRETER_OP_CMP_JGE) {
+    CMP_BRANCH(!Register_isSet(flags, FR_LESS_FLAG));
+  }
+
+  HANDLER(INTERPRETER_OP_MOV_ADD) {
+    MOV_ALU(INTERPRETER_OP_ADD);
+  }
+
+  HANDLER(INTERPRETER_OP_MOV_SUB) {
+    MOV_ALU(INTERPRETER_OP_SUB);
+  }
+
+#ifndef INTERPRETER_THREADED_DISPATCH
+      default:
+        assert(false && "Invalid decoded instruction.");
+        goto stop;
+    }
+  }
+#endif
+
+stop:
+  if (Register_isSet(*cpuFlags, FR_FAULT_MASK)) {
+    result = CPU_RUN_RESULT_FAULT;
+  } else if (ip->op == INTERPRETER_OP_END) {
+    result = CPU_RUN_RESULT_END_OF_PROGRAM;
+  } else {
+    result = CPU_RUN_RESULT_STEP_LIMIT;
+  }
+
+  self->fusedInstructionCount += fused;
+  CPU_setProgramCounter(cpu, ip - self->stream);
+  if (pStats != NULL) {
+    pStats->result = result;
+    pStats->executedInstructionCount = steps;
+    pStats->programCounter = ip - self->stream;
+  }
+  return result;
+}
@@ -5,4 +5,39 @@
 #ifndef EMBEDDED_SIM_IPU_H
 #define EMBEDDED_SIM_IPU_H
 
+#include <model/Instruction.h>
+#include <model/Register.h>
+
+#define IPU_CALL_STACK_SIZE (256)
+
+typedef struct Private_IPU * IPU;
+
+// Branch targets are read from the first operand of IPU_J* / IPU_CALL once, when the
+// program is loaded, and linked to direct instruction-stream pointers. A target outside
+// the program raises FR_SEG_FLAG when the branch is taken, as does a call stack overflow.
+// A ret with an empty call stack ends the program.
+extern IPU IPU_ctor(Register * flagRegister, Instruction const * pInstructions, U32 instructionCount);
+extern void IPU_dtor(IPU self);
+
+// Returns to the first instruction with an empty call stack.
+extern void IPU_reset(IPU self);
+extern Instruction IPU_fetch(IPU self);
+extern bool IPU_next(IPU self);
+
+extern U32 IPU_getProgramCounter(IPU self);
+extern void IPU_setProgramCounter(IPU self, U32 programCounter);
+
+// Whether an IPU_J* / IPU_CALL instruction is taken for the given flags.
+static inline bool IPU_isBranchTaken(Register flags, InstructionType type) {
+  switch (type) {
+    case IPU_JEQ: return Register_isSet(flags, FR_EQUAL_FLAG);
+    case IPU_JNE: return !Register_isSet(flags, FR_EQUAL_FLAG);
+    case IPU_JLT: return Register_isSet(flags, FR_LESS_FLAG);
+    case IPU_JLE: return Register_isSet(flags, FR_LESS_FLAG | FR_EQUAL_FLAG);
+    case IPU_JGT: return !Register_isSet(flags, FR_LESS_FLAG | FR_EQUAL_FLAG);
+    case IPU_JGE: return !Register_isSet(flags, FR_LESS_FLAG);
+    default: return true;
+  }
+}
+
 #endif // EMBEDDED_SIM_IPU_H
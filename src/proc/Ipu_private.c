@@ -2,13 +2,125 @@
 // Created by rosa on 11/5/24.
 //
 
-#include "model/Instruction.h"
-#include "model/Register.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <proc/Ipu.h>
+
+typedef struct IpuInstruction {
+  Instruction instruction;
+  InstructionType type;
+  struct IpuInstruction const *target;
+} IpuInstruction;
+
 typedef struct Private_IPU {
 
   Register *flagRegister;
-  Register* programCounter;
-  Instruction instructions[];
+  IpuInstruction const *programCounter;
+  U32 instructionCount;
+  U32 callDepth;
+  IpuInstruction const *callStack[IPU_CALL_STACK_SIZE];
+  IpuInstruction instructions[];
+
+} Private_IPU;
+
+static bool IPU_isBranch(InstructionType type) {
+  return type >= IPU_JMP && type <= IPU_CALL;
+}
+
+Private_IPU *IPU_ctor(Register *flagRegister, Instruction const *pInstructions, U32 instructionCount) {
+  assert(flagRegister != NULL);
+  assert(pInstructions != NULL || instructionCount == 0);
+  Private_IPU *ipu = (Private_IPU *) malloc(sizeof(Private_IPU) + (instructionCount + 1) * sizeof(IpuInstruction));
+  ipu->flagRegister = flagRegister;
+  ipu->programCounter = ipu->instructions;
+  ipu->instructionCount = instructionCount;
+  ipu->callDepth = 0;
+
+  for (U32 i = 0; i < instructionCount; i++) {
+    IpuInstruction *linked = &ipu->instructions[i];
+    linked->instruction = pInstructions[i];
+    linked->type = Instruction_getType(pInstructions[i]);
+    linked->target = NULL;
+
+    if (IPU_isBranch(linked->type) && Instruction_getParam1(pInstructions[i]) != NULL) {
+      U32 target = Instruction_getBranchTarget(pInstructions[i]);
+      if (target <= instructionCount) {
+        linked->target = &ipu->instructions[target];
+      }
+    }
+  }
+
+  IpuInstruction *end = &ipu->instructions[instructionCount];
+  end->instruction = NULL;
+  end->type = DEFAULT;
+  end->target = NULL;
+  return ipu;
+}
+
+void IPU_dtor(Private_IPU *self) { free(self); }
+
+void IPU_reset(Private_IPU *self) {
+  self->programCounter = self->instructions;
+  self->callDepth = 0;
+}
+
+Instruction IPU_fetch(Private_IPU *self) { return self->programCounter->instruction; }
+
+static bool IPU_branch(Private_IPU *self, bool taken) {
+  IpuInstruction const *pc = self->programCounter;
+  if (!taken) {
+    self->programCounter = pc + 1;
+    return true;
+  }
+
+  if (pc->target == NULL) {
+    *self->flagRegister |= FR_SEG_FLAG;
+    return false;
+  }
+
+  self->programCounter = pc->target;
+  return true;
+}
+
+bool IPU_next(Private_IPU *self) {
+  IpuInstruction const *pc = self->programCounter;
+  assert(pc->instruction != NULL && "IPU advanced past the end of the program");
+
+  switch (pc->type) {
+    case IPU_JMP:
+    case IPU_JEQ:
+    case IPU_JNE:
+    case IPU_JLT:
+    case IPU_JLE:
+    case IPU_JGT:
+    case IPU_JGE:
+      return IPU_branch(self, IPU_isBranchTaken(*self->flagRegister, pc->type));
+    case IPU_CALL:
+      if (self->callDepth == IPU_CALL_STACK_SIZE) {
+        *self->flagRegister |= FR_SEG_FLAG;
+        return false;
+      }
+      if (!IPU_branch(self, true)) {
+        return false;
+      }
+      self->callStack[self->callDepth++] = pc + 1;
+      return true;
+    case IPU_RET:
+      self->programCounter = self->callDepth == 0
+          ? &self->instructions[self->instructionCount]
+          : self->callStack[--self->callDepth];
+      return true;
+    default:
+      self->programCounter = pc + 1;
+      return true;
+  }
+}
 
+U32 IPU_getProgramCounter(Private_IPU *self) { return self->programCounter - self->instructions; }
 
-} Private_IPU;
\ No newline at end of file
+void IPU_setProgramCounter(Private_IPU *self, U32 programCounter) {
+  if (programCounter > self->instructionCount) {
+    programCounter = self->instructionCount;
+  }
+  self->programCounter = &self->instructions[programCounter];
+}
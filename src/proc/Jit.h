@@ -0,0 +1,25 @@
+#ifndef EMBEDDED_SIM_JIT_H
+#define EMBEDDED_SIM_JIT_H
+
+#include <model/Instruction.h>
+#include <proc/Cpu.h>
+
+// Basic-block compiler to x86-64. Blocks start at branch targets and after control
+// transfers. Their code keeps the CPU's data registers in host registers and jumps
+// directly to successor blocks. Calls, returns, branches to targets outside the program
+// and unknown instructions are left to CPU_run. The code is bound to the CPU, which JIT_ctor
+// loads the program into (see CPU_loadProgram), and to the ALU attached to it when the JIT
+// is created. Compiled code computes flags eagerly; a lazy ALU only defers them within the
+// instructions left to CPU_run.
+//
+// JIT_ctor returns NULL when the host is not x86-64 or when the ALU's flag or overflow
+// register is one of the CPU's data registers; callers should use CPU_run instead.
+typedef struct Private_JIT * JIT;
+
+extern JIT JIT_ctor(CPU cpu, Instruction const * pInstructions, U32 instructionCount);
+extern void JIT_dtor(JIT self);
+
+extern U32 JIT_getCompiledBlockCount(JIT self);
+extern CpuRunResult JIT_run(JIT self, U32 maxSteps, CpuRunStats * pStats);
+
+#endif // EMBEDDED_SIM_JIT_H
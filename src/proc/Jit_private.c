@@ -0,0 +1,559 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <proc/Jit.h>
+
+#if defined(__x86_64__) && defined(__unix__)
+#define JIT_X86_64
+#include <sys/mman.h>
+#endif
+
+typedef struct {
+  U32 remaining;
+  U32 reserved;
+  Register *dataRegisters;
+  Register *cpuFlags;
+  Register *aluFlags;
+  Register *overflow;
+  void const *entry;
+} JitContext;
+
+_Static_assert(offsetof(JitContext, remaining) == 0, "JIT code addresses the context by offset");
+_Static_assert(offsetof(JitContext, dataRegisters) == 8, "JIT code addresses the context by offset");
+_Static_assert(offsetof(JitContext, cpuFlags) == 16, "JIT code addresses the context by offset");
+_Static_assert(offsetof(JitContext, aluFlags) == 24, "JIT code addresses the context by offset");
+_Static_assert(offsetof(JitContext, overflow) == 32, "JIT code addresses the context by offset");
+_Static_assert(offsetof(JitContext, entry) == 40, "JIT code addresses the context by offset");
+
+typedef U32 (*JitEntry)(JitContext *ctx);
+
+typedef struct Private_JIT {
+  CPU cpu;
+  U32 instructionCount;
+  U32 blockCount;
+  U8 *code;
+  size_t codeSize;
+  JitEntry entry;
+  void const *blockEntries[];
+} Private_JIT;
+
+U32 JIT_getCompiledBlockCount(Private_JIT *self) { return self->blockCount; }
+
+CpuRunResult JIT_run(Private_JIT *self, U32 maxSteps, CpuRunStats *pStats) {
+  assert(self != NULL);
+  CPU cpu = self->cpu;
+  ALU alu = CPU_getALU(cpu);
+  JitContext ctx = {
+          .remaining = 0,
+          .reserved = 0,
+          .dataRegisters = CPU_getDataRegisters(cpu),
+          .cpuFlags = CPU_getFlagRegisterAddress(cpu),
+          .aluFlags = ALU_getFlagRegister(alu),
+          .overflow = ALU_getOverflowRegister(alu),
+          .entry = NULL,
+  };
+
+  CpuRunResult result;
+  U32 steps = 0;
+  for (;;) {
+    if (Register_isSet(*ctx.cpuFlags, FR_FAULT_MASK)) {
+      result = CPU_RUN_RESULT_FAULT;
+      break;
+    }
+
+    U32 programCounter = CPU_getProgramCounter(cpu);
+    if (programCounter >= self->instructionCount) {
+      CPU_setProgramCounter(cpu, self->instructionCount);
+      result = CPU_RUN_RESULT_END_OF_PROGRAM;
+      break;
+    }
+    if (steps == maxSteps) {
+      result = CPU_RUN_RESULT_STEP_LIMIT;
+      break;
+    }
+
+    if (self->blockEntries[programCounter] != NULL) {
+      ctx.remaining = maxSteps - steps;
+      ctx.entry = self->blockEntries[programCounter];
+      U32 exitProgramCounter = self->entry(&ctx);
+      U32 executed = (maxSteps - steps) - ctx.remaining;
+      CPU_setProgramCounter(cpu, exitProgramCounter);
+      steps += executed;
+      if (executed != 0) {
+        continue;
+      }
+    }
+
+    CpuRunStats stepStats;
+    CPU_run(cpu, 1, &stepStats);
+    steps += stepStats.executedInstructionCount;
+    // Compiled code writes the flag registers directly, so nothing may stay pending in a lazy ALU.
+    ALU_materializeFlags(alu);
+  }
+
+  if (pStats != NULL) {
+    pStats->result = result;
+    pStats->executedInstructionCount = steps;
+    pStats->programCounter = CPU_getProgramCounter(cpu);
+  }
+  return result;
+}
+
+#ifdef JIT_X86_64
+
+typedef struct {
+  U8 *bytes;
+  size_t size;
+  size_t capacity;
+} JitBuffer;
+
+typedef struct {
+  size_t at;
+  U32 target;
+} JitFixup;
+
+typedef struct {
+  JitBuffer buffer;
+  Instruction const *pInstructions;
+  U32 instructionCount;
+  Register const *dataRegisters;
+  bool *leaders;
+  size_t *blockOffsets;
+  JitFixup *fixups;
+  U32 fixupCount;
+  size_t commonExit;
+} JitCompiler;
+
+#define JIT_GUEST_REGISTER_COUNT CPU_DATA_REGISTRY_LIST_SIZE
+_Static_assert(JIT_GUEST_REGISTER_COUNT == 8, "Guest registers are mapped onto r8-r15");
+
+static void JitBuffer_emit(JitBuffer *buffer, U8 const *bytes, size_t count) {
+  if (buffer->size + count > buffer->capacity) {
+    buffer->capacity = (buffer->capacity + count) * 2;
+    buffer->bytes = (U8 *) realloc(buffer->bytes, buffer->capacity);
+  }
+  memcpy(buffer->bytes + buffer->size, bytes, count);
+  buffer->size += count;
+}
+
+#define EMIT(_compiler, ...)                                                                                           \
+  do {                                                                                                                 \
+    U8 const _bytes[] = {__VA_ARGS__};                                                                                 \
+    JitBuffer_emit(&(_compiler)->buffer, _bytes, sizeof(_bytes));                                                      \
+  } while (0)
+
+static void JIT_emit32(JitCompiler *c, U32 value) {
+  EMIT(c, value & 0xFF, (value >> 8) & 0xFF, (value >> 16) & 0xFF, (value >> 24) & 0xFF);
+}
+
+static void JIT_emit64(JitCompiler *c, U64 value) {
+  JIT_emit32(c, (U32) value);
+  JIT_emit32(c, (U32) (value >> 32));
+}
+
+static size_t JIT_emitRel32(JitCompiler *c) {
+  size_t at = c->buffer.size;
+  JIT_emit32(c, 0);
+  return at;
+}
+
+static void JIT_patchRel32(JitCompiler *c, size_t at, size_t target) {
+  U32 rel = (U32) (target - (at + 4));
+  memcpy(c->buffer.bytes + at, &rel, sizeof(rel));
+}
+
+static void JIT_jumpToExit(JitCompiler *c, U32 programCounter) {
+  EMIT(c, 0xB8); // mov eax, imm32
+  JIT_emit32(c, programCounter);
+  EMIT(c, 0xE9); // jmp rel32
+  JIT_patchRel32(c, JIT_emitRel32(c), c->commonExit);
+}
+
+static void JIT_addFixup(JitCompiler *c, size_t at, U32 target) {
+  c->fixups[c->fixupCount].at = at;
+  c->fixups[c->fixupCount].target = target;
+  c->fixupCount++;
+}
+
+static void JIT_jumpTo(JitCompiler *c, U32 programCounter, U32 nextBlock) {
+  if (programCounter >= c->instructionCount || !c->leaders[programCounter]) {
+    JIT_jumpToExit(c, programCounter);
+    return;
+  }
+  if (programCounter == nextBlock) {
+    return;
+  }
+  EMIT(c, 0xE9); // jmp rel32
+  JIT_addFixup(c, JIT_emitRel32(c), programCounter);
+}
+
+static int JIT_registerIndex(JitCompiler const *c, Register const *operand) {
+  if (operand >= c->dataRegisters && operand < c->dataRegisters + JIT_GUEST_REGISTER_COUNT) {
+    return (int) (operand - c->dataRegisters);
+  }
+  return -1;
+}
+
+// eax <- lhs (address kept in rbp for memory operands), ecx <- rhs unless it is NULL
+static void JIT_loadOperands(JitCompiler *c, Register *lhs, Register *rhs) {
+  int lhsIndex = JIT_registerIndex(c, lhs);
+  if (lhsIndex >= 0) {
+    EMIT(c, 0x41, 0x0F, 0xB7, 0xC0 | lhsIndex); // movzx eax, r(8+i)w
+  } else {
+    EMIT(c, 0x48, 0xBD); // movabs rbp, imm64
+    JIT_emit64(c, (U64) (size_t) lhs);
+    EMIT(c, 0x0F, 0xB7, 0x45, 0x00); // movzx eax, word [rbp]
+  }
+
+  if (rhs == NULL) {
+    return;
+  }
+  int rhsIndex = JIT_registerIndex(c, rhs);
+  if (rhsIndex >= 0) {
+    EMIT(c, 0x41, 0x0F, 0xB7, 0xC8 | rhsIndex); // movzx ecx, r(8+i)w
+  } else {
+    EMIT(c, 0x48, 0xBA); // movabs rdx, imm64
+    JIT_emit64(c, (U64) (size_t) rhs);
+    EMIT(c, 0x0F, 0xB7, 0x0A); // movzx ecx, word [rdx]
+  }
+}
+
+static void JIT_storeResult(JitCompiler *c, Register *lhs) {
+  int lhsIndex = JIT_registerIndex(c, lhs);
+  if (lhsIndex >= 0) {
+    EMIT(c, 0x66, 0x41, 0x89, 0xC0 | lhsIndex); // mov r(8+i)w, ax
+  } else {
+    EMIT(c, 0x66, 0x89, 0x45, 0x00); // mov word [rbp], ax
+  }
+}
+
+static void JIT_storeOverflow(JitCompiler *c) {
+  EMIT(c, 0x48, 0x8B, 0x53, 0x20); // mov rdx, [rbx + overflow]
+  EMIT(c, 0x66, 0x89, 0x02);       // mov word [rdx], ax
+}
+
+static void JIT_clearCpuFlags(JitCompiler *c) {
+  EMIT(c, 0x66, 0xC7, 0x06, 0x00, 0x00); // mov word [rsi], 0
+}
+
+static bool JIT_isStraightLine(Instruction instr) {
+  InstructionType type = Instruction_getType(instr);
+  if (type == DEFAULT || (type >= MMU_MOV && type <= MMU_POP)) {
+    return true;
+  }
+  return Instruction_isALU(instr) && Instruction_getParam1(instr) != NULL
+      && (Instruction_getParam2(instr) != NULL || type == ALU_NOT);
+}
+
+static bool JIT_isBranch(JitCompiler const *c, Instruction instr) {
+  InstructionType type = Instruction_getType(instr);
+  return type >= IPU_JMP && type <= IPU_JGE && Instruction_getParam1(instr) != NULL
+      && Instruction_getBranchTarget(instr) <= c->instructionCount;
+}
+
+static void JIT_compileStraightLine(JitCompiler *c, Instruction instr) {
+  InstructionType type = Instruction_getType(instr);
+  Register *lhs = Instruction_getParam1(instr);
+  Register *rhs = Instruction_getParam2(instr);
+
+  JIT_clearCpuFlags(c);
+  if (!Instruction_isALU(instr)) {
+    return;
+  }
+
+  JIT_loadOperands(c, lhs, rhs);
+  switch (type) {
+    case ALU_ADD:
+      EMIT(c, 0x01, 0xC8); // add eax, ecx
+      JIT_storeResult(c, lhs);
+      break;
+    case ALU_SUB:
+      EMIT(c, 0x29, 0xC8); // sub eax, ecx
+      JIT_storeResult(c, lhs);
+      EMIT(c, 0xC1, 0xE8, 0x10); // shr eax, 16
+      JIT_storeOverflow(c);
+      break;
+    case ALU_MUL:
+      EMIT(c, 0x0F, 0xAF, 0xC1); // imul eax, ecx
+      JIT_storeResult(c, lhs);
+      break;
+    case ALU_AND:
+      EMIT(c, 0x21, 0xC8); // and eax, ecx
+      JIT_storeResult(c, lhs);
+      break;
+    case ALU_OR:
+      EMIT(c, 0x09, 0xC8); // or eax, ecx
+      JIT_storeResult(c, lhs);
+      break;
+    case ALU_XOR:
+      EMIT(c, 0x31, 0xC8); // xor eax, ecx
+      JIT_storeResult(c, lhs);
+      break;
+    case ALU_NOT:
+      EMIT(c, 0xF7, 0xD0); // not eax
+      JIT_storeResult(c, lhs);
+      break;
+    case ALU_SHL:
+      EMIT(c, 0xD3, 0xE0); // shl eax, cl (count modulo 32)
+      JIT_storeResult(c, lhs);
+      break;
+    case ALU_SHR:
+      EMIT(c, 0xD3, 0xE8); // shr eax, cl (count modulo 32)
+      JIT_storeResult(c, lhs);
+      break;
+    case ALU_DIV: {
+      EMIT(c, 0x85, 0xC9);       // test ecx, ecx
+      EMIT(c, 0x0F, 0x85);       // jnz nonZero
+      size_t nonZero = JIT_emitRel32(c);
+      EMIT(c, 0x66, 0x83, 0x0F, FR_DIV_ZERO_FLAG); // or word [rdi], FR_DIV_ZERO_FLAG
+      EMIT(c, 0xE9);             // jmp done
+      size_t done = JIT_emitRel32(c);
+      JIT_patchRel32(c, nonZero, c->buffer.size);
+      EMIT(c, 0x31, 0xD2);       // xor edx, edx
+      EMIT(c, 0xF7, 0xF1);       // div ecx
+      JIT_storeResult(c, lhs);
+      EMIT(c, 0x89, 0xD0);       // mov eax, edx
+      JIT_storeOverflow(c);
+      JIT_patchRel32(c, done, c->buffer.size);
+      break;
+    }
+    case ALU_CMP: {
+      EMIT(c, 0x39, 0xC8);       // cmp eax, ecx
+      EMIT(c, 0x0F, 0x85);       // jne notEqual
+      size_t notEqual = JIT_emitRel32(c);
+      EMIT(c, 0x66, 0x83, 0x0F, FR_EQUAL_FLAG); // or word [rdi], FR_EQUAL_FLAG
+      EMIT(c, 0xE9);             // jmp done
+      size_t done = JIT_emitRel32(c);
+      JIT_patchRel32(c, notEqual, c->buffer.size);
+      EMIT(c, 0x0F, 0x83);       // jae done
+      size_t notLess = JIT_emitRel32(c);
+      EMIT(c, 0x66, 0x83, 0x0F, FR_LESS_FLAG); // or word [rdi], FR_LESS_FLAG
+      JIT_patchRel32(c, done, c->buffer.size);
+      JIT_patchRel32(c, notLess, c->buffer.size);
+      break;
+    }
+    default:
+      assert(false && "Unhandled straight-line instruction");
+  }
+}
+
+// Emits the test of the flag register and returns the jcc opcode taken when the branch is taken.
+static U8 JIT_compileCondition(JitCompiler *c, InstructionType type) {
+  U32 mask;
+  U8 takenIfSet;
+  switch (type) {
+    case IPU_JEQ: mask = FR_EQUAL_FLAG; takenIfSet = 1; break;
+    case IPU_JNE: mask = FR_EQUAL_FLAG; takenIfSet = 0; break;
+    case IPU_JLT: mask = FR_LESS_FLAG; takenIfSet = 1; break;
+    case IPU_JLE: mask = FR_LESS_FLAG | FR_EQUAL_FLAG; takenIfSet = 1; break;
+    case IPU_JGT: mask = FR_LESS_FLAG | FR_EQUAL_FLAG; takenIfSet = 0; break;
+    case IPU_JGE: mask = FR_LESS_FLAG; takenIfSet = 0; break;
+    default:
+      assert(false && "Unconditional branch has no condition");
+      return 0;
+  }
+
+  EMIT(c, 0x0F, 0xB7, 0x06); // movzx eax, word [rsi]
+  EMIT(c, 0xA9);             // test eax, imm32
+  JIT_emit32(c, mask);
+  return takenIfSet ? 0x85 : 0x84; // jnz : jz
+}
+
+static void JIT_compileBlock(JitCompiler *c, U32 leader, U32 nextBlock, U32 *pLength) {
+  U32 end = leader;
+  while (end < c->instructionCount && (end == leader || !c->leaders[end])
+         && JIT_isStraightLine(c->pInstructions[end])) {
+    end++;
+  }
+
+  bool branch = end < c->instructionCount && (end == leader || !c->leaders[end])
+                && JIT_isBranch(c, c->pInstructions[end]);
+  U32 length = end - leader + (branch ? 1 : 0);
+  *pLength = length;
+
+  if (length == 0) {
+    c->blockOffsets[leader] = c->buffer.size;
+    JIT_jumpToExit(c, leader);
+    return;
+  }
+
+  JIT_jumpToExit(c, leader);
+  size_t budgetExit = c->buffer.size - 10;
+  c->blockOffsets[leader] = c->buffer.size;
+
+  EMIT(c, 0x81, 0x3B); // cmp dword [rbx], imm32
+  JIT_emit32(c, length);
+  EMIT(c, 0x0F, 0x82); // jb budgetExit
+  JIT_patchRel32(c, JIT_emitRel32(c), budgetExit);
+  EMIT(c, 0x81, 0x2B); // sub dword [rbx], imm32
+  JIT_emit32(c, length);
+
+  for (U32 pc = leader; pc < end; pc++) {
+    JIT_compileStraightLine(c, c->pInstructions[pc]);
+  }
+
+  if (!branch) {
+    JIT_jumpTo(c, end, nextBlock);
+    return;
+  }
+
+  Instruction instr = c->pInstructions[end];
+  InstructionType type = Instruction_getType(instr);
+  U32 target = Instruction_getBranchTarget(instr);
+  if (type == IPU_JMP) {
+    JIT_jumpTo(c, target, nextBlock);
+    return;
+  }
+
+  U8 taken = JIT_compileCondition(c, type);
+  if (target < c->instructionCount && c->leaders[target]) {
+    EMIT(c, 0x0F, taken); // jcc target
+    JIT_addFixup(c, JIT_emitRel32(c), target);
+  } else {
+    EMIT(c, 0x0F, taken ^ 0x01); // inverted jcc over the exit
+    size_t skip = JIT_emitRel32(c);
+    JIT_jumpToExit(c, target);
+    JIT_patchRel32(c, skip, c->buffer.size);
+  }
+  JIT_jumpTo(c, end + 1, nextBlock);
+}
+
+static void JIT_findLeaders(JitCompiler *c) {
+  if (c->instructionCount > 0) {
+    c->leaders[0] = true;
+  }
+
+  for (U32 pc = 0; pc < c->instructionCount; pc++) {
+    Instruction instr = c->pInstructions[pc];
+    if (JIT_isStraightLine(instr)) {
+      continue;
+    }
+    if (pc + 1 < c->instructionCount) {
+      c->leaders[pc + 1] = true;
+    }
+    if (JIT_isBranch(c, instr) && Instruction_getBranchTarget(instr) < c->instructionCount) {
+      c->leaders[Instruction_getBranchTarget(instr)] = true;
+    }
+  }
+}
+
+static void JIT_compilePrologue(JitCompiler *c) {
+  EMIT(c, 0x53, 0x55, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57); // push rbx, rbp, r12-r15
+  EMIT(c, 0x48, 0x89, 0xFB);       // mov rbx, rdi
+  EMIT(c, 0x48, 0x8B, 0x6B, 0x08); // mov rbp, [rbx + dataRegisters]
+  for (U8 i = 0; i < JIT_GUEST_REGISTER_COUNT; i++) {
+    EMIT(c, 0x44, 0x0F, 0xB7, 0x45 | (i << 3), i * 2); // movzx r(8+i)d, word [rbp + 2i]
+  }
+  EMIT(c, 0x48, 0x8B, 0x73, 0x10); // mov rsi, [rbx + cpuFlags]
+  EMIT(c, 0x48, 0x8B, 0x7B, 0x18); // mov rdi, [rbx + aluFlags]
+  EMIT(c, 0xFF, 0x63, 0x28);       // jmp [rbx + entry]
+
+  c->commonExit = c->buffer.size;
+  EMIT(c, 0x48, 0x8B, 0x6B, 0x08); // mov rbp, [rbx + dataRegisters]
+  for (U8 i = 0; i < JIT_GUEST_REGISTER_COUNT; i++) {
+    EMIT(c, 0x66, 0x44, 0x89, 0x45 | (i << 3), i * 2); // mov word [rbp + 2i], r(8+i)w
+  }
+  EMIT(c, 0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5D, 0x5B); // pop r15-r12, rbp, rbx
+  EMIT(c, 0xC3);                                                         // ret
+}
+
+Private_JIT *JIT_ctor(CPU cpu, Instruction const *pInstructions, U32 instructionCount) {
+  assert(cpu != NULL);
+  assert(pInstructions != NULL || instructionCount == 0);
+  ALU alu = CPU_getALU(cpu);
+  assert(alu != NULL && "JIT requires an ALU attached to the CPU");
+
+  Register const *dataRegisters = CPU_getDataRegisters(cpu);
+  Register const *aluFlags = ALU_getFlagRegister(alu);
+  Register const *overflow = ALU_getOverflowRegister(alu);
+  if ((aluFlags >= dataRegisters && aluFlags < dataRegisters + JIT_GUEST_REGISTER_COUNT)
+      || (overflow >= dataRegisters && overflow < dataRegisters + JIT_GUEST_REGISTER_COUNT)) {
+    return NULL;
+  }
+
+  JitCompiler c = {
+          .buffer = {.bytes = NULL, .size = 0, .capacity = 0},
+          .pInstructions = pInstructions,
+          .instructionCount = instructionCount,
+          .dataRegisters = dataRegisters,
+          .leaders = (bool *) calloc(instructionCount + 1, sizeof(bool)),
+          .blockOffsets = (size_t *) calloc(instructionCount + 1, sizeof(size_t)),
+          .fixups = (JitFixup *) malloc((2 * instructionCount + 1) * sizeof(JitFixup)),
+          .fixupCount = 0,
+          .commonExit = 0,
+  };
+  U32 *blockLengths = (U32 *) calloc(instructionCount + 1, sizeof(U32));
+
+  JIT_findLeaders(&c);
+  JIT_compilePrologue(&c);
+
+  U32 blockCount = 0;
+  for (U32 pc = 0; pc < instructionCount; pc++) {
+    if (!c.leaders[pc]) {
+      continue;
+    }
+    U32 nextBlock = pc + 1;
+    while (nextBlock < instructionCount && !c.leaders[nextBlock]) {
+      nextBlock++;
+    }
+    JIT_compileBlock(&c, pc, nextBlock, &blockLengths[pc]);
+    if (blockLengths[pc] != 0) {
+      blockCount++;
+    }
+  }
+
+  for (U32 i = 0; i < c.fixupCount; i++) {
+    JIT_patchRel32(&c, c.fixups[i].at, c.blockOffsets[c.fixups[i].target]);
+  }
+
+  size_t codeSize = c.buffer.size;
+  U8 *code = (U8 *) mmap(NULL, codeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  Private_JIT *jit = NULL;
+  if (code != MAP_FAILED) {
+    memcpy(code, c.buffer.bytes, codeSize);
+    if (mprotect(code, codeSize, PROT_READ | PROT_EXEC) == 0) {
+      jit = (Private_JIT *) malloc(sizeof(Private_JIT) + (instructionCount + 1) * sizeof(void const *));
+      jit->cpu = cpu;
+      jit->instructionCount = instructionCount;
+      jit->blockCount = blockCount;
+      jit->code = code;
+      jit->codeSize = codeSize;
+      memcpy(&jit->entry, &code, sizeof(jit->entry));
+      for (U32 pc = 0; pc <= instructionCount; pc++) {
+        jit->blockEntries[pc] = blockLengths[pc] != 0 ? code + c.blockOffsets[pc] : NULL;
+      }
+      CPU_loadProgram(cpu, pInstructions, instructionCount);
+    } else {
+      munmap(code, codeSize);
+    }
+  }
+
+  free(blockLengths);
+  free(c.fixups);
+  free(c.blockOffsets);
+  free(c.leaders);
+  free(c.buffer.bytes);
+  return jit;
+}
+
+void JIT_dtor(Private_JIT *self) {
+  if (self == NULL) {
+    return;
+  }
+  munmap(self->code, self->codeSize);
+  free(self);
+}
+
+#else
+
+Private_JIT *JIT_ctor(CPU cpu, Instruction const *pInstructions, U32 instructionCount) {
+  (void) cpu;
+  (void) pInstructions;
+  (void) instructionCount;
+  return NULL;
+}
+
+void JIT_dtor(Private_JIT *self) { assert(self == NULL); }
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef EMBEDDED_SIM_KERNEL_H
+#define EMBEDDED_SIM_KERNEL_H
+
+#include <proc/Cpu.h>
+#include <proc/Ipu.h>
+
+// Program compiled ahead of time to C by translateParserProgram. The run function follows
+// the same contract as CPU_run for the program it was generated from, reading and writing
+// the CPU's data registers, flag register and program counter and the attached ALU's flag
+// and overflow registers. The call stack is kept by the caller, so a run interrupted inside
+// a call resumes with the same KernelCallStack.
+typedef struct {
+  U32 callDepth;
+  U32 returnAddresses[IPU_CALL_STACK_SIZE];
+} KernelCallStack;
+
+typedef CpuRunResult (*KernelRunFunction)(CPU cpu, KernelCallStack * pCallStack, U32 maxSteps, CpuRunStats * pStats);
+
+typedef struct {
+  char const * pName;
+  U32 instructionCount;
+  KernelRunFunction run;
+} Kernel;
+
+#endif // EMBEDDED_SIM_KERNEL_H
@@ -0,0 +1,39 @@
+#ifndef EMBEDDED_SIM_LOCKSTEP_H
+#define EMBEDDED_SIM_LOCKSTEP_H
+
+#include <model/Instruction.h>
+#include <proc/Cpu.h>
+#include <proc/Ipu.h>
+
+// Runs one packed program on LOCKSTEP_LANE_COUNT register files at once. Registers are kept
+// as structure of arrays, one array per guest register with one element per lane, so each
+// ALU instruction is applied to all lanes through vector kernels (GCC/Clang vector
+// extensions, plain loops elsewhere).
+//
+// Lanes have their own program counters. Every step executes the lowest pending program
+// counter on the lanes that are at it and masks out the others, so lanes that diverge on a
+// branch reconverge once they reach the same instruction again. Each lane follows the
+// CPU_runPacked contract and may be resumed from the state it was left in.
+#define LOCKSTEP_LANE_COUNT 16u
+
+typedef struct {
+  Register dataRegisters[CPU_DATA_REGISTRY_LIST_SIZE][LOCKSTEP_LANE_COUNT];
+  Register flagRegister[LOCKSTEP_LANE_COUNT];
+  Register overflowRegister[LOCKSTEP_LANE_COUNT];
+  U32 programCounter[LOCKSTEP_LANE_COUNT];
+  U32 callDepth[LOCKSTEP_LANE_COUNT];
+  U32 callStack[IPU_CALL_STACK_SIZE][LOCKSTEP_LANE_COUNT];
+} LockstepState;
+
+// Only the first laneCount lanes are run. maxSteps applies to each lane. pStats may be NULL
+// or point to LOCKSTEP_LANE_COUNT elements, of which the first laneCount are written.
+extern void Lockstep_run(
+    PackedInstruction const * pInstructions,
+    U32 instructionCount,
+    U32 laneCount,
+    U32 maxSteps,
+    LockstepState * pState,
+    CpuRunStats * pStats
+);
+
+#endif // EMBEDDED_SIM_LOCKSTEP_H
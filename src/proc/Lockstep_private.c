@@ -0,0 +1,287 @@
+#include <assert.h>
+#include <string.h>
+#include <proc/Lockstep.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LOCKSTEP_VECTOR_EXTENSIONS
+// The lane helpers are all static, so the vector calling convention never crosses this file.
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+// One guest register across all lanes. Masks are vectors with every bit of a lane set or clear.
+#ifdef LOCKSTEP_VECTOR_EXTENSIONS
+typedef U16 LaneVector __attribute__((vector_size(LOCKSTEP_LANE_COUNT * sizeof(U16))));
+#define LANE(_vector, _index) ((_vector)[_index])
+#else
+typedef struct {
+  U16 lanes[LOCKSTEP_LANE_COUNT];
+} LaneVector;
+#define LANE(_vector, _index) ((_vector).lanes[_index])
+#endif
+
+static LaneVector Lanes_load(Register const * pLanes) {
+  LaneVector vector;
+  memcpy(&vector, pLanes, sizeof(vector));
+  return vector;
+}
+
+static void Lanes_store(Register * pLanes, LaneVector vector) { memcpy(pLanes, &vector, sizeof(vector)); }
+
+static LaneVector Lanes_broadcast(U16 value) {
+  LaneVector vector;
+  for (U32 i = 0; i < LOCKSTEP_LANE_COUNT; i++) {
+    LANE(vector, i) = value;
+  }
+  return vector;
+}
+
+#ifdef LOCKSTEP_VECTOR_EXTENSIONS
+#define DEFINE_LANES_OP(_name, _expression)                                                                            \
+  static LaneVector Lanes_##_name(LaneVector lhs, LaneVector rhs) { return (LaneVector) (_expression); }
+#else
+#define DEFINE_LANES_OP(_name, _expression)                                                                            \
+  static LaneVector Lanes_##_name(LaneVector lhsLanes, LaneVector rhsLanes) {                                          \
+    LaneVector result;                                                                                                 \
+    for (U32 i = 0; i < LOCKSTEP_LANE_COUNT; i++) {                                                                    \
+      U16 lhs = LANE(lhsLanes, i);                                                                                     \
+      U16 rhs = LANE(rhsLanes, i);                                                                                     \
+      LANE(result, i) = (U16) (_expression);                                                                           \
+    }                                                                                                                  \
+    return result;                                                                                                     \
+  }
+#endif
+
+// Comparisons yield 0xFFFF for true lanes; the scalar fallback spells that out.
+#ifdef LOCKSTEP_VECTOR_EXTENSIONS
+#define LANES_TRUE(_condition) (_condition)
+#else
+#define LANES_TRUE(_condition) ((_condition) ? 0xFFFFu : 0u)
+#endif
+
+DEFINE_LANES_OP(add, lhs + rhs)
+DEFINE_LANES_OP(sub, lhs - rhs)
+DEFINE_LANES_OP(mul, lhs * rhs)
+DEFINE_LANES_OP(and, lhs & rhs)
+DEFINE_LANES_OP(or, lhs | rhs)
+DEFINE_LANES_OP(xor, lhs ^ rhs)
+DEFINE_LANES_OP(equal, LANES_TRUE(lhs == rhs))
+DEFINE_LANES_OP(less, LANES_TRUE(lhs < rhs))
+
+// Shift counts are taken modulo 32, as the scalar ALU does; counts of 16 and above leave
+// nothing in the low 16 bits.
+#ifdef LOCKSTEP_VECTOR_EXTENSIONS
+static LaneVector Lanes_shiftCount(LaneVector rhs) { return Lanes_and(rhs, Lanes_broadcast(31)); }
+static LaneVector Lanes_shiftInRange(LaneVector count) { return Lanes_less(count, Lanes_broadcast(16)); }
+
+static LaneVector Lanes_shl(LaneVector lhs, LaneVector rhs) {
+  LaneVector count = Lanes_shiftCount(rhs);
+  return (lhs << (count & 15)) & Lanes_shiftInRange(count);
+}
+
+static LaneVector Lanes_shr(LaneVector lhs, LaneVector rhs) {
+  LaneVector count = Lanes_shiftCount(rhs);
+  return (lhs >> (count & 15)) & Lanes_shiftInRange(count);
+}
+
+static LaneVector Lanes_not(LaneVector lhs) { return ~lhs; }
+
+static LaneVector Lanes_select(LaneVector mask, LaneVector ifSet, LaneVector ifClear) {
+  return (ifSet & mask) | (ifClear & ~mask);
+}
+#else
+DEFINE_LANES_OP(shl, (rhs & 31) < 16 ? lhs << (rhs & 15) : 0)
+DEFINE_LANES_OP(shr, (rhs & 31) < 16 ? lhs >> (rhs & 15) : 0)
+
+static LaneVector Lanes_not(LaneVector lhs) { return Lanes_xor(lhs, Lanes_broadcast(0xFFFFu)); }
+
+static LaneVector Lanes_select(LaneVector mask, LaneVector ifSet, LaneVector ifClear) {
+  return Lanes_or(Lanes_and(ifSet, mask), Lanes_and(ifClear, Lanes_not(mask)));
+}
+#endif
+
+static LaneVector Lockstep_loadOperand(LockstepState const * pState, PackedInstruction instr, U8 index) {
+  U16 operand = PackedInstruction_getOperand(instr, index);
+  if (PackedInstruction_getOperandKind(instr, index) == INSTRUCTION_OPERAND_REGISTER) {
+    assert(operand < CPU_DATA_REGISTRY_LIST_SIZE && "Register index out of bounds");
+    return Lanes_load(pState->dataRegisters[operand]);
+  }
+  return Lanes_broadcast(operand);
+}
+
+static void Lockstep_executeALU(LockstepState * pState, PackedInstruction instr, LaneVector mask) {
+  InstructionType type = PackedInstruction_getType(instr);
+  LaneVector lhs = Lockstep_loadOperand(pState, instr, 0);
+  LaneVector rhs = Lockstep_loadOperand(pState, instr, 1);
+  LaneVector zero = Lanes_broadcast(0);
+  LaneVector flags = zero;
+  LaneVector result = lhs;
+  LaneVector overflow = Lanes_load(pState->overflowRegister);
+  LaneVector overflowMask = zero;
+
+  switch (type) {
+    case ALU_ADD: result = Lanes_add(lhs, rhs); break;
+    case ALU_SUB:
+      result = Lanes_sub(lhs, rhs);
+      overflow = Lanes_less(lhs, rhs);
+      overflowMask = mask;
+      break;
+    case ALU_MUL: result = Lanes_mul(lhs, rhs); break;
+    case ALU_DIV: {
+      LaneVector divZero = Lanes_equal(rhs, zero);
+      flags = Lanes_and(divZero, Lanes_broadcast(FR_DIV_ZERO_FLAG));
+      for (U32 i = 0; i < LOCKSTEP_LANE_COUNT; i++) {
+        if (LANE(rhs, i) != 0) {
+          LANE(result, i) = LANE(lhs, i) / LANE(rhs, i);
+          LANE(overflow, i) = LANE(lhs, i) % LANE(rhs, i);
+        }
+      }
+      overflowMask = Lanes_and(mask, Lanes_not(divZero));
+      break;
+    }
+    case ALU_OR: result = Lanes_or(lhs, rhs); break;
+    case ALU_AND: result = Lanes_and(lhs, rhs); break;
+    case ALU_XOR: result = Lanes_xor(lhs, rhs); break;
+    case ALU_SHL: result = Lanes_shl(lhs, rhs); break;
+    case ALU_SHR: result = Lanes_shr(lhs, rhs); break;
+    case ALU_NOT: result = Lanes_not(lhs); break;
+    case ALU_CMP: {
+      LaneVector equal = Lanes_equal(lhs, rhs);
+      LaneVector less = Lanes_less(lhs, rhs);
+      flags = Lanes_or(Lanes_and(equal, Lanes_broadcast(FR_EQUAL_FLAG)),
+                       Lanes_and(less, Lanes_broadcast(FR_LESS_FLAG)));
+      break;
+    }
+    default:
+      assert(false && "Invalid instruction type.");
+  }
+
+  Lanes_store(pState->flagRegister, Lanes_select(mask, flags, Lanes_load(pState->flagRegister)));
+  Lanes_store(pState->overflowRegister,
+              Lanes_select(overflowMask, overflow, Lanes_load(pState->overflowRegister)));
+  if (type != ALU_CMP) {
+    assert(PackedInstruction_getOperandKind(instr, 0) == INSTRUCTION_OPERAND_REGISTER &&
+           "ALU instructions write to a register");
+    Register * pLanes = pState->dataRegisters[PackedInstruction_getOperand(instr, 0)];
+    Lanes_store(pLanes, Lanes_select(mask, result, Lanes_load(pLanes)));
+  }
+}
+
+// Control flow is per lane; returns whether the instruction retired on that lane.
+static bool Lockstep_executeIPU(LockstepState * pState, PackedInstruction instr, U32 lane, U32 instructionCount) {
+  InstructionType type = PackedInstruction_getType(instr);
+  U32 * pProgramCounter = &pState->programCounter[lane];
+  U32 * pCallDepth = &pState->callDepth[lane];
+  if (type == IPU_RET) {
+    *pProgramCounter = *pCallDepth == 0 ? instructionCount : pState->callStack[--*pCallDepth][lane];
+    return true;
+  }
+
+  U32 target = PackedInstruction_getBranchTarget(instr);
+  if (!IPU_isBranchTaken(pState->flagRegister[lane], type)) {
+    ++*pProgramCounter;
+    return true;
+  }
+  if ((type == IPU_CALL && *pCallDepth == IPU_CALL_STACK_SIZE) || target > instructionCount) {
+    pState->flagRegister[lane] |= FR_SEG_FLAG;
+    return false;
+  }
+  if (type == IPU_CALL) {
+    pState->callStack[(*pCallDepth)++][lane] = *pProgramCounter + 1;
+  }
+  *pProgramCounter = target;
+  return true;
+}
+
+void Lockstep_run(
+    PackedInstruction const * pInstructions,
+    U32 instructionCount,
+    U32 laneCount,
+    U32 maxSteps,
+    LockstepState * pState,
+    CpuRunStats * pStats
+) {
+  assert(pState != NULL && laneCount <= LOCKSTEP_LANE_COUNT);
+  assert(pInstructions != NULL || instructionCount == 0);
+
+  U32 steps[LOCKSTEP_LANE_COUNT] = {0};
+  CpuRunResult results[LOCKSTEP_LANE_COUNT];
+  bool running[LOCKSTEP_LANE_COUNT];
+  for (U32 lane = 0; lane < LOCKSTEP_LANE_COUNT; lane++) {
+    running[lane] = lane < laneCount;
+    if (pState->programCounter[lane] > instructionCount) {
+      pState->programCounter[lane] = instructionCount;
+    }
+  }
+
+  for (;;) {
+    U32 programCounter = instructionCount;
+    for (U32 lane = 0; lane < laneCount; lane++) {
+      if (!running[lane]) {
+        continue;
+      }
+      if (Register_isSet(pState->flagRegister[lane], FR_FAULT_MASK)) {
+        results[lane] = CPU_RUN_RESULT_FAULT;
+      } else if (pState->programCounter[lane] == instructionCount) {
+        results[lane] = CPU_RUN_RESULT_END_OF_PROGRAM;
+      } else if (steps[lane] == maxSteps) {
+        results[lane] = CPU_RUN_RESULT_STEP_LIMIT;
+      } else {
+        if (pState->programCounter[lane] < programCounter) {
+          programCounter = pState->programCounter[lane];
+        }
+        continue;
+      }
+      running[lane] = false;
+    }
+    if (programCounter == instructionCount) {
+      break;
+    }
+
+    LaneVector mask = Lanes_broadcast(0);
+    for (U32 lane = 0; lane < laneCount; lane++) {
+      if (running[lane] && pState->programCounter[lane] == programCounter) {
+        LANE(mask, lane) = 0xFFFFu;
+      }
+    }
+
+    PackedInstruction instr = pInstructions[programCounter];
+    InstructionType type = PackedInstruction_getType(instr);
+    if (type > MMU_POP) {
+      for (U32 lane = 0; lane < laneCount; lane++) {
+        if (LANE(mask, lane)) {
+          pState->flagRegister[lane] |= FR_ILLEGAL_FLAG;
+        }
+      }
+      continue;
+    }
+
+    if (InstructionType_isIPU(type)) {
+      for (U32 lane = 0; lane < laneCount; lane++) {
+        if (LANE(mask, lane) && Lockstep_executeIPU(pState, instr, lane, instructionCount)) {
+          steps[lane]++;
+        }
+      }
+      continue;
+    }
+
+    if (InstructionType_isALU(type)) {
+      Lockstep_executeALU(pState, instr, mask);
+    } else {
+      Lanes_store(pState->flagRegister, Lanes_select(mask, Lanes_broadcast(0), Lanes_load(pState->flagRegister)));
+    }
+    for (U32 lane = 0; lane < laneCount; lane++) {
+      if (LANE(mask, lane)) {
+        pState->programCounter[lane]++;
+        steps[lane]++;
+      }
+    }
+  }
+
+  if (pStats != NULL) {
+    for (U32 lane = 0; lane < laneCount; lane++) {
+      pStats[lane].result = results[lane];
+      pStats[lane].executedInstructionCount = steps[lane];
+      pStats[lane].programCounter = pState->programCounter[lane];
+    }
+  }
+}
@@ -4,15 +4,33 @@
 #include <proc/Alu.h>
 #include <stdlib.h>
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ALU_BATCH_X86_64
+#include <immintrin.h>
+#endif
+
 
 typedef void (*OverflowConsumer)(Register *dst, U16 src);
 typedef U32 (*BinaryOperator)(U16 lhs, U16 rhs);
 
+// What the flag register is computed from in lazy mode. Only a compare keeps its operands.
+typedef enum {
+  ALU_PENDING_NONE,
+  ALU_PENDING_CLEAR,
+  ALU_PENDING_COMPARE,
+  ALU_PENDING_DIV_ZERO,
+} AluPendingFlags;
+
 typedef struct Private_ALU {
 
   Register *flagRegister;
   Register *overflowReg;
 
+  bool lazyFlags;
+  U8 pendingFlags;
+  U16 compareLhs;
+  U16 compareRhs;
+
 } Private_ALU;
 
 #define DEFINE_OP(_name, _operand)                                                                                     \
@@ -23,11 +41,11 @@ DEFINE_OP(sub, -)
 DEFINE_OP(mul, *)
 DEFINE_OP(or, |)
 DEFINE_OP(and, &)
-DEFINE_OP(shl, <<)
-DEFINE_OP(shr, >>)
 DEFINE_OP(xor, ^)
 
-static U32 not(U16 lhs, U16 rhs) { return (U32) ~lhs; }
+// Shift counts are taken modulo 32, so counts from 16 to 31 shift every bit out.
+static U32 shl(U16 lhs, U16 rhs) { return (U32) lhs << (rhs & 31u); }
+static U32 shr(U16 lhs, U16 rhs) { return (U32) lhs >> (rhs & 31u); }
 
 static U32 div2(U16 lhs, U16 rhs) {
   U16 remainder = lhs % rhs;
@@ -55,9 +73,23 @@ Private_ALU *ALU_ctor(Register *reg, Register *overflowReg) {
   Private_ALU *alu = (Private_ALU *) malloc(sizeof(Private_ALU));
   alu->flagRegister = reg;
   alu->overflowReg = overflowReg;
+  alu->lazyFlags = false;
+  alu->pendingFlags = ALU_PENDING_NONE;
+  alu->compareLhs = 0;
+  alu->compareRhs = 0;
   return alu;
 }
 
+// In lazy mode the only flag raised here is FR_DIV_ZERO_FLAG, since compares are recorded
+// before they reach the ALU operations.
+static void ALU_raiseFlag(Private_ALU *alu, Register flag) {
+  if (alu->lazyFlags) {
+    alu->pendingFlags = ALU_PENDING_DIV_ZERO;
+  } else {
+    *alu->flagRegister |= flag;
+  }
+}
+
 static void ALU_add(Private_ALU *alu, Register *dstSrc0, Register *src1) {
   assert(src1 != NULL);
   compute(alu, sum, dstSrc0, src1, &ignoreOverflow);
@@ -75,7 +107,7 @@ static void ALU_mul(Private_ALU *alu, Register *dstSrc0, Register *src1) {
 
 static void ALU_div(Private_ALU *alu, Register *dstSrc0, Register *src1) {
   if (*src1 == 0) {
-    *alu->flagRegister |= FR_DIV_ZERO_FLAG;
+    ALU_raiseFlag(alu, FR_DIV_ZERO_FLAG);
     return;
   }
 
@@ -107,8 +139,11 @@ static void ALU_xor(Private_ALU *alu, Register *dstSrc0, Register *src1) {
   compute(alu, xor, dstSrc0, src1, &ignoreOverflow);
 }
 
+// The second operand is unused and may be NULL.
 static void ALU_not(Private_ALU *alu, Register *dstSrc0, Register *src1) {
-  compute(alu, not, dstSrc0, src1, &ignoreOverflow);
+  (void) alu;
+  (void) src1;
+  *dstSrc0 = (Register) ~*dstSrc0;
 }
 
 static void ALU_cmp(Private_ALU *alu, const Register *src0, const Register *src1) {
@@ -116,21 +151,33 @@ static void ALU_cmp(Private_ALU *alu, const Register *src0, const Register *src1
   assert(src1 != NULL);
 
   if (*src0 == *src1) {
-    *alu->flagRegister |= FR_EQUAL_FLAG;
+    ALU_raiseFlag(alu, FR_EQUAL_FLAG);
   } else if (*src0 < *src1) {
-    *alu->flagRegister |= FR_LESS_FLAG;
+    ALU_raiseFlag(alu, FR_LESS_FLAG);
   }
 }
 
 void ALU_execute(Private_ALU *self, Instruction instruction) {
   assert(instruction != NULL);
-  assert(Instruction_getParam1(instruction) != NULL);
-  assert(Instruction_getParam2(instruction) != NULL);
+  ALU_executeOperation(self, Instruction_getType(instruction), Instruction_getParam1(instruction),
+                       Instruction_getParam2(instruction));
+}
 
-  Register *p0 = Instruction_getParam1(instruction);
-  Register *p1 = Instruction_getParam2(instruction);
+void ALU_executeOperation(Private_ALU *self, InstructionType type, Register *p0, Register *p1) {
+  assert(p0 != NULL);
+  assert((p1 != NULL || type == ALU_NOT) && "Only not has no second operand");
+
+  if (self->lazyFlags) {
+    if (type == ALU_CMP) {
+      self->pendingFlags = ALU_PENDING_COMPARE;
+      self->compareLhs = *p0;
+      self->compareRhs = *p1;
+      return;
+    }
+    self->pendingFlags = ALU_PENDING_CLEAR;
+  }
 
-  switch (Instruction_getType(instruction)) {
+  switch (type) {
     case ALU_ADD:
       ALU_add(self, p0, p1);
       break;
@@ -174,4 +221,193 @@ void ALU_execute(Private_ALU *self, Instruction instruction) {
          "Unexpected error raised");
 }
 
+static void ALU_executeBatchScalar(InstructionType type, Register const *lhs, Register const *rhs, Register *out,
+                                  Register *overflow, Register *flags, U32 count) {
+  for (U32 i = 0; i < count; i++) {
+    Register flag = 0;
+    Register overflowReg = overflow != NULL ? overflow[i] : 0;
+    Private_ALU alu = {.flagRegister = &flag, .overflowReg = &overflowReg, .lazyFlags = false};
+    Register result = lhs[i];
+    Register operand = rhs[i];
+    ALU_executeOperation(&alu, type, &result, &operand);
+    out[i] = result;
+    if (overflow != NULL) {
+      overflow[i] = overflowReg;
+    }
+    if (flags != NULL) {
+      flags[i] = flag;
+    }
+  }
+}
+
+#ifdef ALU_BATCH_X86_64
+// Each kernel handles whole vectors and returns how many elements it processed; the rest
+// goes through the scalar path.
+static U32 ALU_executeBatchSse2(InstructionType type, Register const *lhs, Register const *rhs, Register *out,
+                                Register *overflow, Register *flags, U32 count) {
+  // SSE2 shifts every lane by the same count, so shifts by counts modulo 32 stay scalar.
+  if (type == ALU_DIV || type == ALU_SHL || type == ALU_SHR) {
+    return 0;
+  }
+
+  U32 const width = sizeof(__m128i) / sizeof(Register);
+  __m128i const zero = _mm_setzero_si128();
+  __m128i const ones = _mm_set1_epi16(-1);
+  U32 i = 0;
+  for (; i + width <= count; i += width) {
+    __m128i l = _mm_loadu_si128((__m128i const *) (lhs + i));
+    __m128i r = _mm_loadu_si128((__m128i const *) (rhs + i));
+    __m128i less = _mm_andnot_si128(_mm_cmpeq_epi16(_mm_subs_epu16(r, l), zero), ones);
+    __m128i result = l;
+    __m128i flag = zero;
+    switch (type) {
+      case ALU_ADD: result = _mm_add_epi16(l, r); break;
+      case ALU_SUB:
+        result = _mm_sub_epi16(l, r);
+        if (overflow != NULL) {
+          _mm_storeu_si128((__m128i *) (overflow + i), less);
+        }
+        break;
+      case ALU_MUL: result = _mm_mullo_epi16(l, r); break;
+      case ALU_OR: result = _mm_or_si128(l, r); break;
+      case ALU_AND: result = _mm_and_si128(l, r); break;
+      case ALU_XOR: result = _mm_xor_si128(l, r); break;
+      case ALU_NOT: result = _mm_xor_si128(l, ones); break;
+      case ALU_CMP:
+        flag = _mm_or_si128(_mm_and_si128(_mm_cmpeq_epi16(l, r), _mm_set1_epi16(FR_EQUAL_FLAG)),
+                            _mm_and_si128(less, _mm_set1_epi16(FR_LESS_FLAG)));
+        break;
+      default:
+        assert(false && "Invalid instruction type.");
+    }
+    _mm_storeu_si128((__m128i *) (out + i), result);
+    if (flags != NULL) {
+      _mm_storeu_si128((__m128i *) (flags + i), flag);
+    }
+  }
+  return i;
+}
+
+// AVX2 has no 16-bit variable shift, so shifts widen to 32-bit lanes and narrow back. Counts
+// are taken modulo 32, as the scalar shl and shr do.
+__attribute__((target("avx2"))) static __m256i ALU_shiftAvx2(__m256i l, __m256i r, bool left) {
+  __m256i const countMask = _mm256_set1_epi32(31);
+  __m256i const lowMask = _mm256_set1_epi32(0xFFFF);
+  __m256i lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(l));
+  __m256i hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(l, 1));
+  __m256i loCount = _mm256_and_si256(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(r)), countMask);
+  __m256i hiCount = _mm256_and_si256(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(r, 1)), countMask);
+  lo = left ? _mm256_sllv_epi32(lo, loCount) : _mm256_srlv_epi32(lo, loCount);
+  hi = left ? _mm256_sllv_epi32(hi, hiCount) : _mm256_srlv_epi32(hi, hiCount);
+  __m256i packed = _mm256_packus_epi32(_mm256_and_si256(lo, lowMask), _mm256_and_si256(hi, lowMask));
+  return _mm256_permute4x64_epi64(packed, 0xD8);
+}
+
+__attribute__((target("avx2"))) static U32 ALU_executeBatchAvx2(InstructionType type, Register const *lhs,
+                                                                Register const *rhs, Register *out,
+                                                                Register *overflow, Register *flags, U32 count) {
+  if (type == ALU_DIV) {
+    return 0;
+  }
+
+  U32 const width = sizeof(__m256i) / sizeof(Register);
+  __m256i const zero = _mm256_setzero_si256();
+  __m256i const ones = _mm256_set1_epi16(-1);
+  U32 i = 0;
+  for (; i + width <= count; i += width) {
+    __m256i l = _mm256_loadu_si256((__m256i const *) (lhs + i));
+    __m256i r = _mm256_loadu_si256((__m256i const *) (rhs + i));
+    __m256i less = _mm256_andnot_si256(_mm256_cmpeq_epi16(_mm256_subs_epu16(r, l), zero), ones);
+    __m256i result = l;
+    __m256i flag = zero;
+    switch (type) {
+      case ALU_ADD: result = _mm256_add_epi16(l, r); break;
+      case ALU_SUB:
+        result = _mm256_sub_epi16(l, r);
+        if (overflow != NULL) {
+          _mm256_storeu_si256((__m256i *) (overflow + i), less);
+        }
+        break;
+      case ALU_MUL: result = _mm256_mullo_epi16(l, r); break;
+      case ALU_OR: result = _mm256_or_si256(l, r); break;
+      case ALU_AND: result = _mm256_and_si256(l, r); break;
+      case ALU_XOR: result = _mm256_xor_si256(l, r); break;
+      case ALU_SHL: result = ALU_shiftAvx2(l, r, true); break;
+      case ALU_SHR: result = ALU_shiftAvx2(l, r, false); break;
+      case ALU_NOT: result = _mm256_xor_si256(l, ones); break;
+      case ALU_CMP:
+        flag = _mm256_or_si256(_mm256_and_si256(_mm256_cmpeq_epi16(l, r), _mm256_set1_epi16(FR_EQUAL_FLAG)),
+                               _mm256_and_si256(less, _mm256_set1_epi16(FR_LESS_FLAG)));
+        break;
+      default:
+        assert(false && "Invalid instruction type.");
+    }
+    _mm256_storeu_si256((__m256i *) (out + i), result);
+    if (flags != NULL) {
+      _mm256_storeu_si256((__m256i *) (flags + i), flag);
+    }
+  }
+  return i;
+}
+#endif
+
+void ALU_executeBatch(Private_ALU *self, InstructionType type, Register const *lhs, Register const *rhs,
+                      Register *out, Register *overflow, Register *flags, U32 count) {
+  (void) self;
+  assert(InstructionType_isALU(type) && "Invalid instruction type.");
+  assert(count == 0 || (lhs != NULL && rhs != NULL && out != NULL));
+
+  U32 done = 0;
+#ifdef ALU_BATCH_X86_64
+  if (__builtin_cpu_supports("avx2")) {
+    done = ALU_executeBatchAvx2(type, lhs, rhs, out, overflow, flags, count);
+  } else {
+    done = ALU_executeBatchSse2(type, lhs, rhs, out, overflow, flags, count);
+  }
+#endif
+  ALU_executeBatchScalar(type, lhs + done, rhs + done, out + done, overflow != NULL ? overflow + done : NULL,
+                         flags != NULL ? flags + done : NULL, count - done);
+}
+
+void ALU_setLazyFlags(Private_ALU *self, bool lazy) {
+  ALU_materializeFlags(self);
+  self->lazyFlags = lazy;
+}
+
+bool ALU_hasLazyFlags(Private_ALU *self) { return self->lazyFlags; }
+
+void ALU_deferFlagClear(Private_ALU *self) {
+  assert(self->lazyFlags && "Flag clears are only deferred in lazy mode");
+  self->pendingFlags = ALU_PENDING_CLEAR;
+}
+
+void ALU_materializeFlags(Private_ALU *self) {
+  Register flags = 0;
+  switch (self->pendingFlags) {
+    case ALU_PENDING_NONE:
+      return;
+    case ALU_PENDING_COMPARE:
+      if (self->compareLhs == self->compareRhs) {
+        flags = FR_EQUAL_FLAG;
+      } else if (self->compareLhs < self->compareRhs) {
+        flags = FR_LESS_FLAG;
+      }
+      break;
+    case ALU_PENDING_DIV_ZERO:
+      flags = FR_DIV_ZERO_FLAG;
+      break;
+    default:
+      break;
+  }
+  *self->flagRegister = flags;
+  self->pendingFlags = ALU_PENDING_NONE;
+}
+
+Register *ALU_getFlagRegister(Private_ALU *self) {
+  ALU_materializeFlags(self);
+  return self->flagRegister;
+}
+
+Register *ALU_getOverflowRegister(Private_ALU *self) { return self->overflowReg; }
+
 void ALU_dtor(Private_ALU *mem) { free(mem); }
@@ -4,6 +4,8 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 extern "C" {
 #include <model/Register.h>
 #include <proc/Alu.h>
@@ -100,3 +102,88 @@ TEST(AluTest, ALU_zero_div_raise_flag) {
     ASSERT_EQ(FR_DIV_ZERO_FLAG, flg);
   });
 }
+
+TEST(AluTest, ALU_shift_counts_modulo_32) {
+  aluTest([](ALU& alu, Register& flg, Register& ovf) {
+    Register p0 = 0x0101;
+    Register p1 = 33;
+    ALU_executeOperation(alu, ALU_SHL, &p0, &p1);
+    ASSERT_EQ(0x0202, p0);
+
+    p1 = 40;
+    ALU_executeOperation(alu, ALU_SHR, &p0, &p1);
+    ASSERT_EQ(0x0002, p0);
+
+    p1 = 20;
+    ALU_executeOperation(alu, ALU_SHL, &p0, &p1);
+    ASSERT_EQ(0, p0);
+  });
+}
+
+TEST(AluTest, ALU_lazy_flags_materialize_on_read) {
+  aluTest([](ALU& alu, Register& flg, Register& ovf) {
+    Register p0 = 3;
+    Register p1 = 5;
+    ALU_setLazyFlags(alu, true);
+    auto cmp = Instruction_ctor3(ALU_CMP, &p0, &p1);
+    ALU_execute(alu, cmp);
+    Instruction_dtor(cmp);
+    ASSERT_EQ(0, flg);
+    ALU_materializeFlags(alu);
+    ASSERT_EQ(FR_LESS_FLAG, flg);
+
+    p1 = 0;
+    auto div = Instruction_ctor3(ALU_DIV, &p0, &p1);
+    ALU_execute(alu, div);
+    Instruction_dtor(div);
+    ASSERT_EQ(FR_LESS_FLAG, flg);
+    ASSERT_EQ(FR_DIV_ZERO_FLAG, *ALU_getFlagRegister(alu));
+    ASSERT_EQ(3, p0);
+
+    // The parser emits not without a second operand.
+    auto notInstr = Instruction_ctor3(ALU_NOT, &p0, nullptr);
+    ALU_execute(alu, notInstr);
+    Instruction_dtor(notInstr);
+    ASSERT_EQ(0, *ALU_getFlagRegister(alu));
+    ASSERT_EQ(static_cast<Register>(~3), p0);
+  });
+}
+
+TEST(AluTest, ALU_batch_matches_scalar_execution) {
+  aluTest([](ALU& alu, Register& flg, Register& ovf) {
+    U32 const count = 1037;
+    std::vector<Register> lhs(count);
+    std::vector<Register> rhs(count);
+    U32 seed = 12345;
+    auto next = [&seed] {
+      seed = seed * 1103515245u + 12345u;
+      return static_cast<Register>(seed >> 12);
+    };
+    for (U32 i = 0; i < count; ++i) {
+      lhs[i] = i % 11 == 0 ? rhs[i] : next();
+      rhs[i] = i % 13 == 0 ? 0 : next();
+    }
+
+    for (auto type : {ALU_ADD, ALU_SUB, ALU_MUL, ALU_DIV, ALU_OR, ALU_AND, ALU_XOR, ALU_SHL, ALU_SHR, ALU_NOT, ALU_CMP}) {
+      std::vector<Register> out(count);
+      std::vector<Register> overflow(count, 0xABCD);
+      std::vector<Register> flags(count, 0xFFFF);
+      ALU_executeBatch(alu, type, lhs.data(), rhs.data(), out.data(), overflow.data(), flags.data(), count);
+
+      for (U32 i = 0; i < count; ++i) {
+        Register p0 = lhs[i];
+        Register p1 = rhs[i];
+        flg = 0;
+        ovf = 0xABCD;
+        ALU_executeOperation(alu, type, &p0, &p1);
+        ASSERT_EQ(p0, out[i]) << "type " << type << " element " << i;
+        ASSERT_EQ(ovf, overflow[i]) << "type " << type << " element " << i;
+        ASSERT_EQ(flg, flags[i]) << "type " << type << " element " << i;
+      }
+    }
+
+    std::vector<Register> out(count);
+    ALU_executeBatch(alu, ALU_SUB, lhs.data(), rhs.data(), out.data(), nullptr, nullptr, count);
+    ASSERT_EQ(static_cast<Register>(lhs[5] - rhs[5]), out[5]);
+  });
+}
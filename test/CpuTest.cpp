@@ -4,6 +4,9 @@
 
 #include <gtest/gtest.h>
 
+#include <array>
+#include <utility>
+
 extern "C" {
 #include <model/Register.h>
 #include <proc/Alu.h>
@@ -59,3 +62,273 @@ TEST(CpuTest, executeALU) {
   CPU_dtor(cpu);
   ALU_dtor(alu);
 }
+
+namespace {
+template <typename Fn> auto cpuRunTest(Fn&& callable) {
+  Register ovf = 0;
+  auto cpu = CPU_ctor();
+  auto alu = ALU_ctor(CPU_getFlagRegisterAddress(cpu), &ovf);
+  CPU_setALU(cpu, alu);
+  std::invoke(std::forward<Fn>(callable), cpu, CPU_getDataRegisters(cpu));
+  CPU_dtor(cpu);
+  ALU_dtor(alu);
+}
+}
+
+TEST(CpuTest, runExecutesWholeProgram) {
+  cpuRunTest([](CPU cpu, Register* regs) {
+    regs[0] = 1;
+    regs[1] = 2;
+    Instruction program[] = {
+        Instruction_ctor3(ALU_ADD, &regs[0], &regs[1]),
+        Instruction_ctor3(ALU_MUL, &regs[0], &regs[1]),
+        Instruction_ctor3(ALU_CMP, &regs[0], &regs[1]),
+    };
+
+    CpuRunStats stats;
+    CPU_loadProgram(cpu, program, 3);
+    ASSERT_EQ(CPU_RUN_RESULT_END_OF_PROGRAM, CPU_run(cpu, CPU_RUN_NO_STEP_LIMIT, &stats));
+    ASSERT_EQ(CPU_RUN_RESULT_END_OF_PROGRAM, stats.result);
+    ASSERT_EQ(3, stats.executedInstructionCount);
+    ASSERT_EQ(3, stats.programCounter);
+    ASSERT_EQ(6, regs[0]);
+    ASSERT_EQ(0, CPU_getFlagRegister(cpu));
+
+    for (auto instr : program) {
+      Instruction_dtor(instr);
+    }
+  });
+}
+
+TEST(CpuTest, runStopsOnStepLimitAndResumes) {
+  cpuRunTest([](CPU cpu, Register* regs) {
+    regs[1] = 1;
+    Instruction program[] = {
+        Instruction_ctor3(ALU_ADD, &regs[0], &regs[1]),
+        Instruction_ctor3(ALU_ADD, &regs[0], &regs[1]),
+        Instruction_ctor3(ALU_ADD, &regs[0], &regs[1]),
+    };
+
+    CpuRunStats stats;
+    CPU_loadProgram(cpu, program, 3);
+    ASSERT_EQ(CPU_RUN_RESULT_STEP_LIMIT, CPU_run(cpu, 2, &stats));
+    ASSERT_EQ(2, stats.executedInstructionCount);
+    ASSERT_EQ(2, CPU_getProgramCounter(cpu));
+    ASSERT_EQ(2, regs[0]);
+
+    ASSERT_EQ(CPU_RUN_RESULT_END_OF_PROGRAM, CPU_run(cpu, 2, &stats));
+    ASSERT_EQ(1, stats.executedInstructionCount);
+    ASSERT_EQ(3, regs[0]);
+
+    for (auto instr : program) {
+      Instruction_dtor(instr);
+    }
+  });
+}
+
+TEST(CpuTest, runFollowsProgramReloadedIntoTheSameArray) {
+  cpuRunTest([](CPU cpu, Register* regs) {
+    regs[1] = 2;
+    Instruction program[] = {
+        Instruction_ctor3(ALU_ADD, &regs[0], &regs[1]),
+        Instruction_ctor3(ALU_ADD, &regs[0], &regs[1]),
+    };
+    CPU_loadProgram(cpu, program, 2);
+    ASSERT_EQ(CPU_RUN_RESULT_END_OF_PROGRAM, CPU_run(cpu, CPU_RUN_NO_STEP_LIMIT, nullptr));
+    ASSERT_EQ(4, regs[0]);
+
+    auto replaced = std::exchange(program[1], Instruction_ctor3(ALU_SUB, &regs[0], &regs[1]));
+    regs[0] = 0;
+    CPU_setProgramCounter(cpu, 0);
+    CPU_loadProgram(cpu, program, 2);
+    ASSERT_EQ(CPU_RUN_RESULT_END_OF_PROGRAM, CPU_run(cpu, CPU_RUN_NO_STEP_LIMIT, nullptr));
+    ASSERT_EQ(0, regs[0]);
+
+    Instruction_dtor(replaced);
+    for (auto instr : program) {
+      Instruction_dtor(instr);
+    }
+  });
+}
+
+TEST(CpuTest, runStopsOnFault) {
+  cpuRunTest([](CPU cpu, Register* regs) {
+    auto instr = Instruction_ctor3(ALU_ADD, &regs[0], &regs[1]);
+
+    CPU_raiseFlag(cpu, FR_SEG_FLAG);
+    CpuRunStats stats;
+    CPU_loadProgram(cpu, &instr, 1);
+    ASSERT_EQ(CPU_RUN_RESULT_FAULT, CPU_run(cpu, CPU_RUN_NO_STEP_LIMIT, &stats));
+    ASSERT_EQ(0, stats.executedInstructionCount);
+    ASSERT_EQ(0, stats.programCounter);
+
+    Instruction_dtor(instr);
+  });
+}
+
+TEST(CpuTest, runRaisesIllegalOnUnknownInstruction) {
+  cpuRunTest([](CPU cpu, Register* regs) {
+    auto instr = Instruction_ctor3(static_cast<InstructionType>(MMU_POP + 1), &regs[0], &regs[1]);
+
+    CPU_loadProgram(cpu, &instr, 1);
+    ASSERT_EQ(CPU_RUN_RESULT_FAULT, CPU_run(cpu, CPU_RUN_NO_STEP_LIMIT, nullptr));
+    ASSERT_EQ(FR_ILLEGAL_FLAG, CPU_getFlagRegister(cpu));
+
+    Instruction_dtor(instr);
+  });
+}
+
+TEST(CpuTest, runFollowsBranches) {
+  cpuRunTest([](CPU cpu, Register* regs) {
+    regs[1] = 1;
+    regs[2] = 5;
+    Register loop = 0;
+    Instruction program[] = {
+        Instruction_ctor3(ALU_ADD, &regs[0], &regs[1]),
+        Instruction_ctor3(ALU_CMP, &regs[0], &regs[2]),
+        Instruction_ctor2(IPU_JNE, &loop),
+    };
+
+    CpuRunStats stats;
+    CPU_loadProgram(cpu, program, 3);
+    ASSERT_EQ(CPU_RUN_RESULT_END_OF_PROGRAM, CPU_run(cpu, CPU_RUN_NO_STEP_LIMIT, &stats));
+    ASSERT_EQ(15, stats.executedInstructionCount);
+    ASSERT_EQ(5, regs[0]);
+
+    for (auto instr : program) {
+      Instruction_dtor(instr);
+    }
+  });
+}
+
+TEST(CpuTest, runWithLazyFlagsMatchesEagerFlags) {
+  cpuRunTest([](CPU eager, Register* eagerRegs) {
+    cpuRunTest([eager, eagerRegs](CPU lazy, Register* lazyRegs) {
+      ALU_setLazyFlags(CPU_getALU(lazy), true);
+      auto program = [](Register* regs, Register* loop, Register* done) {
+        return std::array {
+            Instruction_ctor3(ALU_ADD, &regs[0], &regs[1]),
+            Instruction_ctor3(MMU_MOV, &regs[3], &regs[0]),
+            Instruction_ctor3(ALU_CMP, &regs[0], &regs[2]),
+            Instruction_ctor2(IPU_JLT, loop),
+            Instruction_ctor3(ALU_DIV, &regs[0], &regs[4]),
+            Instruction_ctor2(IPU_JMP, done),
+            Instruction_ctor3(ALU_CMP, &regs[0], &regs[0]),
+        };
+      };
+      Register loop = 0;
+      Register done = 7;
+      auto eagerProgram = program(eagerRegs, &loop, &done);
+      auto lazyProgram = program(lazyRegs, &loop, &done);
+      for (auto regs : {eagerRegs, lazyRegs}) {
+        regs[1] = 1;
+        regs[2] = 4;
+      }
+
+      CpuRunStats eagerStats;
+      CpuRunStats lazyStats;
+      CPU_loadProgram(eager, eagerProgram.data(), eagerProgram.size());
+      CPU_loadProgram(lazy, lazyProgram.data(), lazyProgram.size());
+      do {
+        CPU_run(eager, 1, &eagerStats);
+        CPU_run(lazy, 1, &lazyStats);
+        ASSERT_EQ(CPU_getFlagRegister(eager), CPU_getFlagRegister(lazy));
+        ASSERT_EQ(eagerStats.programCounter, lazyStats.programCounter);
+      } while (eagerStats.result == CPU_RUN_RESULT_STEP_LIMIT);
+      ASSERT_EQ(FR_DIV_ZERO_FLAG, CPU_getFlagRegister(lazy));
+      ASSERT_EQ(4, lazyRegs[0]);
+
+      for (auto instr : eagerProgram) {
+        Instruction_dtor(instr);
+      }
+      for (auto instr : lazyProgram) {
+        Instruction_dtor(instr);
+      }
+    });
+  });
+}
+
+TEST(CpuTest, runWithLazyFlagsKeepsPendingFlagsOnBranchFault) {
+  cpuRunTest([](CPU cpu, Register* regs) {
+    ALU_setLazyFlags(CPU_getALU(cpu), true);
+    Register outside = 99;
+    Instruction program[] = {
+        Instruction_ctor3(ALU_CMP, &regs[0], &regs[0]),
+        Instruction_ctor2(IPU_JMP, &outside),
+    };
+
+    CPU_loadProgram(cpu, program, 2);
+    ASSERT_EQ(CPU_RUN_RESULT_FAULT, CPU_run(cpu, CPU_RUN_NO_STEP_LIMIT, nullptr));
+    ASSERT_EQ(FR_EQUAL_FLAG | FR_SEG_FLAG, CPU_getFlagRegister(cpu));
+
+    for (auto instr : program) {
+      Instruction_dtor(instr);
+    }
+  });
+}
+
+TEST(CpuTest, runPackedMatchesRun) {
+  ASSERT_EQ(8, sizeof(PackedInstruction));
+  cpuRunTest([](CPU reference, Register* referenceRegs) {
+    cpuRunTest([reference, referenceRegs](CPU packed, Register* packedRegs) {
+      Register one = 1;
+      Register four = 4;
+      Register loop = 0;
+      Register body = 6;
+      Register done = 9;
+      Instruction program[] = {
+          Instruction_ctor2(IPU_CALL, &body),
+          Instruction_ctor3(ALU_CMP, &referenceRegs[0], &four),
+          Instruction_ctor2(IPU_JLT, &loop),
+          Instruction_ctor3(ALU_SUB, &referenceRegs[1], &four),
+          Instruction_ctor3(ALU_DIV, &referenceRegs[0], &referenceRegs[2]),
+          Instruction_ctor2(IPU_JMP, &done),
+          Instruction_ctor3(ALU_ADD, &referenceRegs[0], &one),
+          Instruction_ctor3(ALU_MUL, &referenceRegs[1], &referenceRegs[0]),
+          Instruction_ctor1(IPU_RET),
+      };
+      PackedInstruction packedProgram[std::size(program)];
+      for (U32 i = 0; i < std::size(program); ++i) {
+        ASSERT_TRUE(Instruction_pack(program[i], referenceRegs, &packedProgram[i]));
+      }
+      referenceRegs[1] = packedRegs[1] = 1;
+
+      CpuRunStats referenceStats;
+      CpuRunStats packedStats;
+      CPU_loadProgram(reference, program, std::size(program));
+      do {
+        CPU_run(reference, 3, &referenceStats);
+        CPU_runPacked(packed, packedProgram, std::size(packedProgram), 3, &packedStats);
+        ASSERT_EQ(CPU_getFlagRegister(reference), CPU_getFlagRegister(packed));
+        ASSERT_EQ(referenceStats.executedInstructionCount, packedStats.executedInstructionCount);
+        ASSERT_EQ(referenceStats.programCounter, packedStats.programCounter);
+        for (U32 i = 0; i < CPU_DATA_REGISTRY_LIST_SIZE; ++i) {
+          ASSERT_EQ(referenceRegs[i], packedRegs[i]);
+        }
+      } while (referenceStats.result == CPU_RUN_RESULT_STEP_LIMIT);
+      ASSERT_EQ(CPU_RUN_RESULT_END_OF_PROGRAM, packedStats.result);
+      ASSERT_EQ(FR_DIV_ZERO_FLAG, CPU_getFlagRegister(packed));
+      ASSERT_EQ(4, packedRegs[0]);
+      ASSERT_EQ(20, packedRegs[1]);
+
+      for (auto instr : program) {
+        Instruction_dtor(instr);
+      }
+    });
+  });
+}
+
+TEST(CpuTest, packRejectsWritesToConstants) {
+  cpuRunTest([](CPU, Register* regs) {
+    Register constant = 3;
+    auto instr = Instruction_ctor3(ALU_ADD, &constant, &regs[0]);
+    PackedInstruction packed = 0;
+    ASSERT_FALSE(Instruction_pack(instr, regs, &packed));
+    Instruction_setType(instr, ALU_CMP);
+    ASSERT_TRUE(Instruction_pack(instr, regs, &packed));
+    ASSERT_EQ(INSTRUCTION_OPERAND_IMMEDIATE, PackedInstruction_getOperandKind(packed, 0));
+    ASSERT_EQ(3, PackedInstruction_getOperand(packed, 0));
+    ASSERT_EQ(INSTRUCTION_OPERAND_REGISTER, PackedInstruction_getOperandKind(packed, 1));
+    Instruction_dtor(instr);
+  });
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include <array>
+
+#include <generic/cxx/Alu.hpp>
+
+extern "C" {
+#include <proc/Alu.h>
+}
+
+namespace {
+struct AluCase {
+  InstructionType type;
+  Register lhs;
+  Register rhs;
+  Register result;
+  Register overflow;
+  Register flags;
+};
+
+// Overflow starts at 0xABCD so that operations leaving it alone are visible.
+constexpr std::array aluCases {
+    AluCase {ALU_ADD, 0xFFFF, 2, 1, 0xABCD, 0},
+    AluCase {ALU_SUB, 3, 5, 0xFFFE, 0xFFFF, 0},
+    AluCase {ALU_SUB, 5, 3, 2, 0, 0},
+    AluCase {ALU_MUL, 0x1234, 0x100, 0x3400, 0xABCD, 0},
+    AluCase {ALU_DIV, 23, 5, 4, 3, 0},
+    AluCase {ALU_DIV, 23, 0, 23, 0xABCD, FR_DIV_ZERO_FLAG},
+    AluCase {ALU_OR, 0x00F0, 0x0F00, 0x0FF0, 0xABCD, 0},
+    AluCase {ALU_AND, 0x0FF0, 0x00FF, 0x00F0, 0xABCD, 0},
+    AluCase {ALU_XOR, 0x0FF0, 0x00FF, 0x0F0F, 0xABCD, 0},
+    AluCase {ALU_SHL, 0x8001, 1, 0x0002, 0xABCD, 0},
+    AluCase {ALU_SHL, 0x0001, 20, 0, 0xABCD, 0},
+    AluCase {ALU_SHR, 0x8000, 15, 1, 0xABCD, 0},
+    AluCase {ALU_NOT, 0x00FF, 0, 0xFF00, 0xABCD, 0},
+    AluCase {ALU_CMP, 4, 4, 4, 0xABCD, FR_EQUAL_FLAG},
+    AluCase {ALU_CMP, 3, 4, 3, 0xABCD, FR_LESS_FLAG},
+    AluCase {ALU_CMP, 5, 4, 5, 0xABCD, 0},
+};
+
+constexpr auto runCase(AluCase const& c) {
+  Register lhs = c.lhs;
+  Register overflow = 0xABCD;
+  Register flags = 0;
+  auto const known = cxx::aluExecute(c.type, lhs, c.rhs, overflow, flags);
+  return known && lhs == c.result && overflow == c.overflow && flags == c.flags;
+}
+
+static_assert([] {
+  for (auto const& c : aluCases) {
+    if (!runCase(c)) {
+      return false;
+    }
+  }
+  return true;
+}());
+
+static_assert([] {
+  Register lhs = 7;
+  Register overflow = 0;
+  Register flags = 0;
+  return !cxx::aluExecute(IPU_JMP, lhs, 1, overflow, flags) && lhs == 7;
+}());
+} // namespace
+
+TEST(CxxAluTest, MatchesCAluOnCaseTable) {
+  Register cFlags = 0;
+  Register cOverflow = 0;
+  auto alu = ALU_ctor(&cFlags, &cOverflow);
+  for (auto const& c : aluCases) {
+    Register cLhs = c.lhs;
+    Register cRhs = c.rhs;
+    cFlags = 0;
+    cOverflow = 0xABCD;
+    ALU_executeOperation(alu, c.type, &cLhs, &cRhs);
+
+    Register lhs = c.lhs;
+    Register overflow = 0xABCD;
+    Register flags = 0;
+    ASSERT_TRUE(cxx::aluExecute(c.type, lhs, c.rhs, overflow, flags));
+    ASSERT_EQ(cLhs, lhs) << "type " << c.type;
+    ASSERT_EQ(cOverflow, overflow) << "type " << c.type;
+    ASSERT_EQ(cFlags, flags) << "type " << c.type;
+  }
+  ALU_dtor(alu);
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+extern "C" {
+#include <proc/Alu.h>
+#include <proc/Cpu.h>
+#include <proc/Farm.h>
+}
+
+namespace {
+using std::vector;
+
+// r0 counts from r0 to r2 in steps of r1, calling a subroutine that accumulates r0 into r3.
+auto makeProgram() -> vector<PackedInstruction> {
+  return {
+      PackedInstruction_make(IPU_CALL, INSTRUCTION_OPERAND_IMMEDIATE, 4, INSTRUCTION_OPERAND_NONE, 0),
+      PackedInstruction_make(ALU_CMP, INSTRUCTION_OPERAND_REGISTER, 0, INSTRUCTION_OPERAND_REGISTER, 2),
+      PackedInstruction_make(IPU_JLT, INSTRUCTION_OPERAND_IMMEDIATE, 0, INSTRUCTION_OPERAND_NONE, 0),
+      PackedInstruction_make(IPU_JMP, INSTRUCTION_OPERAND_IMMEDIATE, 7, INSTRUCTION_OPERAND_NONE, 0),
+      PackedInstruction_make(ALU_ADD, INSTRUCTION_OPERAND_REGISTER, 0, INSTRUCTION_OPERAND_REGISTER, 1),
+      PackedInstruction_make(ALU_ADD, INSTRUCTION_OPERAND_REGISTER, 3, INSTRUCTION_OPERAND_REGISTER, 0),
+      PackedInstruction_make(IPU_RET, INSTRUCTION_OPERAND_NONE, 0, INSTRUCTION_OPERAND_NONE, 0),
+  };
+}
+
+auto runAlone(SimJob const& job) -> SimJobResult {
+  SimJobResult result {};
+  auto cpu = CPU_ctor();
+  auto alu = ALU_ctor(CPU_getFlagRegisterAddress(cpu), &result.overflowRegister);
+  CPU_setALU(cpu, alu);
+  for (U8 i = 0; i < CPU_DATA_REGISTRY_LIST_SIZE; ++i) {
+    CPU_setDataRegister(cpu, i, job.dataRegisters[i]);
+  }
+  CPU_runPacked(cpu, job.pInstructions, job.instructionCount, job.maxSteps, &result.stats);
+  for (U8 i = 0; i < CPU_DATA_REGISTRY_LIST_SIZE; ++i) {
+    result.dataRegisters[i] = CPU_getDataRegister(cpu, i);
+  }
+  result.flagRegister = CPU_getFlagRegister(cpu);
+  CPU_dtor(cpu);
+  ALU_dtor(alu);
+  return result;
+}
+
+auto expectSameResult(SimJobResult const& expected, SimJobResult const& actual) {
+  for (U32 i = 0; i < CPU_DATA_REGISTRY_LIST_SIZE; ++i) {
+    ASSERT_EQ(expected.dataRegisters[i], actual.dataRegisters[i]);
+  }
+  ASSERT_EQ(expected.flagRegister, actual.flagRegister);
+  ASSERT_EQ(expected.overflowRegister, actual.overflowRegister);
+  ASSERT_EQ(expected.stats.result, actual.stats.result);
+  ASSERT_EQ(expected.stats.executedInstructionCount, actual.stats.executedInstructionCount);
+  ASSERT_EQ(expected.stats.programCounter, actual.stats.programCounter);
+}
+} // namespace
+
+TEST(FarmTest, ResultsMatchSequentialRuns) {
+  auto program = makeProgram();
+  vector<SimJob> jobs(2000);
+  for (U32 i = 0; i < jobs.size(); ++i) {
+    jobs[i] = SimJob {
+        .pInstructions = program.data(),
+        .instructionCount = static_cast<U32>(program.size()),
+        .maxSteps = i % 7 == 0 ? 50 : CPU_RUN_NO_STEP_LIMIT,
+        .dataRegisters = {0, static_cast<Register>(1 + i % 5), static_cast<Register>(i < 100 ? 1000 : i % 50)},
+    };
+  }
+
+  auto farm = SimFarm_ctor(4);
+  ASSERT_EQ(4, SimFarm_getWorkerCount(farm));
+  vector<SimJobResult> results(jobs.size());
+  for (int run = 0; run < 3; ++run) {
+    SimFarm_run(farm, jobs.data(), jobs.size(), results.data());
+    for (U32 i = 0; i < jobs.size(); ++i) {
+      expectSameResult(runAlone(jobs[i]), results[i]);
+    }
+  }
+  SimFarm_dtor(farm);
+}
+
+TEST(FarmTest, DefaultsToHostCoresAndHandlesFewJobs) {
+  auto program = makeProgram();
+  auto farm = SimFarm_ctor(0);
+  ASSERT_LE(1, SimFarm_getWorkerCount(farm));
+  SimFarm_run(farm, nullptr, 0, nullptr);
+
+  SimJob job {
+      .pInstructions = program.data(),
+      .instructionCount = static_cast<U32>(program.size()),
+      .maxSteps = CPU_RUN_NO_STEP_LIMIT,
+      .dataRegisters = {0, 2, 10},
+  };
+  SimJobResult result {};
+  SimFarm_run(farm, &job, 1, &result);
+  ASSERT_EQ(CPU_RUN_RESULT_END_OF_PROGRAM, result.stats.result);
+  ASSERT_EQ(10, result.dataRegisters[0]);
+  ASSERT_EQ(2 + 4 + 6 + 8 + 10, result.dataRegisters[3]);
+  SimFarm_dtor(farm);
+}
@@ -0,0 +1,38 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+extern "C" {
+#include <model/Instruction.h>
+}
+
+TEST(InstructionTest, ArenaInstructionsKeepTheirAddressWhenGrowing) {
+  Register r0 = 0;
+  Register r1 = 0;
+  auto arena = InstructionArena_ctor(1);
+  std::vector<Instruction> instructions;
+  for (U32 i = 0; i < 1000; ++i) {
+    instructions.push_back(Instruction_ctorIn(arena, ALU_ADD, &r0, i % 2 ? &r1 : nullptr));
+  }
+
+  for (U32 i = 0; i < instructions.size(); ++i) {
+    ASSERT_EQ(ALU_ADD, Instruction_getType(instructions[i]));
+    ASSERT_EQ(&r0, Instruction_getParam1(instructions[i]));
+    ASSERT_EQ(i % 2 ? &r1 : nullptr, Instruction_getParam2(instructions[i]));
+  }
+  InstructionArena_dtor(arena);
+}
+
+TEST(InstructionTest, ArenaResetReusesMemory) {
+  auto arena = InstructionArena_ctor(4);
+  auto first = Instruction_ctorIn(arena, ALU_ADD, nullptr, nullptr);
+  for (U32 i = 0; i < 100; ++i) {
+    Instruction_ctorIn(arena, ALU_SUB, nullptr, nullptr);
+  }
+
+  InstructionArena_reset(arena);
+  auto reused = Instruction_ctorIn(arena, IPU_RET, nullptr, nullptr);
+  ASSERT_EQ(first, reused);
+  ASSERT_EQ(IPU_RET, Instruction_getType(reused));
+  InstructionArena_dtor(arena);
+}
@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+#include "ProgramFixture.hpp"
+
+extern "C" {
+#include <model/Register.h>
+#include <proc/Alu.h>
+#include <proc/Cpu.h>
+#include <proc/Interpreter.h>
+}
+
+namespace {
+using namespace testing::mock;
+
+auto compareInterpreterWithCpuRun(bool sharedFlagRegister, unsigned seed, U32 slice) {
+  compareWithCpuRun(sharedFlagRegister, seed, slice, [](ProgramFixture& fixture) {
+    std::shared_ptr<std::remove_pointer_t<Interpreter>> interpreter {
+        Interpreter_ctor(fixture.program().data(), fixture.program().size()), Interpreter_dtor};
+    return std::optional{[interpreter, cpu = fixture.cpu()](U32 steps, CpuRunStats* pStats) {
+      Interpreter_run(interpreter.get(), cpu, steps, pStats);
+    }};
+  });
+}
+} // namespace
+
+TEST(InterpreterTest, Init) {
+  auto interpreter = Interpreter_ctor(nullptr, 0);
+  ASSERT_EQ(0, Interpreter_getInstructionCount(interpreter));
+  Interpreter_dtor(interpreter);
+}
+
+TEST(InterpreterTest, ExecutesAluInstructions) {
+  Register flg = 0;
+  Register ovf = 0;
+  auto alu = ALU_ctor(&flg, &ovf);
+  auto cpu = CPU_ctor();
+  CPU_setALU(cpu, alu);
+  auto regs = CPU_getDataRegisters(cpu);
+  regs[0] = 23;
+  regs[1] = 6;
+  Instruction program[] = {
+      Instruction_ctor3(ALU_ADD, &regs[0], &regs[1]),
+      Instruction_ctor3(ALU_DIV, &regs[0], &regs[1]),
+      Instruction_ctor3(ALU_CMP, &regs[0], &regs[1]),
+  };
+
+  auto interpreter = Interpreter_ctor(program, 3);
+  CpuRunStats stats;
+  ASSERT_EQ(CPU_RUN_RESULT_END_OF_PROGRAM, Interpreter_run(interpreter, cpu, CPU_RUN_NO_STEP_LIMIT, &stats));
+
+  ASSERT_EQ(3, stats.executedInstructionCount);
+  ASSERT_EQ(3, CPU_getProgramCounter(cpu));
+  ASSERT_EQ(4, regs[0]);
+  ASSERT_EQ(5, ovf);
+  ASSERT_EQ(FR_LESS_FLAG, flg);
+
+  Interpreter_dtor(interpreter);
+  for (auto instr : program) {
+    Instruction_dtor(instr);
+  }
+  CPU_dtor(cpu);
+  ALU_dtor(alu);
+}
+
+TEST(InterpreterTest, LoopsUntilComparisonFails) {
+  Register ovf = 0;
+  auto cpu = CPU_ctor();
+  auto alu = ALU_ctor(CPU_getFlagRegisterAddress(cpu), &ovf);
+  CPU_setALU(cpu, alu);
+  auto regs = CPU_getDataRegisters(cpu);
+  regs[1] = 1;
+  regs[2] = 10;
+  Register loop = 0;
+  Instruction program[] = {
+      Instruction_ctor3(ALU_ADD, &regs[0], &regs[1]),
+      Instruction_ctor3(ALU_CMP, &regs[0], &regs[2]),
+      Instruction_ctor2(IPU_JLT, &loop),
+  };
+
+  auto interpreter = Interpreter_ctor(program, 3);
+  CpuRunStats stats;
+  ASSERT_EQ(CPU_RUN_RESULT_END_OF_PROGRAM, Interpreter_run(interpreter, cpu, CPU_RUN_NO_STEP_LIMIT, &stats));
+  ASSERT_EQ(30, stats.executedInstructionCount);
+  ASSERT_EQ(20, Interpreter_getFusedInstructionCount(interpreter));
+  ASSERT_EQ(10, regs[0]);
+  ASSERT_EQ(FR_EQUAL_FLAG, CPU_getFlagRegister(cpu));
+
+  Interpreter_dtor(interpreter);
+  for (auto instr : program) {
+    Instruction_dtor(instr);
+  }
+  CPU_dtor(cpu);
+  ALU_dtor(alu);
+}
+
+TEST(InterpreterTest, FusedPairStopsBetweenInstructionsOnStepLimit) {
+  Register ovf = 0;
+  auto cpu = CPU_ctor();
+  auto alu = ALU_ctor(CPU_getFlagRegisterAddress(cpu), &ovf);
+  CPU_setALU(cpu, alu);
+  auto regs = CPU_getDataRegisters(cpu);
+  regs[0] = 7;
+  regs[1] = 2;
+  Instruction program[] = {
+      Instruction_ctor3(MMU_MOV, &regs[2], &regs[0]),
+      Instruction_ctor3(ALU_SUB, &regs[0], &regs[1]),
+  };
+
+  auto interpreter = Interpreter_ctor(program, 2);
+  CpuRunStats stats;
+  ASSERT_EQ(CPU_RUN_RESULT_STEP_LIMIT, Interpreter_run(interpreter, cpu, 1, &stats));
+  ASSERT_EQ(1, CPU_getProgramCounter(cpu));
+  ASSERT_EQ(0, Interpreter_getFusedInstructionCount(interpreter));
+  ASSERT_EQ(CPU_RUN_RESULT_END_OF_PROGRAM, Interpreter_run(interpreter, cpu, 1, &stats));
+  ASSERT_EQ(5, regs[0]);
+
+  CPU_setProgramCounter(cpu, 0);
+  ASSERT_EQ(CPU_RUN_RESULT_END_OF_PROGRAM, Interpreter_run(interpreter, cpu, CPU_RUN_NO_STEP_LIMIT, &stats));
+  ASSERT_EQ(2, stats.executedInstructionCount);
+  ASSERT_EQ(2, Interpreter_getFusedInstructionCount(interpreter));
+  ASSERT_EQ(3, regs[0]);
+
+  Interpreter_dtor(interpreter);
+  for (auto instr : program) {
+    Instruction_dtor(instr);
+  }
+  CPU_dtor(cpu);
+  ALU_dtor(alu);
+}
+
+TEST(InterpreterTest, MatchesCpuRunWithSeparateFlagRegister) {
+  for (unsigned seed = 0; seed < 32; ++seed) {
+    compareInterpreterWithCpuRun(false, seed, 4096);
+  }
+}
+
+TEST(InterpreterTest, MatchesCpuRunWithSharedFlagRegister) {
+  for (unsigned seed = 0; seed < 32; ++seed) {
+    compareInterpreterWithCpuRun(true, seed, 4096);
+  }
+}
+
+TEST(InterpreterTest, MatchesCpuRunAcrossResumedSlices) {
+  for (unsigned seed = 0; seed < 32; ++seed) {
+    compareInterpreterWithCpuRun(true, seed, 37);
+  }
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+extern "C" {
+#include <model/Register.h>
+#include <proc/Ipu.h>
+}
+
+namespace {
+using std::vector;
+
+class Program {
+public:
+  Program() = default;
+  Program(Program const&) = delete;
+  ~Program() {
+    for (auto instr : _instructions) {
+      Instruction_dtor(instr);
+    }
+  }
+
+  auto push(InstructionType type, Register* p0 = nullptr) -> Program& {
+    _instructions.push_back(Instruction_ctor2(type, p0));
+    return *this;
+  }
+
+  [[nodiscard]] auto data() const { return _instructions.data(); }
+  [[nodiscard]] auto size() const { return static_cast<U32>(_instructions.size()); }
+
+private:
+  vector<Instruction> _instructions;
+};
+} // namespace
+
+TEST(IpuTest, FetchWalksProgramSequentially) {
+  Register flg = 0;
+  Program program;
+  program.push(ALU_ADD).push(ALU_SUB);
+  auto ipu = IPU_ctor(&flg, program.data(), program.size());
+
+  ASSERT_EQ(program.data()[0], IPU_fetch(ipu));
+  ASSERT_TRUE(IPU_next(ipu));
+  ASSERT_EQ(program.data()[1], IPU_fetch(ipu));
+  ASSERT_TRUE(IPU_next(ipu));
+  ASSERT_EQ(nullptr, IPU_fetch(ipu));
+  ASSERT_EQ(2, IPU_getProgramCounter(ipu));
+
+  IPU_dtor(ipu);
+}
+
+TEST(IpuTest, ConditionalJumpsFollowFlags) {
+  Register flg = 0;
+  Register target = 3;
+  Program program;
+  program.push(IPU_JEQ, &target).push(IPU_JLT, &target).push(IPU_JGE, &target).push(ALU_ADD);
+  auto ipu = IPU_ctor(&flg, program.data(), program.size());
+
+  flg = FR_LESS_FLAG;
+  ASSERT_TRUE(IPU_next(ipu));
+  ASSERT_EQ(1, IPU_getProgramCounter(ipu));
+  ASSERT_TRUE(IPU_next(ipu));
+  ASSERT_EQ(3, IPU_getProgramCounter(ipu));
+
+  IPU_setProgramCounter(ipu, 2);
+  ASSERT_TRUE(IPU_next(ipu));
+  ASSERT_EQ(3, IPU_getProgramCounter(ipu));
+
+  flg = FR_EQUAL_FLAG;
+  IPU_setProgramCounter(ipu, 0);
+  ASSERT_TRUE(IPU_next(ipu));
+  ASSERT_EQ(3, IPU_getProgramCounter(ipu));
+
+  IPU_dtor(ipu);
+}
+
+TEST(IpuTest, CallReturnsAfterCallSite) {
+  Register flg = 0;
+  Register function = 3;
+  Program program;
+  program.push(IPU_CALL, &function).push(ALU_ADD).push(IPU_RET).push(IPU_RET);
+  auto ipu = IPU_ctor(&flg, program.data(), program.size());
+
+  ASSERT_TRUE(IPU_next(ipu));
+  ASSERT_EQ(3, IPU_getProgramCounter(ipu));
+  ASSERT_TRUE(IPU_next(ipu));
+  ASSERT_EQ(1, IPU_getProgramCounter(ipu));
+
+  IPU_setProgramCounter(ipu, 2);
+  ASSERT_TRUE(IPU_next(ipu));
+  ASSERT_EQ(nullptr, IPU_fetch(ipu));
+
+  IPU_dtor(ipu);
+}
+
+TEST(IpuTest, JumpOutsideProgramRaisesSegFlag) {
+  Register flg = 0;
+  Register target = 7;
+  Program program;
+  program.push(IPU_JMP, &target);
+  auto ipu = IPU_ctor(&flg, program.data(), program.size());
+
+  ASSERT_FALSE(IPU_next(ipu));
+  ASSERT_EQ(FR_SEG_FLAG, flg);
+  ASSERT_EQ(0, IPU_getProgramCounter(ipu));
+
+  IPU_dtor(ipu);
+}
+
+TEST(IpuTest, TargetIsResolvedAtLoadTime) {
+  Register flg = 0;
+  Register target = 1;
+  Program program;
+  program.push(IPU_JMP, &target).push(ALU_ADD);
+  auto ipu = IPU_ctor(&flg, program.data(), program.size());
+
+  target = 0;
+  ASSERT_TRUE(IPU_next(ipu));
+  ASSERT_EQ(1, IPU_getProgramCounter(ipu));
+
+  IPU_dtor(ipu);
+}
@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+#include "ProgramFixture.hpp"
+
+extern "C" {
+#include <model/Register.h>
+#include <proc/Alu.h>
+#include <proc/Cpu.h>
+#include <proc/Jit.h>
+}
+
+namespace {
+using namespace testing::mock;
+
+auto compareJitWithCpuRun(bool sharedFlagRegister, unsigned seed, U32 slice, bool lazyFlags = false) {
+  compareWithCpuRun(sharedFlagRegister, seed, slice, [](ProgramFixture& fixture) {
+    std::shared_ptr<std::remove_pointer_t<JIT>> jit {
+        JIT_ctor(fixture.cpu(), fixture.program().data(), fixture.program().size()), JIT_dtor};
+    auto run = [jit](U32 steps, CpuRunStats* pStats) { JIT_run(jit.get(), steps, pStats); };
+    return jit ? std::optional{run} : std::nullopt;
+  }, lazyFlags);
+}
+} // namespace
+
+TEST(JitTest, LoopsUntilComparisonFails) {
+  Register ovf = 0;
+  auto cpu = CPU_ctor();
+  auto alu = ALU_ctor(CPU_getFlagRegisterAddress(cpu), &ovf);
+  CPU_setALU(cpu, alu);
+  auto regs = CPU_getDataRegisters(cpu);
+  regs[1] = 1;
+  regs[2] = 10;
+  Register loop = 0;
+  Instruction program[] = {
+      Instruction_ctor3(ALU_ADD, &regs[0], &regs[1]),
+      Instruction_ctor3(ALU_CMP, &regs[0], &regs[2]),
+      Instruction_ctor2(IPU_JLT, &loop),
+  };
+
+  auto jit = JIT_ctor(cpu, program, 3);
+  if (jit != nullptr) {
+    ASSERT_EQ(1, JIT_getCompiledBlockCount(jit));
+    CpuRunStats stats;
+    ASSERT_EQ(CPU_RUN_RESULT_END_OF_PROGRAM, JIT_run(jit, CPU_RUN_NO_STEP_LIMIT, &stats));
+    ASSERT_EQ(30, stats.executedInstructionCount);
+    ASSERT_EQ(3, CPU_getProgramCounter(cpu));
+    ASSERT_EQ(10, regs[0]);
+    ASSERT_EQ(FR_EQUAL_FLAG, CPU_getFlagRegister(cpu));
+    JIT_dtor(jit);
+  }
+
+  for (auto instr : program) {
+    Instruction_dtor(instr);
+  }
+  CPU_dtor(cpu);
+  ALU_dtor(alu);
+}
+
+TEST(JitTest, CompilesNotWithoutSource) {
+  Register ovf = 0;
+  auto cpu = CPU_ctor();
+  auto alu = ALU_ctor(CPU_getFlagRegisterAddress(cpu), &ovf);
+  CPU_setALU(cpu, alu);
+  auto regs = CPU_getDataRegisters(cpu);
+  regs[0] = 0x00F0;
+  Instruction program[] = {
+      Instruction_ctor3(ALU_ADD, &regs[1], &regs[0]),
+      Instruction_ctor2(ALU_NOT, &regs[0]),
+      Instruction_ctor3(ALU_ADD, &regs[1], &regs[0]),
+  };
+
+  // The not does not end the block.
+  auto jit = JIT_ctor(cpu, program, 3);
+  if (jit != nullptr) {
+    ASSERT_EQ(1, JIT_getCompiledBlockCount(jit));
+    CpuRunStats stats;
+    ASSERT_EQ(CPU_RUN_RESULT_END_OF_PROGRAM, JIT_run(jit, CPU_RUN_NO_STEP_LIMIT, &stats));
+    ASSERT_EQ(3, stats.executedInstructionCount);
+    ASSERT_EQ(0xFF0F, regs[0]);
+    ASSERT_EQ(0xFFFF, regs[1]);
+    JIT_dtor(jit);
+  }
+
+  for (auto instr : program) {
+    Instruction_dtor(instr);
+  }
+  CPU_dtor(cpu);
+  ALU_dtor(alu);
+}
+
+TEST(JitTest, RejectsAliasedOverflowRegister) {
+  auto cpu = CPU_ctor();
+  auto alu = ALU_ctor(CPU_getFlagRegisterAddress(cpu), CPU_getDataRegisters(cpu) + 7);
+  CPU_setALU(cpu, alu);
+  ASSERT_EQ(nullptr, JIT_ctor(cpu, nullptr, 0));
+  CPU_dtor(cpu);
+  ALU_dtor(alu);
+}
+
+TEST(JitTest, MatchesCpuRunWithSeparateFlagRegister) {
+  for (unsigned seed = 0; seed < 32; ++seed) {
+    compareJitWithCpuRun(false, seed, 4096);
+  }
+}
+
+TEST(JitTest, MatchesCpuRunWithSharedFlagRegister) {
+  for (unsigned seed = 0; seed < 32; ++seed) {
+    compareJitWithCpuRun(true, seed, 4096);
+  }
+}
+
+TEST(JitTest, MatchesCpuRunAcrossResumedSlices) {
+  for (unsigned seed = 0; seed < 32; ++seed) {
+    compareJitWithCpuRun(true, seed, 37);
+  }
+}
+
+TEST(JitTest, MatchesCpuRunWithLazyFlags) {
+  for (unsigned seed = 0; seed < 32; ++seed) {
+    compareJitWithCpuRun(true, seed, 37, true);
+  }
+}
+
+TEST(JitTest, LazyFlagsOfAFallbackStepDoNotOverwriteCompiledFlags) {
+  Register ovf = 0;
+  auto cpu = CPU_ctor();
+  auto alu = ALU_ctor(CPU_getFlagRegisterAddress(cpu), &ovf);
+  CPU_setALU(cpu, alu);
+  ALU_setLazyFlags(alu, true);
+  auto regs = CPU_getDataRegisters(cpu);
+  Register target = 3;
+  Instruction program[] = {
+      Instruction_ctor2(ALU_NOT, &regs[0]),
+      Instruction_ctor3(ALU_CMP, &regs[1], &regs[2]),
+      Instruction_ctor2(IPU_JEQ, &target),
+  };
+
+  auto jit = JIT_ctor(cpu, program, 3);
+  if (jit != nullptr) {
+    CpuRunStats stats;
+    ASSERT_EQ(CPU_RUN_RESULT_END_OF_PROGRAM, JIT_run(jit, CPU_RUN_NO_STEP_LIMIT, &stats));
+    ASSERT_EQ(3, stats.executedInstructionCount);
+    ASSERT_EQ(0xFFFF, regs[0]);
+    ASSERT_EQ(FR_EQUAL_FLAG, CPU_getFlagRegister(cpu));
+    JIT_dtor(jit);
+  }
+
+  for (auto instr : program) {
+    Instruction_dtor(instr);
+  }
+  CPU_dtor(cpu);
+  ALU_dtor(alu);
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <parser/lexer.hpp>
+
+namespace {
+using parser::Lexer;
+using parser::ScanKernel;
+
+struct Token {
+  std::string text;
+  unsigned line;
+  unsigned column;
+
+  auto operator==(Token const&) const -> bool = default;
+};
+
+auto lex(std::string_view source, ScanKernel kernel) -> std::vector<Token> {
+  std::vector<Token> tokens;
+  Lexer lexer{source, kernel};
+  while (auto token = lexer.next()) {
+    tokens.push_back(Token{std::string{token->text}, token->line, token->column});
+  }
+  return tokens;
+}
+} // namespace
+
+TEST(LexerTest, TokensAreSplitOnSeparatorsAndLineBreaks) {
+  auto const tokens = lex("start:\n\tadd r0,\t0x10;\r\n  jmp start // again\n", ScanKernel::Scalar);
+  std::vector<Token> const expected {
+      {"start:", 1, 1},
+      {"add", 2, 2},
+      {"r0", 2, 6},
+      {"0x10;", 2, 10},
+      {"jmp", 3, 3},
+      {"start", 3, 7},
+      {"//", 3, 13},
+      {"again", 3, 16},
+  };
+  ASSERT_EQ(expected, tokens);
+}
+
+TEST(LexerTest, VectorKernelsMatchScalarKernel) {
+  // Runs of every length around the 16 and 32 byte block sizes, so that token and blank
+  // boundaries land on every position of a block, plus bytes above 0x7f.
+  std::string source;
+  char const blanks[] = {' ', ',', '\t', '\r', '\v', '\f'};
+  for (unsigned length = 1; length < 70; ++length) {
+    source.append(length, static_cast<char>('a' + length % 26));
+    source.append(length % 5 + 1, blanks[length % 6]);
+    if (length % 7 == 0) {
+      source.append(length % 3 + 1, '\n');
+    }
+    if (length % 11 == 0) {
+      source.append("\xc3\xa9\x80");
+    }
+  }
+  source.append(40, ' ');
+
+  auto const expected = lex(source, ScanKernel::Scalar);
+  for (auto const kernel : {ScanKernel::Sse2, ScanKernel::Avx2}) {
+    if (!parser::isScanKernelSupported(kernel)) {
+      continue;
+    }
+    for (size_t offset = 0; offset < 40; ++offset) {
+      auto const view = std::string_view{source}.substr(offset);
+      ASSERT_EQ(lex(view, ScanKernel::Scalar), lex(view, kernel)) << "offset " << offset;
+    }
+    ASSERT_EQ(expected, lex(source, kernel));
+  }
+}
+
+TEST(LexerTest, SkipLineStopsAtTheLineBreak) {
+  Lexer lexer{"a // b c\nd", ScanKernel::Scalar};
+  ASSERT_EQ("a", lexer.next()->text);
+  ASSERT_EQ("//", lexer.next()->text);
+  lexer.skipLine();
+  auto const token = lexer.next();
+  ASSERT_TRUE(token.has_value());
+  ASSERT_EQ("d", token->text);
+  ASSERT_EQ(2u, token->line);
+  ASSERT_FALSE(lexer.next().has_value());
+  ASSERT_EQ(2u, lexer.lineCount());
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+extern "C" {
+#include <proc/Alu.h>
+#include <proc/Cpu.h>
+#include <proc/Lockstep.h>
+}
+
+namespace {
+using std::array;
+using std::vector;
+
+auto reg(U16 index) {
+  return std::pair {INSTRUCTION_OPERAND_REGISTER, index};
+}
+
+auto imm(U16 value) {
+  return std::pair {INSTRUCTION_OPERAND_IMMEDIATE, value};
+}
+
+auto make(InstructionType type, std::pair<InstructionOperandKind, U16> p0 = {INSTRUCTION_OPERAND_NONE, 0},
+          std::pair<InstructionOperandKind, U16> p1 = {INSTRUCTION_OPERAND_NONE, 0}) {
+  return PackedInstruction_make(type, p0.first, p0.second, p1.first, p1.second);
+}
+
+// Lanes loop a data-dependent number of times, divide by a value that is zero on some lanes,
+// and call a subroutine only on odd inputs.
+auto makeProgram() -> vector<PackedInstruction> {
+  return {
+      make(ALU_ADD, reg(1), imm(3)),
+      make(ALU_SHL, reg(2), reg(0)),
+      make(ALU_XOR, reg(3), reg(1)),
+      make(ALU_SUB, reg(4), reg(1)),
+      make(ALU_CMP, reg(1), reg(0)),
+      make(IPU_JLT, imm(0)),
+      make(MMU_MOV, reg(5), reg(1)),
+      make(ALU_DIV, reg(1), reg(6)),
+      make(ALU_AND, reg(0), imm(1)),
+      make(ALU_CMP, reg(0), imm(1)),
+      make(IPU_JNE, imm(13)),
+      make(IPU_CALL, imm(14)),
+      make(ALU_NOT, reg(7)),
+      make(IPU_JMP, imm(17)),
+      make(ALU_MUL, reg(3), imm(7)),
+      make(ALU_SHR, reg(3), imm(2)),
+      make(IPU_RET),
+  };
+}
+
+auto initialRegisters(U32 lane) -> array<Register, CPU_DATA_REGISTRY_LIST_SIZE> {
+  return {static_cast<Register>(lane * 5), 0, 1, 0, 100, 0, static_cast<Register>(lane % 3), 0};
+}
+
+auto runLanes(vector<PackedInstruction> const& program, U32 laneCount, U32 slice) {
+  auto state = std::make_unique<LockstepState>();
+  for (U32 lane = 0; lane < LOCKSTEP_LANE_COUNT; ++lane) {
+    auto regs = initialRegisters(lane);
+    for (U32 i = 0; i < CPU_DATA_REGISTRY_LIST_SIZE; ++i) {
+      state->dataRegisters[i][lane] = regs[i];
+    }
+  }
+
+  vector<Register> overflows(laneCount, 0);
+  vector<CPU> cpus;
+  vector<ALU> alus;
+  for (U32 lane = 0; lane < laneCount; ++lane) {
+    cpus.push_back(CPU_ctor());
+    alus.push_back(ALU_ctor(CPU_getFlagRegisterAddress(cpus.back()), &overflows[lane]));
+    CPU_setALU(cpus.back(), alus.back());
+    auto regs = initialRegisters(lane);
+    for (U8 i = 0; i < CPU_DATA_REGISTRY_LIST_SIZE; ++i) {
+      CPU_setDataRegister(cpus.back(), i, regs[i]);
+    }
+  }
+
+  array<CpuRunStats, LOCKSTEP_LANE_COUNT> stats {};
+  bool pending;
+  do {
+    Lockstep_run(program.data(), program.size(), laneCount, slice, state.get(), stats.data());
+    pending = false;
+    for (U32 lane = 0; lane < laneCount; ++lane) {
+      CpuRunStats expected;
+      CPU_runPacked(cpus[lane], program.data(), program.size(), slice, &expected);
+      ASSERT_EQ(expected.result, stats[lane].result) << "lane " << lane;
+      ASSERT_EQ(expected.executedInstructionCount, stats[lane].executedInstructionCount) << "lane " << lane;
+      ASSERT_EQ(expected.programCounter, stats[lane].programCounter) << "lane " << lane;
+      ASSERT_EQ(CPU_getFlagRegister(cpus[lane]), state->flagRegister[lane]) << "lane " << lane;
+      ASSERT_EQ(overflows[lane], state->overflowRegister[lane]) << "lane " << lane;
+      for (U8 i = 0; i < CPU_DATA_REGISTRY_LIST_SIZE; ++i) {
+        ASSERT_EQ(CPU_getDataRegister(cpus[lane], i), state->dataRegisters[i][lane]) << "lane " << lane;
+      }
+      pending |= expected.result == CPU_RUN_RESULT_STEP_LIMIT;
+    }
+  } while (pending);
+
+  for (U32 lane = laneCount; lane < LOCKSTEP_LANE_COUNT; ++lane) {
+    ASSERT_EQ(0, state->programCounter[lane]);
+    ASSERT_EQ(initialRegisters(lane)[1], state->dataRegisters[1][lane]);
+  }
+  for (U32 lane = 0; lane < laneCount; ++lane) {
+    CPU_dtor(cpus[lane]);
+    ALU_dtor(alus[lane]);
+  }
+}
+} // namespace
+
+TEST(LockstepTest, DivergentLanesMatchCpuRunPacked) {
+  runLanes(makeProgram(), LOCKSTEP_LANE_COUNT, CPU_RUN_NO_STEP_LIMIT);
+}
+
+TEST(LockstepTest, ResumedSlicesAndPartialLaneCountMatchCpuRunPacked) {
+  runLanes(makeProgram(), LOCKSTEP_LANE_COUNT - 3, 7);
+}
+
+TEST(LockstepTest, FaultingLaneStopsAlone) {
+  vector<PackedInstruction> program {
+      make(ALU_CMP, reg(0), imm(0)),
+      make(IPU_JEQ, imm(100)),
+      make(ALU_ADD, reg(1), imm(1)),
+  };
+  auto state = std::make_unique<LockstepState>();
+  state->dataRegisters[0][1] = 1;
+  array<CpuRunStats, LOCKSTEP_LANE_COUNT> stats {};
+  Lockstep_run(program.data(), program.size(), 2, CPU_RUN_NO_STEP_LIMIT, state.get(), stats.data());
+
+  ASSERT_EQ(CPU_RUN_RESULT_FAULT, stats[0].result);
+  ASSERT_EQ(FR_SEG_FLAG | FR_EQUAL_FLAG, state->flagRegister[0]);
+  ASSERT_EQ(1, stats[0].programCounter);
+  ASSERT_EQ(CPU_RUN_RESULT_END_OF_PROGRAM, stats[1].result);
+  ASSERT_EQ(1, state->dataRegisters[1][1]);
+}
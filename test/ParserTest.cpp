@@ -5,9 +5,24 @@
 #include <gtest/gtest.h>
 #include <parser/parser.h>
 
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <thread>
+
+#ifdef __unix__
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "CPUMock.hpp"
 #include "InstructionMock.hpp"
 
+extern "C" {
+#include <proc/Alu.h>
+#include <proc/Cpu.h>
+}
+
 namespace {
 using std::exception;
 using std::ignore;
@@ -68,7 +83,8 @@ public:
       .pNext = nullptr,
       .referencingInstructionIndex = 0,
       .tokenLength = 128,
-      .pToken = undefReferenceBuffer.data()
+      .pToken = undefReferenceBuffer.data(),
+      .referencingLine = 0
     };
     ParserGetInstructionSetInfo getInfo {
       .structureType = STRUCTURE_TYPE_PARSER_GET_INSTRUCTION_SET_INFO,
@@ -406,6 +422,31 @@ add r1 r3;)"
   ASSERT_EQ("0xDEAD", string_view(buffer.data(), 6));
 }
 
+TEST(ParserTest, InvalidTokenColumnIsThatOfTheOffendingOccurrence) {
+  string buffer(32, '\0');
+  ParserInvalidTokenOutputInfo invalidTokenInfo {
+    .structureType = STRUCTURE_TYPE_PARSER_INVALID_TOKEN_OUTPUT_INFO,
+    .pNext = nullptr,
+    .line = 0,
+    .column = 0,
+    .tokenLength = static_cast<U32>(buffer.size()),
+    .pToken = buffer.data()
+  };
+  ParserCreateInfo createInfo {
+    .structureType = STRUCTURE_TYPE_PARSER_CREATE_INFO,
+    .pNext = &invalidTokenInfo,
+    .inputType = PARSER_INPUT_TYPE_CODE,
+    .dataLength = 0,
+    .pData = "mov r0,\tr1;\r\nloop: loop"
+  };
+
+  Parser p;
+  ASSERT_EQ(PARSER_ERROR_INVALID_TOKEN, createParser(&createInfo, &p));
+  ASSERT_EQ(2, invalidTokenInfo.line);
+  ASSERT_EQ(7, invalidTokenInfo.column);
+  ASSERT_STREQ("loop", buffer.c_str());
+}
+
 TEST(ParserTest, GetInstructionSetWithInvalidArgsYieldsError) {
   Parser p;
   ParserCreateInfo createInfo {
@@ -696,3 +737,715 @@ TEST(ParserTest, UndefinedReferenceWithoutOutputWorksAsExpected) {
   U16 iCount;
   ASSERT_EQ(PARSER_ERROR_UNDEFINED_REFERENCE, getParserInstructionSet(p, &getInfo, &iCount, nullptr));
 }
+
+TEST(ParserTest, InstructionSetIsRebuiltForNewRegisterMap) {
+  ParserRAII parser{"add r0 r1; sub r1 5;"};
+  MockCpuRegisterMap<> first{};
+  MockCpuRegisterMap<> second{};
+
+  auto firstMap = first.map();
+  auto secondMap = second.map();
+
+  auto firstSet = parser.instructions(firstMap);
+  ASSERT_EQ(&first.regs()[0], Instruction_getParam1(firstSet[0]));
+
+  auto secondSet = parser.instructions(secondMap);
+  ASSERT_EQ(instructions(
+      add(&second.regs()[0], &second.regs()[1]),
+      sub(&second.regs()[1], 5)
+  ), secondSet);
+}
+
+TEST(ParserTest, ConstantsAreSharedAndReadOnly) {
+  ParserRAII first{"mov r0 7; cmp r1 65535;"};
+  ParserRAII second{"add r1 7;"};
+  MockCpuRegisterMap<> regMap{};
+  auto map = regMap.map();
+
+  auto firstSet = first.instructions(map);
+  auto secondSet = second.instructions(map);
+  ASSERT_EQ(Instruction_getParam2(firstSet[0]), Instruction_getParam2(secondSet[0]));
+  ASSERT_EQ(65535, *Instruction_getParam2(firstSet[1]));
+
+  try {
+    std::ignore = ParserRAII{"add 3 r0;"}.instructions(map);
+    FAIL();
+  } catch (ParserException const& exception) {
+    ASSERT_EQ(PARSER_ERROR_ILLEGAL_PARAMETER, exception.error());
+  }
+  try {
+    ParserRAII{"mov r0 65536;"};
+    FAIL();
+  } catch (ParserException const& exception) {
+    ASSERT_EQ("65536", exception.token());
+  }
+}
+
+namespace {
+auto getPackedProgram(Parser parser, vector<string> const& names, ParserUndefinedReferenceOutputInfo* pUndefined = nullptr)
+    -> std::pair<ParserError, vector<PackedInstruction>> {
+  vector<ParserRegisterName> registerNames;
+  for (auto const& name : names) {
+    registerNames.push_back({.registerNameLength = static_cast<U32>(name.length()), .pRegisterName = name.c_str()});
+  }
+  ParserGetPackedProgramInfo getInfo {
+    .structureType = STRUCTURE_TYPE_PARSER_GET_PACKED_PROGRAM_INFO,
+    .pNext = pUndefined,
+    .registerNameCount = static_cast<U16>(registerNames.size()),
+    .pRegisterNames = registerNames.data()
+  };
+  U16 count = 0;
+  if (auto const error = getParserPackedProgram(parser, &getInfo, &count, nullptr); error != PARSER_ERROR_NONE) {
+    return {error, {}};
+  }
+  vector<PackedInstruction> program(count);
+  return {getParserPackedProgram(parser, &getInfo, &count, program.data()), program};
+}
+
+auto createParserFromCode(char const* pCode) {
+  ParserCreateInfo createInfo {
+    .structureType = STRUCTURE_TYPE_PARSER_CREATE_INFO,
+    .pNext = nullptr,
+    .inputType = PARSER_INPUT_TYPE_CODE,
+    .dataLength = 0,
+    .pData = pCode
+  };
+  Parser parser = nullptr;
+  EXPECT_EQ(PARSER_ERROR_NONE, createParser(&createInfo, &parser));
+  return parser;
+}
+} // namespace
+
+TEST(ParserTest, PackedProgramIsSharedAcrossCpus) {
+  auto parser = createParserFromCode("loop: add acc step; cmp acc limit; jlt loop;");
+  auto [error, program] = getPackedProgram(parser, {"acc", "step", "limit"});
+  ASSERT_EQ(PARSER_ERROR_NONE, error);
+  ASSERT_EQ(3, program.size());
+  ASSERT_EQ(INSTRUCTION_OPERAND_REGISTER, PackedInstruction_getOperandKind(program[0], 1));
+  ASSERT_EQ(1, PackedInstruction_getOperand(program[0], 1));
+  ASSERT_EQ(0, PackedInstruction_getOperand(program[2], 0));
+
+  for (Register step : {1, 3, 7}) {
+    Register overflow = 0;
+    auto cpu = CPU_ctor();
+    auto alu = ALU_ctor(CPU_getFlagRegisterAddress(cpu), &overflow);
+    CPU_setALU(cpu, alu);
+    CPU_setDataRegister(cpu, 1, step);
+    CPU_setDataRegister(cpu, 2, 20);
+
+    ASSERT_EQ(CPU_RUN_RESULT_END_OF_PROGRAM,
+              CPU_runPacked(cpu, program.data(), program.size(), CPU_RUN_NO_STEP_LIMIT, nullptr));
+    ASSERT_EQ((20 + step - 1) / step * step, CPU_getDataRegister(cpu, 0));
+    CPU_dtor(cpu);
+    ALU_dtor(alu);
+  }
+  destroyParser(parser);
+}
+
+TEST(ParserTest, PackedProgramWithInvalidRegistersYieldsError) {
+  auto parser = createParserFromCode("add r0 r1; sub 3 r0;");
+  string token(32, '\0');
+  ParserUndefinedReferenceOutputInfo undefinedReferenceInfo {
+    .structureType = STRUCTURE_TYPE_PARSER_UNDEFINED_REFERENCE_OUTPUT_INFO,
+    .pNext = nullptr,
+    .referencingInstructionIndex = 0,
+    .tokenLength = static_cast<U32>(token.size()),
+    .pToken = token.data(),
+    .referencingLine = 0
+  };
+
+  ASSERT_EQ(PARSER_ERROR_UNDEFINED_REFERENCE, getPackedProgram(parser, {"r0"}, &undefinedReferenceInfo).first);
+  ASSERT_STREQ("r1", token.c_str());
+  ASSERT_EQ(PARSER_ERROR_ILLEGAL_PARAMETER, getPackedProgram(parser, {"r0", "r1"}).first);
+  ASSERT_EQ(PARSER_ERROR_ILLEGAL_PARAMETER, getPackedProgram(parser, vector<string>(9, "r")).first);
+  destroyParser(parser);
+}
+
+namespace {
+auto getBinaryProgram(Parser parser) {
+  U32 size = 0;
+  EXPECT_EQ(PARSER_ERROR_NONE, getParserBinaryProgram(parser, &size, nullptr));
+  string image(size, '\0');
+  EXPECT_EQ(PARSER_ERROR_NONE, getParserBinaryProgram(parser, &size, image.data()));
+  return image;
+}
+
+struct ParseResult {
+  ParserError error;
+  string binary;
+  string token;
+  U32 line;
+  U32 column;
+};
+
+auto parseWith(string const& source, ParserParallelParseInfo* pParallelInfo) {
+  ParseResult result {.error = PARSER_ERROR_NONE, .binary = {}, .token = string(32, '\0'), .line = 0, .column = 0};
+  ParserInvalidTokenOutputInfo invalidTokenInfo {
+    .structureType = STRUCTURE_TYPE_PARSER_INVALID_TOKEN_OUTPUT_INFO,
+    .pNext = pParallelInfo,
+    .line = 0,
+    .column = 0,
+    .tokenLength = static_cast<U32>(result.token.size()),
+    .pToken = result.token.data()
+  };
+  ParserCreateInfo createInfo {
+    .structureType = STRUCTURE_TYPE_PARSER_CREATE_INFO,
+    .pNext = &invalidTokenInfo,
+    .inputType = PARSER_INPUT_TYPE_CODE,
+    .dataLength = static_cast<U32>(source.length()),
+    .pData = source.c_str()
+  };
+  Parser parser = nullptr;
+  if (result.error = createParser(&createInfo, &parser); result.error != PARSER_ERROR_NONE) {
+    result.token.resize(invalidTokenInfo.tokenLength);
+    result.line = invalidTokenInfo.line;
+    result.column = invalidTokenInfo.column;
+    return result;
+  }
+  result.binary = getBinaryProgram(parser);
+  destroyParser(parser);
+  return result;
+}
+
+// Instructions spanning lines make chunks that start inside an instruction.
+auto spanningProgram(unsigned blockCount) {
+  string source;
+  for (unsigned block = 0; block < blockCount; ++block) {
+    auto const label = "loop_" + std::to_string(block);
+    source += label + ":\n";
+    source += "  mov r0 0x10 // counter\n";
+    source += "  add r0\n";
+    source += "    r1;\n";
+    source += "\n";
+    source += "  sub r0 1; cmp r0 0\n";
+    source += "  jne " + label + "\n";
+    source += "  // done; add r0 r1\n";
+    source += "  call " + label + "; ret\n";
+  }
+  return source;
+}
+} // namespace
+
+TEST(ParserTest, ParallelParseMatchesSerialParse) {
+  auto const source = spanningProgram(64);
+  auto const serial = parseWith(source, nullptr);
+  ASSERT_EQ(PARSER_ERROR_NONE, serial.error);
+
+  for (U32 const chunkLength : {1u, 7u, 64u, 1000u}) {
+    ParserParallelParseInfo parallelInfo {
+      .structureType = STRUCTURE_TYPE_PARSER_PARALLEL_PARSE_INFO,
+      .pNext = nullptr,
+      .threadCount = 4,
+      .chunkLength = chunkLength
+    };
+    auto const parallel = parseWith(source, &parallelInfo);
+    ASSERT_EQ(PARSER_ERROR_NONE, parallel.error);
+    ASSERT_EQ(serial.binary, parallel.binary);
+  }
+}
+
+TEST(ParserTest, ParallelParseReportsErrorsLikeSerialParse) {
+  auto const program = spanningProgram(16);
+  auto const middle = program.find("loop_8:");
+  for (auto const& source : {
+           program.substr(0, middle) + "  xor r1 0x1g;\n" + program.substr(middle),
+           program.substr(0, middle) + "  add r0\n  0x1g;\n" + program.substr(middle),
+           program.substr(0, middle) + "  add r0\n  r1 r2;\n" + program.substr(middle),
+           program + "  add r0\n"
+       }) {
+    auto const serial = parseWith(source, nullptr);
+    ASSERT_EQ(PARSER_ERROR_INVALID_TOKEN, serial.error);
+    for (U32 const chunkLength : {1u, 5u, 100u}) {
+      ParserParallelParseInfo parallelInfo {
+        .structureType = STRUCTURE_TYPE_PARSER_PARALLEL_PARSE_INFO,
+        .pNext = nullptr,
+        .threadCount = 3,
+        .chunkLength = chunkLength
+      };
+      auto const parallel = parseWith(source, &parallelInfo);
+      ASSERT_EQ(serial.error, parallel.error);
+      ASSERT_EQ(serial.token, parallel.token);
+      ASSERT_EQ(serial.line, parallel.line);
+      ASSERT_EQ(serial.column, parallel.column);
+    }
+  }
+}
+
+TEST(ParserTest, ProgramsPastTheU16LimitUseTheU32EntryPoints) {
+  auto constexpr paddingCount = 70000u;
+  string source = "jmp far;\n";
+  for (unsigned i = 0; i < paddingCount; ++i) {
+    source += "add r0 1;\n";
+  }
+  source += "far: add r1 1;\ncmp r1 2;\njlt far;\n";
+  auto parser = createParserFromCode(source.c_str());
+
+  Register overflow = 0;
+  auto cpu = CPU_ctor();
+  auto alu = ALU_ctor(CPU_getFlagRegisterAddress(cpu), &overflow);
+  CPU_setALU(cpu, alu);
+  vector<string> const names {"r0", "r1"};
+  vector<ParserMappedRegister> map;
+  for (U8 i = 0; i < names.size(); ++i) {
+    map.push_back({static_cast<U32>(names[i].length()), names[i].c_str(), CPU_getDataRegisters(cpu) + i});
+  }
+
+  ParserGetInstructionSetInfo getInfo {
+    .structureType = STRUCTURE_TYPE_PARSER_GET_INSTRUCTION_SET_INFO,
+    .pNext = nullptr,
+    .mappedRegisterCount = static_cast<U16>(map.size()),
+    .pMappedRegisters = map.data()
+  };
+  U16 shortCount = 0;
+  ASSERT_EQ(PARSER_ERROR_PROGRAM_TOO_LARGE, getParserInstructionSet(parser, &getInfo, &shortCount, nullptr));
+
+  ParserGetInstructionSetInfo2 getInfo2 {
+    .structureType = STRUCTURE_TYPE_PARSER_GET_INSTRUCTION_SET_INFO_2,
+    .pNext = nullptr,
+    .mappedRegisterCount = static_cast<U32>(map.size()),
+    .pMappedRegisters = map.data()
+  };
+  U32 count = 0;
+  ASSERT_EQ(PARSER_ERROR_NONE, getParserInstructionSet2(parser, &getInfo2, &count, nullptr));
+  ASSERT_EQ(paddingCount + 4, count);
+  vector<Instruction> instructions(count);
+  ASSERT_EQ(PARSER_ERROR_NONE, getParserInstructionSet2(parser, &getInfo2, &count, instructions.data()));
+  ASSERT_EQ(paddingCount + 1, Instruction_getBranchTarget(instructions.front()));
+  ASSERT_EQ(paddingCount + 1, Instruction_getBranchTarget(instructions.back()));
+  CPU_loadProgram(cpu, instructions.data(), count);
+  ASSERT_EQ(CPU_RUN_RESULT_END_OF_PROGRAM, CPU_run(cpu, CPU_RUN_NO_STEP_LIMIT, nullptr));
+  ASSERT_EQ(0, CPU_getDataRegister(cpu, 0));
+  ASSERT_EQ(2, CPU_getDataRegister(cpu, 1));
+
+  vector<ParserRegisterName> registerNames;
+  for (auto const& name : names) {
+    registerNames.push_back({.registerNameLength = static_cast<U32>(name.length()), .pRegisterName = name.c_str()});
+  }
+  ParserGetPackedProgramInfo packedInfo {
+    .structureType = STRUCTURE_TYPE_PARSER_GET_PACKED_PROGRAM_INFO,
+    .pNext = nullptr,
+    .registerNameCount = static_cast<U16>(registerNames.size()),
+    .pRegisterNames = registerNames.data()
+  };
+  ASSERT_EQ(PARSER_ERROR_PROGRAM_TOO_LARGE, getParserPackedProgram(parser, &packedInfo, &shortCount, nullptr));
+  ASSERT_EQ(PARSER_ERROR_NONE, getParserPackedProgram2(parser, &packedInfo, &count, nullptr));
+  vector<PackedInstruction> program(count);
+  ASSERT_EQ(PARSER_ERROR_NONE, getParserPackedProgram2(parser, &packedInfo, &count, program.data()));
+  ASSERT_EQ(paddingCount + 1, PackedInstruction_getBranchTarget(program.back()));
+  CPU_reset(cpu);
+  ASSERT_EQ(CPU_RUN_RESULT_END_OF_PROGRAM,
+            CPU_runPacked(cpu, program.data(), count, CPU_RUN_NO_STEP_LIMIT, nullptr));
+  ASSERT_EQ(0, CPU_getDataRegister(cpu, 0));
+  ASSERT_EQ(2, CPU_getDataRegister(cpu, 1));
+  CPU_dtor(cpu);
+  ALU_dtor(alu);
+  destroyParser(parser);
+
+  // A label past the limit only fits the operands of a branch.
+  source += "mov r0 far;\n";
+  parser = createParserFromCode(source.c_str());
+  ASSERT_EQ(PARSER_ERROR_ILLEGAL_PARAMETER, getParserInstructionSet2(parser, &getInfo2, &count, nullptr));
+  ASSERT_EQ(PARSER_ERROR_ILLEGAL_PARAMETER, getParserPackedProgram2(parser, &packedInfo, &count, nullptr));
+  destroyParser(parser);
+}
+
+namespace {
+auto getInstructionSet2(Parser parser, vector<ParserMappedRegister> const& map) {
+  ParserGetInstructionSetInfo2 getInfo {
+    .structureType = STRUCTURE_TYPE_PARSER_GET_INSTRUCTION_SET_INFO_2,
+    .pNext = nullptr,
+    .mappedRegisterCount = static_cast<U32>(map.size()),
+    .pMappedRegisters = map.data()
+  };
+  U32 count = 0;
+  if (auto const error = getParserInstructionSet2(parser, &getInfo, &count, nullptr); error != PARSER_ERROR_NONE) {
+    return std::make_pair(error, vector<Instruction>{});
+  }
+  vector<Instruction> instructions(count);
+  return std::make_pair(getParserInstructionSet2(parser, &getInfo, &count, instructions.data()), instructions);
+}
+
+auto createEditableParser(string const& source) {
+  ParserEditableSourceInfo editableInfo {
+    .structureType = STRUCTURE_TYPE_PARSER_EDITABLE_SOURCE_INFO,
+    .pNext = nullptr
+  };
+  ParserCreateInfo createInfo {
+    .structureType = STRUCTURE_TYPE_PARSER_CREATE_INFO,
+    .pNext = &editableInfo,
+    .inputType = PARSER_INPUT_TYPE_CODE,
+    .dataLength = static_cast<U32>(source.length()),
+    .pData = source.c_str()
+  };
+  Parser parser = nullptr;
+  EXPECT_EQ(PARSER_ERROR_NONE, createParser(&createInfo, &parser));
+  return parser;
+}
+
+auto updateSource(Parser parser, size_t offset, size_t removedLength, string const& text, void* pNext = nullptr) {
+  ParserUpdateInfo updateInfo {
+    .structureType = STRUCTURE_TYPE_PARSER_UPDATE_INFO,
+    .pNext = pNext,
+    .offset = static_cast<U32>(offset),
+    .removedLength = static_cast<U32>(removedLength),
+    .textLength = static_cast<U32>(text.length()),
+    .pText = text.c_str()
+  };
+  return updateParser(parser, &updateInfo);
+}
+} // namespace
+
+TEST(ParserTest, UpdatedParserMatchesAFreshParse) {
+  // Terminated blocks, so that every label is kept and the program links.
+  auto program = [](unsigned blockCount) {
+    auto source = spanningProgram(blockCount);
+    for (auto at = source.find("; ret\n"); at != string::npos; at = source.find("; ret\n", at)) {
+      source.insert(at += 5, ";");
+    }
+    return source;
+  };
+  auto source = program(32);
+  auto parser = createEditableParser(source);
+  MockCpuRegisterMap<> regMap{};
+  auto const map = regMap.map();
+  ASSERT_EQ(PARSER_ERROR_NONE, getInstructionSet2(parser, map).first);
+
+  struct Edit {
+    string anchor;
+    size_t shift;
+    size_t removedLength;
+    string text;
+  };
+  auto const end = string::npos;
+  for (auto const& [anchor, shift, removedLength, text] : {
+           Edit {"0x10", 0, 4, "0x20"},                        // Operand.
+           Edit {"loop_5:", 0, 0, "  add r0 r1;\n"},           // Inserted line.
+           Edit {"  sub r0 1; cmp r0 0\n", 0, 21, ""},         // Deleted line.
+           Edit {"    r1;", 4, 2, "r2"},                       // Inside a multi-line instruction.
+           Edit {"  add r0\n", 8, 1, " "},                     // Joined lines.
+           Edit {"  mov r0 0x10", 8, 0, "\n"},                 // Split line.
+           Edit {"loop_9:", 0, 7, "renamed:"},                 // Label still referenced by its old name.
+           Edit {"jne loop_9", 4, 6, "renamed"},
+           Edit {"call loop_9", 5, 6, "renamed"},
+           Edit {"loop_20:", 0, 0, "extra: jmp extra;\n"},     // New label.
+           Edit {"", 0, 0, "start: ret;\n"},                   // Start of the source.
+           Edit {"", end, 0, "  jmp start\n"},                 // End of the source.
+           Edit {"  jmp start\n", 11, 1, ""},                  // Unterminated last instruction.
+           Edit {"", 0, end, ""},                              // Everything.
+           Edit {"", 0, 0, program(4)},
+       }) {
+    auto const offset = shift == end ? source.length() : source.find(anchor) + shift;
+    auto const removed = std::min(removedLength, source.length() - offset);
+    ASSERT_EQ(PARSER_ERROR_NONE, updateSource(parser, offset, removed, text));
+    source.replace(offset, removed, text);
+
+    auto const fresh = parseWith(source, nullptr);
+    ASSERT_EQ(PARSER_ERROR_NONE, fresh.error);
+    ASSERT_EQ(fresh.binary, getBinaryProgram(parser));
+
+    auto freshParser = createParserFromCode(source.c_str());
+    auto const [freshError, freshSet] = getInstructionSet2(freshParser, map);
+    auto const [error, instructions] = getInstructionSet2(parser, map);
+    ASSERT_EQ(freshError, error);
+    ASSERT_EQ(freshSet.size(), instructions.size());
+    for (size_t i = 0; i < freshSet.size(); ++i) {
+      ASSERT_EQ(Instruction_getType(freshSet[i]), Instruction_getType(instructions[i]));
+      ASSERT_EQ(Instruction_getParam1(freshSet[i]), Instruction_getParam1(instructions[i]));
+      ASSERT_EQ(Instruction_getParam2(freshSet[i]), Instruction_getParam2(instructions[i]));
+    }
+    destroyParser(freshParser);
+  }
+  destroyParser(parser);
+}
+
+TEST(ParserTest, UpdateAfterInstructionSpanningManyLines) {
+  // More lines than an encoded instruction records the span of.
+  auto source = "loop: add r0" + string(70000, '\n') + "  r1;\n  cmp r0 r2;\n  jlt loop;\n";
+  auto parser = createEditableParser(source);
+  auto const offset = source.find("jlt");
+  ASSERT_EQ(PARSER_ERROR_NONE, updateSource(parser, offset, 3, "jgt"));
+  source.replace(offset, 3, "jgt");
+
+  auto const fresh = parseWith(source, nullptr);
+  ASSERT_EQ(PARSER_ERROR_NONE, fresh.error);
+  ASSERT_EQ(fresh.binary, getBinaryProgram(parser));
+  destroyParser(parser);
+}
+
+TEST(ParserTest, UpdatesReuseReplacedInstructions) {
+  string const source = "loop: mov r0 0x10;\n  add r0 r1;\n  cmp r0 r2;\n  jlt loop;\n";
+  auto parser = createEditableParser(source);
+  MockCpuRegisterMap<> regMap{};
+  auto const map = regMap.map();
+  auto const [error, initial] = getInstructionSet2(parser, map);
+  ASSERT_EQ(PARSER_ERROR_NONE, error);
+
+  // An operand edit patches the instruction it replaces.
+  auto const operand = source.find("0x10");
+  ASSERT_EQ(PARSER_ERROR_NONE, updateSource(parser, operand, 4, "0x20"));
+  auto const patched = getInstructionSet2(parser, map).second;
+  ASSERT_EQ(initial, patched);
+
+  // Lines inserted and deleted again only ever take one instruction past the program.
+  std::set<Instruction> seen(initial.begin(), initial.end());
+  auto const line = source.find("  cmp");
+  for (int i = 0; i < 64; ++i) {
+    ASSERT_EQ(PARSER_ERROR_NONE, updateSource(parser, line, 0, "  sub r1 r0;\n"));
+    auto const inserted = getInstructionSet2(parser, map).second;
+    ASSERT_EQ(initial.size() + 1, inserted.size());
+    seen.insert(inserted.begin(), inserted.end());
+    ASSERT_EQ(PARSER_ERROR_NONE, updateSource(parser, line, 13, ""));
+    auto const deleted = getInstructionSet2(parser, map).second;
+    ASSERT_EQ(initial.size(), deleted.size());
+    seen.insert(deleted.begin(), deleted.end());
+  }
+  ASSERT_EQ(initial.size() + 1, seen.size());
+  destroyParser(parser);
+}
+
+TEST(ParserTest, FailedUpdateLeavesParserUnchanged) {
+  auto const source = spanningProgram(16);
+  auto parser = createEditableParser(source);
+  auto const image = getBinaryProgram(parser);
+  auto const middle = source.find("loop_8:");
+
+  for (auto const& [offset, text] : {
+           std::make_pair(middle, string{"  xor r1 0x1g;\n"}),
+           std::make_pair(middle, string{"  add r0\n  r1 r2;\n"}),
+           std::make_pair(source.length(), string{"  add r0\n"})
+       }) {
+    auto const expected = parseWith(source.substr(0, offset) + text + source.substr(offset), nullptr);
+    ASSERT_EQ(PARSER_ERROR_INVALID_TOKEN, expected.error);
+
+    string token(32, '\0');
+    ParserInvalidTokenOutputInfo invalidTokenInfo {
+      .structureType = STRUCTURE_TYPE_PARSER_INVALID_TOKEN_OUTPUT_INFO,
+      .pNext = nullptr,
+      .line = 0,
+      .column = 0,
+      .tokenLength = static_cast<U32>(token.size()),
+      .pToken = token.data()
+    };
+    ASSERT_EQ(PARSER_ERROR_INVALID_TOKEN, updateSource(parser, offset, 0, text, &invalidTokenInfo));
+    token.resize(invalidTokenInfo.tokenLength);
+    ASSERT_EQ(expected.token, token);
+    ASSERT_EQ(expected.line, invalidTokenInfo.line);
+    ASSERT_EQ(expected.column, invalidTokenInfo.column);
+    ASSERT_EQ(image, getBinaryProgram(parser));
+  }
+
+  ASSERT_EQ(PARSER_ERROR_ILLEGAL_PARAMETER, updateParser(parser, nullptr));
+  auto const released = createParserFromCode(source.c_str());
+  ASSERT_EQ(PARSER_ERROR_ILLEGAL_PARAMETER, updateSource(released, 0, 0, "ret;"));
+  destroyParser(released);
+  ASSERT_EQ(PARSER_ERROR_ILLEGAL_PARAMETER, updateSource(parser, source.length() + 1, 0, ""));
+  ASSERT_EQ(PARSER_ERROR_ILLEGAL_PARAMETER, updateSource(parser, source.length() - 1, 2, ""));
+  ASSERT_EQ(image, getBinaryProgram(parser));
+  destroyParser(parser);
+}
+
+#ifdef __unix__
+TEST(ParserTest, FileInputIsReadFromRegularFilesAndPipes) {
+  auto const program = string{"loop: add r0 r1; cmp r0 r2; jlt loop;"};
+  auto const path = testing::TempDir() + "parser_test_input.asm";
+  auto const fifoPath = testing::TempDir() + "parser_test_input.fifo";
+  {
+    std::ofstream file{path};
+    file << program;
+  }
+  ::unlink(fifoPath.c_str());
+  ASSERT_EQ(0, ::mkfifo(fifoPath.c_str(), 0600));
+  std::thread writer{[&fifoPath, &program] {
+    std::ofstream fifo{fifoPath};
+    fifo << program;
+  }};
+
+  MockCpuRegisterMap<> regMap{};
+  for (auto const& input : {path, fifoPath}) {
+    ParserCreateInfo createInfo {
+      .structureType = STRUCTURE_TYPE_PARSER_CREATE_INFO,
+      .pNext = nullptr,
+      .inputType = PARSER_INPUT_TYPE_FILE_PATH,
+      .dataLength = 0,
+      .pData = input.c_str()
+    };
+    Parser p = nullptr;
+    ASSERT_EQ(PARSER_ERROR_NONE, createParser(&createInfo, &p));
+    auto map = regMap.map();
+    ParserGetInstructionSetInfo getInfo {
+      .structureType = STRUCTURE_TYPE_PARSER_GET_INSTRUCTION_SET_INFO,
+      .pNext = nullptr,
+      .mappedRegisterCount = static_cast<U16>(map.size()),
+      .pMappedRegisters = map.data()
+    };
+    U16 count = 0;
+    ASSERT_EQ(PARSER_ERROR_NONE, getParserInstructionSet(p, &getInfo, &count, nullptr));
+    ASSERT_EQ(3, count);
+    destroyParser(p);
+  }
+  writer.join();
+  ::unlink(path.c_str());
+  ::unlink(fifoPath.c_str());
+}
+
+namespace {
+auto createParserFrom(ParserInputType inputType, string const& data, void* pNext, Parser* pParser) {
+  ParserCreateInfo createInfo {
+    .structureType = STRUCTURE_TYPE_PARSER_CREATE_INFO,
+    .pNext = pNext,
+    .inputType = inputType,
+    .dataLength = static_cast<U32>(data.length()),
+    .pData = data.c_str()
+  };
+  return createParser(&createInfo, pParser);
+}
+
+auto getInstructionSet(Parser parser, vector<ParserMappedRegister> const& map,
+                       ParserUndefinedReferenceOutputInfo* pUndefined = nullptr) {
+  ParserGetInstructionSetInfo getInfo {
+    .structureType = STRUCTURE_TYPE_PARSER_GET_INSTRUCTION_SET_INFO,
+    .pNext = pUndefined,
+    .mappedRegisterCount = static_cast<U16>(map.size()),
+    .pMappedRegisters = map.data()
+  };
+  U16 count = 0;
+  if (auto const error = getParserInstructionSet(parser, &getInfo, &count, nullptr); error != PARSER_ERROR_NONE) {
+    return std::make_pair(error, vector<Instruction>{});
+  }
+  vector<Instruction> instructions(count);
+  return std::make_pair(getParserInstructionSet(parser, &getInfo, &count, instructions.data()), instructions);
+}
+
+auto writeFile(string const& path, string_view content) {
+  std::ofstream file{path, std::ios::binary | std::ios::trunc};
+  file.write(content.data(), static_cast<std::streamsize>(content.length()));
+}
+
+auto inode(string const& path) -> ino_t {
+  struct stat status {};
+  EXPECT_EQ(0, ::stat(path.c_str(), &status));
+  return status.st_ino;
+}
+
+auto constexpr binaryTestProgram = R"(
+start:
+  mov r0 0x10; // counter
+  call step;
+loop: sub r0 1; cmp r0 0;
+  jne loop;
+  ret;
+step: add r1 r0; ret;
+)";
+} // namespace
+
+TEST(ParserTest, BinaryProgramLoadsWithoutTheSource) {
+  Parser textParser = nullptr;
+  ASSERT_EQ(PARSER_ERROR_NONE, createParserFrom(PARSER_INPUT_TYPE_CODE, binaryTestProgram, nullptr, &textParser));
+  auto const image = getBinaryProgram(textParser);
+  auto const path = testing::TempDir() + "parser_test_program.esp";
+  writeFile(path, image);
+
+  Parser binaryParser = nullptr;
+  ASSERT_EQ(PARSER_ERROR_NONE, createParserFrom(PARSER_INPUT_TYPE_BINARY, path, nullptr, &binaryParser));
+  ASSERT_EQ(image, getBinaryProgram(binaryParser));
+  ASSERT_EQ(PARSER_ERROR_ILLEGAL_PARAMETER, updateSource(binaryParser, 0, 0, "ret;"));
+
+  MockCpuRegisterMap<> regMap{};
+  auto map = regMap.map();
+  auto const [textError, textSet] = getInstructionSet(textParser, map);
+  auto const [binaryError, binarySet] = getInstructionSet(binaryParser, map);
+  ASSERT_EQ(PARSER_ERROR_NONE, textError);
+  ASSERT_EQ(PARSER_ERROR_NONE, binaryError);
+  ASSERT_EQ(8, binarySet.size());
+  for (size_t i = 0; i < textSet.size(); ++i) {
+    ASSERT_EQ(Instruction_getType(textSet[i]), Instruction_getType(binarySet[i]));
+    ASSERT_EQ(Instruction_getParam1(textSet[i]), Instruction_getParam1(binarySet[i]));
+    ASSERT_EQ(Instruction_getParam2(textSet[i]), Instruction_getParam2(binarySet[i]));
+  }
+
+  // The line map survives, so undefined references are still reported against the source.
+  string token(16, '\0');
+  ParserUndefinedReferenceOutputInfo undefinedReferenceInfo {
+    .structureType = STRUCTURE_TYPE_PARSER_UNDEFINED_REFERENCE_OUTPUT_INFO,
+    .pNext = nullptr,
+    .referencingInstructionIndex = 0,
+    .tokenLength = static_cast<U32>(token.size()),
+    .pToken = token.data(),
+    .referencingLine = 0
+  };
+  ASSERT_EQ(PARSER_ERROR_UNDEFINED_REFERENCE,
+            getInstructionSet(binaryParser, MockCpuRegisterMap<1>{}.map(), &undefinedReferenceInfo).first);
+  ASSERT_STREQ("r1", token.c_str());
+  ASSERT_EQ(6, undefinedReferenceInfo.referencingInstructionIndex);
+  ASSERT_EQ(8, undefinedReferenceInfo.referencingLine);
+
+  destroyParser(textParser);
+  destroyParser(binaryParser);
+  ::unlink(path.c_str());
+}
+
+TEST(ParserTest, MalformedBinaryProgramYieldsError) {
+  Parser parser = nullptr;
+  ASSERT_EQ(PARSER_ERROR_NONE, createParserFrom(PARSER_INPUT_TYPE_CODE, binaryTestProgram, nullptr, &parser));
+  auto image = getBinaryProgram(parser);
+  destroyParser(parser);
+
+  auto const path = testing::TempDir() + "parser_test_malformed.esp";
+  for (auto const& malformed : {image.substr(0, image.size() - 1), image + ' ', string{binaryTestProgram},
+                                image.substr(0, 40)}) {
+    writeFile(path, malformed);
+    ASSERT_EQ(PARSER_ERROR_INVALID_BINARY, createParserFrom(PARSER_INPUT_TYPE_BINARY, path, nullptr, &parser));
+  }
+  image.back() ^= 1;
+  writeFile(path, image);
+  ASSERT_EQ(PARSER_ERROR_INVALID_BINARY, createParserFrom(PARSER_INPUT_TYPE_BINARY, path, nullptr, &parser));
+  ASSERT_EQ(PARSER_ERROR_INVALID_PATH,
+            createParserFrom(PARSER_INPUT_TYPE_BINARY, path + ".missing", nullptr, &parser));
+  ::unlink(path.c_str());
+}
+
+TEST(ParserTest, ProgramCacheStoresAndReusesBinaryPrograms) {
+  auto const directory = testing::TempDir() + "parser_test_cache";
+  std::filesystem::remove_all(directory);
+  ParserProgramCacheInfo cacheInfo {
+    .structureType = STRUCTURE_TYPE_PARSER_PROGRAM_CACHE_INFO,
+    .pNext = nullptr,
+    .directoryPathLength = 0,
+    .pDirectoryPath = directory.c_str()
+  };
+  auto cachedPrograms = [&directory] {
+    vector<string> paths;
+    for (auto const& entry : std::filesystem::directory_iterator{directory}) {
+      paths.push_back(entry.path().string());
+    }
+    return paths;
+  };
+
+  Parser parser = nullptr;
+  ASSERT_EQ(PARSER_ERROR_NONE, createParserFrom(PARSER_INPUT_TYPE_CODE, binaryTestProgram, &cacheInfo, &parser));
+  auto const image = getBinaryProgram(parser);
+  destroyParser(parser);
+  auto const paths = cachedPrograms();
+  ASSERT_EQ(1, paths.size());
+  auto const cachedInode = inode(paths[0]);
+
+  // A hit maps the cached program and leaves it alone.
+  ASSERT_EQ(PARSER_ERROR_NONE, createParserFrom(PARSER_INPUT_TYPE_CODE, binaryTestProgram, &cacheInfo, &parser));
+  ASSERT_EQ(image, getBinaryProgram(parser));
+  destroyParser(parser);
+  ASSERT_EQ(cachedInode, inode(paths[0]));
+
+  // A damaged entry is parsed again and replaced.
+  writeFile(paths[0], image.substr(0, image.size() / 2));
+  ASSERT_EQ(PARSER_ERROR_NONE, createParserFrom(PARSER_INPUT_TYPE_CODE, binaryTestProgram, &cacheInfo, &parser));
+  destroyParser(parser);
+  ASSERT_EQ(paths, cachedPrograms());
+  ASSERT_NE(cachedInode, inode(paths[0]));
+
+  // Another source gets its own entry.
+  ASSERT_EQ(PARSER_ERROR_NONE, createParserFrom(PARSER_INPUT_TYPE_CODE, "ret;", &cacheInfo, &parser));
+  destroyParser(parser);
+  ASSERT_EQ(2, cachedPrograms().size());
+  std::filesystem::remove_all(directory);
+}
+#endif
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <array>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+extern "C" {
+#include <model/Register.h>
+#include <proc/Alu.h>
+#include <proc/Cpu.h>
+}
+
+namespace testing::mock::detail {
+using std::array;
+using std::deque;
+using std::mt19937;
+using std::uniform_int_distribution;
+using std::vector;
+
+struct RunSnapshot {
+  array<Register, CPU_DATA_REGISTRY_LIST_SIZE> dataRegisters;
+  array<Register, 4> constants;
+  Register cpuFlags;
+  Register aluFlags;
+  Register overflow;
+  U32 programCounter;
+  CpuRunResult result;
+  U32 executedInstructionCount;
+
+  auto operator==(RunSnapshot const&) const -> bool = default;
+};
+
+// A CPU and ALU running a random program over the data registers and four constants, for
+// comparing execution engines against CPU_run. Lazy flags need the shared flag register.
+class ProgramFixture {
+public:
+  explicit ProgramFixture(bool sharedFlagRegister, bool lazyFlags = false) : _cpu{CPU_ctor()} {
+    _alu = ALU_ctor(sharedFlagRegister ? CPU_getFlagRegisterAddress(_cpu) : &_aluFlags, &_overflow);
+    ALU_setLazyFlags(_alu, lazyFlags);
+    CPU_setALU(_cpu, _alu);
+  }
+
+  ProgramFixture(ProgramFixture const&) = delete;
+
+  ~ProgramFixture() {
+    for (auto instr : _program) {
+      Instruction_dtor(instr);
+    }
+    CPU_dtor(_cpu);
+    ALU_dtor(_alu);
+  }
+
+  auto generate(unsigned seed, unsigned length) {
+    mt19937 gen{seed};
+    uniform_int_distribution<int> typeDist{DEFAULT, MMU_POP};
+    uniform_int_distribution<int> operandDist{0, CPU_DATA_REGISTRY_LIST_SIZE + 3};
+    uniform_int_distribution<int> valueDist{0, 0xFFFF};
+    uniform_int_distribution<unsigned> targetDist{0, length + 2};
+    for (unsigned i = 0; i < length; ++i) {
+      auto type = static_cast<InstructionType>(typeDist(gen));
+      // Constant 0 holds the shift amount, so it is never a destination.
+      auto dst = operandDist(gen);
+      auto p0 = operand(dst == CPU_DATA_REGISTRY_LIST_SIZE ? dst + 1 : dst);
+      auto p1 = operand(operandDist(gen));
+      if (type == ALU_SHL || type == ALU_SHR) {
+        p1 = &_constants[0];
+      }
+      // The parser emits not with its destination alone.
+      if (type == ALU_NOT) {
+        p1 = nullptr;
+      }
+      if (type >= IPU_JMP && type <= IPU_CALL) {
+        p0 = &_targets.emplace_back(static_cast<Register>(targetDist(gen)));
+        p1 = nullptr;
+      }
+      _program.push_back(Instruction_ctor3(type, p0, p1));
+    }
+    for (auto& value : _initial) {
+      value = valueDist(gen);
+    }
+    _initial[CPU_DATA_REGISTRY_LIST_SIZE] = 3;
+  }
+
+  auto reset() {
+    for (int i = 0; i < CPU_DATA_REGISTRY_LIST_SIZE; ++i) {
+      CPU_setDataRegister(_cpu, i, _initial[i]);
+    }
+    for (int i = 0; i < 4; ++i) {
+      _constants[i] = _initial[CPU_DATA_REGISTRY_LIST_SIZE + i];
+    }
+    *CPU_getFlagRegisterAddress(_cpu) = 0;
+    CPU_setProgramCounter(_cpu, 0);
+    _aluFlags = 0;
+    _overflow = 0;
+  }
+
+  [[nodiscard]] auto snapshot(CpuRunStats const& stats) -> RunSnapshot {
+    RunSnapshot s{};
+    s.programCounter = CPU_getProgramCounter(_cpu);
+    s.result = stats.result;
+    s.executedInstructionCount = stats.executedInstructionCount;
+    for (int i = 0; i < CPU_DATA_REGISTRY_LIST_SIZE; ++i) {
+      s.dataRegisters[i] = CPU_getDataRegister(_cpu, i);
+    }
+    s.constants = _constants;
+    s.cpuFlags = CPU_getFlagRegister(_cpu);
+    s.aluFlags = *ALU_getFlagRegister(_alu);
+    s.overflow = _overflow;
+    return s;
+  }
+
+  [[nodiscard]] auto cpu() const { return _cpu; }
+  [[nodiscard]] auto const& program() const { return _program; }
+
+private:
+  auto operand(int idx) -> Register* {
+    if (idx < CPU_DATA_REGISTRY_LIST_SIZE) {
+      return CPU_getDataRegisters(_cpu) + idx;
+    }
+    return &_constants[idx - CPU_DATA_REGISTRY_LIST_SIZE];
+  }
+
+  CPU _cpu;
+  ALU _alu;
+  Register _aluFlags {0};
+  Register _overflow {0};
+  array<Register, 4> _constants {};
+  deque<Register> _targets;
+  array<Register, CPU_DATA_REGISTRY_LIST_SIZE + 4> _initial {};
+  vector<Instruction> _program;
+};
+
+template <typename Run> auto runInSlices(U32 slice, Run&& run) {
+  CpuRunStats total{};
+  CpuRunStats stats{};
+  do {
+    run(slice, &stats);
+    total.result = stats.result;
+    total.executedInstructionCount += stats.executedInstructionCount;
+  } while (stats.result == CPU_RUN_RESULT_STEP_LIMIT && total.executedInstructionCount < 4096);
+  return total;
+}
+
+// Runs the program generated from seed with CPU_run, in slices of the given number of steps,
+// and with the engine returned by makeRun(fixture) on a fixture of its own, so that neither
+// sees the call stack left behind by the other. makeRun returns a callable taking the steps
+// and stats of one slice, or nullopt when the engine is not available. CPU_run keeps eager
+// flags; lazyFlags applies to the engine's ALU only.
+template <typename MakeRun>
+auto compareWithCpuRun(bool sharedFlagRegister, unsigned seed, U32 slice, MakeRun&& makeRun, bool lazyFlags = false) {
+  ProgramFixture reference{sharedFlagRegister};
+  reference.generate(seed, 512);
+  reference.reset();
+  CPU_loadProgram(reference.cpu(), reference.program().data(), reference.program().size());
+  auto expected = reference.snapshot(runInSlices(slice, [&](U32 steps, CpuRunStats* pStats) {
+    CPU_run(reference.cpu(), steps, pStats);
+  }));
+
+  ProgramFixture fixture{sharedFlagRegister, lazyFlags};
+  fixture.generate(seed, 512);
+  auto run = makeRun(fixture);
+  if (!run) {
+    GTEST_SKIP() << "engine not available on this host";
+  }
+  fixture.reset();
+  auto actual = fixture.snapshot(runInSlices(slice, *run));
+
+  ASSERT_EQ(expected, actual) << "seed " << seed;
+}
+} // namespace testing::mock::detail
+
+namespace testing::mock {
+using detail::compareWithCpuRun;
+using detail::ProgramFixture;
+using detail::RunSnapshot;
+} // namespace testing::mock
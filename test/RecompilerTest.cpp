@@ -0,0 +1,202 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <parser/recompiler.h>
+#include <proc/Alu.h>
+#include <proc/Cpu.h>
+#include <proc/Kernel.h>
+
+extern Kernel const checksum;
+}
+
+namespace {
+using std::array;
+using std::string;
+using std::vector;
+
+struct Snapshot {
+  array<Register, CPU_DATA_REGISTRY_LIST_SIZE> dataRegisters;
+  Register flags;
+  Register overflow;
+  U32 programCounter;
+  CpuRunResult result;
+  U32 executedInstructionCount;
+
+  auto operator==(Snapshot const&) const -> bool = default;
+};
+
+class Machine {
+public:
+  Machine() : _cpu{CPU_ctor()} {
+    _alu = ALU_ctor(CPU_getFlagRegisterAddress(_cpu), &_overflow);
+    CPU_setALU(_cpu, _alu);
+    CPU_setDataRegister(_cpu, 1, 20);
+    for (U32 i = 0; i < CPU_DATA_REGISTRY_LIST_SIZE; ++i) {
+      _names[i] = "r" + std::to_string(i);
+      _mapped[i] = ParserMappedRegister {
+          .registerNameLength = static_cast<U32>(_names[i].length()),
+          .pRegisterName = _names[i].c_str(),
+          .pRegister = CPU_getDataRegisters(_cpu) + i
+      };
+    }
+  }
+
+  ~Machine() {
+    CPU_dtor(_cpu);
+    ALU_dtor(_alu);
+  }
+
+  [[nodiscard]] auto snapshot(CpuRunStats const& stats) const -> Snapshot {
+    Snapshot s{};
+    for (U32 i = 0; i < CPU_DATA_REGISTRY_LIST_SIZE; ++i) {
+      s.dataRegisters[i] = CPU_getDataRegister(_cpu, i);
+    }
+    s.flags = CPU_getFlagRegister(_cpu);
+    s.overflow = _overflow;
+    s.programCounter = CPU_getProgramCounter(_cpu);
+    s.result = stats.result;
+    s.executedInstructionCount = stats.executedInstructionCount;
+    return s;
+  }
+
+  [[nodiscard]] auto cpu() const { return _cpu; }
+  [[nodiscard]] auto mapped() const { return _mapped.data(); }
+
+private:
+  CPU _cpu;
+  ALU _alu;
+  Register _overflow {0};
+  array<string, CPU_DATA_REGISTRY_LIST_SIZE> _names;
+  array<ParserMappedRegister, CPU_DATA_REGISTRY_LIST_SIZE> _mapped {};
+};
+
+auto createParser(char const* pData, ParserInputType inputType) -> Parser {
+  ParserCreateInfo createInfo {
+      .structureType = STRUCTURE_TYPE_PARSER_CREATE_INFO,
+      .pNext = nullptr,
+      .inputType = inputType,
+      .dataLength = 0,
+      .pData = pData
+  };
+  Parser parser = nullptr;
+  EXPECT_EQ(PARSER_ERROR_NONE, ::createParser(&createInfo, &parser));
+  return parser;
+}
+
+auto translateInfo(Machine const& machine, char const* pKernelName = "kernel") {
+  return ParserTranslateInfo {
+      .structureType = STRUCTURE_TYPE_PARSER_TRANSLATE_INFO,
+      .pNext = nullptr,
+      .mappedRegisterCount = CPU_DATA_REGISTRY_LIST_SIZE,
+      .pMappedRegisters = machine.mapped(),
+      .pRegisterFile = CPU_getDataRegisters(machine.cpu()),
+      .kernelNameLength = 0,
+      .pKernelName = pKernelName
+  };
+}
+
+auto compareWithCpuRun(U32 slice) {
+  Machine reference;
+  auto parser = createParser(TEST_PROGRAMS_DIR "/checksum.asm", PARSER_INPUT_TYPE_FILE_PATH);
+  ParserGetInstructionSetInfo getInfo {
+      .structureType = STRUCTURE_TYPE_PARSER_GET_INSTRUCTION_SET_INFO,
+      .pNext = nullptr,
+      .mappedRegisterCount = CPU_DATA_REGISTRY_LIST_SIZE,
+      .pMappedRegisters = reference.mapped()
+  };
+  U16 count = 0;
+  ASSERT_EQ(PARSER_ERROR_NONE, getParserInstructionSet(parser, &getInfo, &count, nullptr));
+  vector<Instruction> program(count, nullptr);
+  ASSERT_EQ(PARSER_ERROR_NONE, getParserInstructionSet(parser, &getInfo, &count, program.data()));
+  ASSERT_EQ(checksum.instructionCount, count);
+
+  Machine recompiled;
+  KernelCallStack callStack {};
+  CpuRunStats expectedStats {};
+  CpuRunStats actualStats {};
+  CPU_loadProgram(reference.cpu(), program.data(), count);
+  do {
+    CPU_run(reference.cpu(), slice, &expectedStats);
+    checksum.run(recompiled.cpu(), &callStack, slice, &actualStats);
+    ASSERT_EQ(reference.snapshot(expectedStats), recompiled.snapshot(actualStats));
+  } while (expectedStats.result == CPU_RUN_RESULT_STEP_LIMIT);
+
+  ASSERT_EQ(CPU_RUN_RESULT_END_OF_PROGRAM, actualStats.result);
+  ASSERT_EQ(210, CPU_getDataRegister(recompiled.cpu(), 0));
+  ASSERT_EQ(20, CPU_getDataRegister(recompiled.cpu(), 3));
+  ASSERT_EQ(30, CPU_getDataRegister(recompiled.cpu(), 4));
+  destroyParser(parser);
+}
+} // namespace
+
+TEST(RecompilerTest, KernelMatchesCpuRun) {
+  compareWithCpuRun(CPU_RUN_NO_STEP_LIMIT);
+}
+
+TEST(RecompilerTest, KernelMatchesCpuRunAcrossResumedSlices) {
+  compareWithCpuRun(7);
+}
+
+TEST(RecompilerTest, TranslateWithNoBufferYieldsRequiredSize) {
+  Machine machine;
+  auto parser = createParser("add r0 r1; jmp 0;", PARSER_INPUT_TYPE_CODE);
+  auto info = translateInfo(machine);
+
+  U32 length = 0;
+  ASSERT_EQ(PARSER_ERROR_NONE, translateParserProgram(parser, &info, &length, nullptr));
+  ASSERT_GT(length, 1);
+
+  string source(length - 1, '\0');
+  U32 smallLength = length - 1;
+  ASSERT_EQ(PARSER_ERROR_ARRAY_TOO_SMALL, translateParserProgram(parser, &info, &smallLength, source.data()));
+
+  source.resize(length);
+  ASSERT_EQ(PARSER_ERROR_NONE, translateParserProgram(parser, &info, &length, source.data()));
+  ASSERT_NE(string::npos, source.find("Kernel const kernel"));
+  ASSERT_NE(string::npos, source.find("r[0] = (Register) ((U32) a + (U32) b);"));
+  destroyParser(parser);
+}
+
+TEST(RecompilerTest, TranslateWithInvalidArgsYieldsError) {
+  Machine machine;
+  auto parser = createParser("add r0 r1;", PARSER_INPUT_TYPE_CODE);
+  auto info = translateInfo(machine, "not an identifier");
+  U32 length = 0;
+  ASSERT_EQ(PARSER_ERROR_ILLEGAL_PARAMETER, translateParserProgram(nullptr, &info, &length, nullptr));
+  ASSERT_EQ(PARSER_ERROR_ILLEGAL_PARAMETER, translateParserProgram(parser, nullptr, &length, nullptr));
+  ASSERT_EQ(PARSER_ERROR_ILLEGAL_PARAMETER, translateParserProgram(parser, &info, &length, nullptr));
+  destroyParser(parser);
+}
+
+TEST(RecompilerTest, WritingToConstantYieldsError) {
+  Machine machine;
+  auto parser = createParser("add 3 r0;", PARSER_INPUT_TYPE_CODE);
+  auto info = translateInfo(machine);
+  U32 length = 0;
+  ASSERT_EQ(PARSER_ERROR_ILLEGAL_PARAMETER, translateParserProgram(parser, &info, &length, nullptr));
+  destroyParser(parser);
+}
+
+TEST(RecompilerTest, UndefinedReferenceYieldsError) {
+  Machine machine;
+  auto parser = createParser("jmp nowhere;", PARSER_INPUT_TYPE_CODE);
+  string token(32, '\0');
+  ParserUndefinedReferenceOutputInfo undefinedReferenceInfo {
+      .structureType = STRUCTURE_TYPE_PARSER_UNDEFINED_REFERENCE_OUTPUT_INFO,
+      .pNext = nullptr,
+      .referencingInstructionIndex = 0,
+      .tokenLength = static_cast<U32>(token.size()),
+      .pToken = token.data(),
+      .referencingLine = 0
+  };
+  auto info = translateInfo(machine);
+  info.pNext = &undefinedReferenceInfo;
+  U32 length = 0;
+  ASSERT_EQ(PARSER_ERROR_UNDEFINED_REFERENCE, translateParserProgram(parser, &info, &length, nullptr));
+  ASSERT_STREQ("nowhere", token.c_str());
+  destroyParser(parser);
+}
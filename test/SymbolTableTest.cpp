@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <parser/symbols.hpp>
+
+namespace {
+using parser::Symbol;
+using parser::SymbolTable;
+using parser::symbolIndex;
+} // namespace
+
+TEST(SymbolTableTest, NamesAreInternedOnceInOrderOfAppearance) {
+  SymbolTable symbols;
+  auto const loop = symbols.intern("loop");
+  auto const r0 = symbols.intern("r0");
+  ASSERT_EQ(0, symbolIndex(loop));
+  ASSERT_EQ(1, symbolIndex(r0));
+  ASSERT_EQ(loop, symbols.intern(std::string{"loop"}));
+  ASSERT_EQ(2, symbols.size());
+  ASSERT_EQ("loop", symbols.name(loop));
+  ASSERT_EQ(r0, symbols.find("r0"));
+  ASSERT_FALSE(symbols.find("r1"));
+}
+
+TEST(SymbolTableTest, NamesOutliveTheirSourceAndTableMoves) {
+  SymbolTable symbols;
+  std::vector<std::string> names;
+  for (unsigned i = 0; i < 5000; ++i) {
+    names.push_back("label_" + std::to_string(i));
+  }
+  names.push_back(std::string(100000, 'x'));
+  names.push_back("after_long");
+  for (auto const& name : names) {
+    symbols.intern(name);
+  }
+  auto const expected = names;
+  names.clear();
+
+  auto const moved = std::move(symbols);
+  ASSERT_EQ(expected.size(), moved.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_EQ(expected[i], moved.name(static_cast<Symbol>(i)));
+    ASSERT_EQ(static_cast<Symbol>(i), moved.find(expected[i]));
+  }
+}
@@ -0,0 +1,19 @@
+// Sums r1 + (r1 - 1) + ... + 1 into r0 through a subroutine, counting the calls in r3
+// and shifting a marker bit into r6 on every call. r4 ends up holding r0 / 7.
+loop:
+  cmp r1 0;
+  jeq done;
+  call accumulate;
+  sub r1 1;
+  jmp loop;
+done:
+  xor r4 r4;
+  add r4 r0;
+  div r4 7;
+  ret;
+accumulate:
+  add r0 r1;
+  add r3 1;
+  shl r6 1;
+  or r6 1;
+  ret;